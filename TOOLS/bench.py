@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+Run the benchmark programs built with "./waf configure --bench" and collect
+their results into a single JSON file. Optionally compare against a previous
+result file, and fail if anything got slower.
+
+    TOOLS/bench.py -o new.json
+    TOOLS/bench.py --baseline old.json --threshold 10
+
+Extra arguments after "--" are passed to each benchmark program (for example
+"-- --filter=json" or "-- --rounds=21").
+"""
+
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+
+def run_all(bench_dir, extra_args):
+    results = {}
+    progs = sorted(glob.glob(os.path.join(bench_dir, "*")))
+    progs = [p for p in progs if os.path.isfile(p) and os.access(p, os.X_OK)]
+    if not progs:
+        sys.exit("No benchmark programs found in %s" % bench_dir)
+    for prog in progs:
+        name = os.path.basename(prog)
+        print("running %s" % name, file=sys.stderr)
+        out = subprocess.run([prog, "--json"] + extra_args, check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True)
+        for line in out.stdout.splitlines():
+            r = json.loads(line)
+            results[r["name"]] = r
+    return results
+
+def compare(baseline, results, threshold):
+    regressions = 0
+    for name, r in sorted(results.items()):
+        old = baseline.get(name)
+        if not old:
+            print("%-48s %12.3f us (new)" % (name, r["min_us"]))
+            continue
+        change = (r["min_us"] / old["min_us"] - 1) * 100 if old["min_us"] else 0
+        mark = ""
+        if change > threshold:
+            mark = "  <-- REGRESSION"
+            regressions += 1
+        print("%-48s %12.3f us %+7.1f%%%s" % (name, r["min_us"], change, mark))
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description="Run mpv benchmarks.")
+    parser.add_argument("--dir", default="build/test/bench",
+                        help="directory with benchmark programs")
+    parser.add_argument("-o", "--output", help="write results to this file")
+    parser.add_argument("--baseline", help="compare with this result file")
+    parser.add_argument("--threshold", type=float, default=10,
+                        help="slowdown in percent reported as regression")
+    parser.add_argument("args", nargs="*", help="passed to each benchmark")
+    opts = parser.parse_args()
+
+    results = run_all(opts.dir, opts.args)
+
+    if opts.output:
+        with open(opts.output, "w") as f:
+            json.dump({"benchmarks": results}, f, indent=2, sort_keys=True)
+
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            baseline = json.load(f)["benchmarks"]
+        if compare(baseline, results, opts.threshold):
+            sys.exit(1)
+    elif not opts.output:
+        for name, r in sorted(results.items()):
+            print("%-48s %12.3f us" % (name, r["min_us"]))
+
+if __name__ == "__main__":
+    main()
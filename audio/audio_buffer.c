@@ -25,6 +25,9 @@
 #include "audio_buffer.h"
 #include "format.h"
 
+// Per-plane ring buffer. The buffered samples start at the sample index start,
+// and can wrap around the end of the allocation. Consuming data thus never
+// moves memory.
 struct mp_audio_buffer {
     int format;
     struct mp_chmap channels;
@@ -33,7 +36,12 @@ struct mp_audio_buffer {
     int num_planes;
     uint8_t *data[MP_NUM_CHANNELS];
     int allocated;
+    int start;
     int num_samples;
+    // Returned by mp_audio_buffer_peek().
+    uint8_t *read_ptrs[MP_NUM_CHANNELS];
+    // For mp_audio_buffer_linearize(); allocated/2 samples.
+    uint8_t *tmp;
 };
 
 struct mp_audio_buffer *mp_audio_buffer_create(void *talloc_ctx)
@@ -48,10 +56,12 @@ void mp_audio_buffer_reinit_fmt(struct mp_audio_buffer *ab, int format,
 {
     for (int n = 0; n < MP_NUM_CHANNELS; n++)
         TA_FREEP(&ab->data[n]);
+    TA_FREEP(&ab->tmp);
     ab->format = format;
     ab->channels = *channels;
     ab->srate = srate;
     ab->allocated = 0;
+    ab->start = 0;
     ab->num_samples = 0;
     ab->sstride = af_fmt_to_bytes(ab->format);
     ab->num_planes = 1;
@@ -62,15 +72,66 @@ void mp_audio_buffer_reinit_fmt(struct mp_audio_buffer *ab, int format,
     }
 }
 
+// Physical sample index of the logical position pos (relative to the start of
+// the buffered data).
+static int ring_index(struct mp_audio_buffer *ab, int pos)
+{
+    int i = ab->start + pos;
+    return i >= ab->allocated ? i - ab->allocated : i;
+}
+
+// Copy length samples from src (a normal, linear buffer) to the logical
+// position pos. All integer parameters are in samples.
+static void ring_write(struct mp_audio_buffer *ab, int pos,
+                       uint8_t **src, int src_offset, int length)
+{
+    while (length > 0) {
+        int i = ring_index(ab, pos);
+        int copy = MPMIN(length, ab->allocated - i);
+        for (int n = 0; n < ab->num_planes; n++) {
+            memcpy(ab->data[n] + i * ab->sstride,
+                   src[n] + src_offset * ab->sstride, copy * ab->sstride);
+        }
+        pos += copy;
+        src_offset += copy;
+        length -= copy;
+    }
+}
+
+// Copy length samples from the logical position pos to dst.
+static void ring_read(struct mp_audio_buffer *ab, int pos,
+                      uint8_t **dst, int dst_offset, int length)
+{
+    while (length > 0) {
+        int i = ring_index(ab, pos);
+        int copy = MPMIN(length, ab->allocated - i);
+        for (int n = 0; n < ab->num_planes; n++) {
+            memcpy(dst[n] + dst_offset * ab->sstride,
+                   ab->data[n] + i * ab->sstride, copy * ab->sstride);
+        }
+        pos += copy;
+        dst_offset += copy;
+        length -= copy;
+    }
+}
+
 // Make the total size of the internal buffer at least this number of samples.
 void mp_audio_buffer_preallocate_min(struct mp_audio_buffer *ab, int samples)
 {
     if (samples > ab->allocated) {
+        // Copy the data to the start of the new allocation, which also
+        // resolves wrapping around.
+        uint8_t *data[MP_NUM_CHANNELS] = {0};
+        for (int n = 0; n < ab->num_planes; n++)
+            data[n] = talloc_size(ab, ab->sstride * samples);
+        ring_read(ab, 0, data, 0, ab->num_samples);
         for (int n = 0; n < ab->num_planes; n++) {
-            ab->data[n] = talloc_realloc(ab, ab->data[n], char,
-                                         ab->sstride * samples);
+            talloc_free(ab->data[n]);
+            ab->data[n] = data[n];
         }
+        TA_FREEP(&ab->tmp);
         ab->allocated = samples;
+        ab->start = 0;
     }
 }
 
@@ -81,25 +142,12 @@ int mp_audio_buffer_get_write_available(struct mp_audio_buffer *ab)
     return ab->allocated - ab->num_samples;
 }
 
-// All integer parameters are in samples.
-// dst and src can overlap.
-static void copy_planes(struct mp_audio_buffer *ab,
-                        uint8_t **dst, int dst_offset,
-                        uint8_t **src, int src_offset, int length)
-{
-    for (int n = 0; n < ab->num_planes; n++) {
-        memmove((char *)dst[n] + dst_offset * ab->sstride,
-                (char *)src[n] + src_offset * ab->sstride,
-                length * ab->sstride);
-    }
-}
-
 // Append data to the end of the buffer.
 // If the buffer is not large enough, it is transparently resized.
 void mp_audio_buffer_append(struct mp_audio_buffer *ab, void **ptr, int samples)
 {
     mp_audio_buffer_preallocate_min(ab, ab->num_samples + samples);
-    copy_planes(ab, ab->data, ab->num_samples, (uint8_t **)ptr, 0, samples);
+    ring_write(ab, ab->num_samples, (uint8_t **)ptr, 0, samples);
     ab->num_samples += samples;
 }
 
@@ -108,42 +156,106 @@ void mp_audio_buffer_prepend_silence(struct mp_audio_buffer *ab, int samples)
 {
     assert(samples >= 0);
     mp_audio_buffer_preallocate_min(ab, ab->num_samples + samples);
-    copy_planes(ab, ab->data, samples, ab->data, 0, ab->num_samples);
+    ab->start -= samples;
+    if (ab->start < 0)
+        ab->start += ab->allocated;
     ab->num_samples += samples;
-    for (int n = 0; n < ab->num_planes; n++)
-        af_fill_silence(ab->data[n], samples * ab->sstride, ab->format);
+    for (int pos = 0; pos < samples;) {
+        int i = ring_index(ab, pos);
+        int fill = MPMIN(samples - pos, ab->allocated - i);
+        for (int n = 0; n < ab->num_planes; n++) {
+            af_fill_silence(ab->data[n] + i * ab->sstride, fill * ab->sstride,
+                            ab->format);
+        }
+        pos += fill;
+    }
 }
 
 void mp_audio_buffer_duplicate(struct mp_audio_buffer *ab, int samples)
 {
     assert(samples >= 0 && samples <= ab->num_samples);
     mp_audio_buffer_preallocate_min(ab, ab->num_samples + samples);
-    copy_planes(ab, ab->data, ab->num_samples,
-                ab->data, ab->num_samples - samples, samples);
-    ab->num_samples += samples;
+    int src = ab->num_samples - samples;
+    int dst = ab->num_samples;
+    while (samples > 0) {
+        int si = ring_index(ab, src), di = ring_index(ab, dst);
+        int copy = MPMIN(samples, ab->allocated - MPMAX(si, di));
+        for (int n = 0; n < ab->num_planes; n++) {
+            memcpy(ab->data[n] + di * ab->sstride,
+                   ab->data[n] + si * ab->sstride, copy * ab->sstride);
+        }
+        src += copy;
+        dst += copy;
+        samples -= copy;
+    }
+    ab->num_samples = dst;
+}
+
+// Move the buffered data so that it doesn't wrap around the end of the
+// internal buffer, and mp_audio_buffer_peek() returns all of it. This is
+// needed only if a reader requires more contiguous data than the first
+// segment has (for example if it has to consume data in fixed-size blocks).
+void mp_audio_buffer_linearize(struct mp_audio_buffer *ab)
+{
+    int first = MPMIN(ab->num_samples, ab->allocated - ab->start);
+    int second = ab->num_samples - first;
+    if (!second) {
+        // Not wrapped; just move it to the front.
+        for (int n = 0; n < ab->num_planes; n++) {
+            memmove(ab->data[n], ab->data[n] + ab->start * ab->sstride,
+                    first * ab->sstride);
+        }
+        ab->start = 0;
+        return;
+    }
+
+    // Rotate the data in place. The smaller part is saved in tmp, which is at
+    // most half of the buffer.
+    if (!ab->tmp)
+        ab->tmp = talloc_size(ab, ab->allocated / 2 * ab->sstride);
+    for (int n = 0; n < ab->num_planes; n++) {
+        uint8_t *d = ab->data[n];
+        if (first <= second) {
+            memcpy(ab->tmp, d + ab->start * ab->sstride, first * ab->sstride);
+            memmove(d + first * ab->sstride, d, second * ab->sstride);
+            memcpy(d, ab->tmp, first * ab->sstride);
+        } else {
+            memcpy(ab->tmp, d, second * ab->sstride);
+            memmove(d, d + ab->start * ab->sstride, first * ab->sstride);
+            memcpy(d + first * ab->sstride, ab->tmp, second * ab->sstride);
+        }
+    }
+    ab->start = 0;
 }
 
-// Get the start of the current readable buffer.
+// Get the start of the current readable buffer. If the data wraps around the
+// end of the internal ring buffer, this returns only the first contiguous
+// segment, so *samples can be less than mp_audio_buffer_samples(). After
+// skipping it, the next call returns the rest.
 void mp_audio_buffer_peek(struct mp_audio_buffer *ab, uint8_t ***ptr,
                           int *samples)
 {
-    *ptr = ab->data;
-    *samples = ab->num_samples;
+    for (int n = 0; n < ab->num_planes; n++)
+        ab->read_ptrs[n] = ab->data[n] + ab->start * ab->sstride;
+    *ptr = ab->read_ptrs;
+    *samples = MPMIN(ab->num_samples, ab->allocated - ab->start);
 }
 
 // Skip leading samples. (Used with mp_audio_buffer_peek() to read data.)
 void mp_audio_buffer_skip(struct mp_audio_buffer *ab, int samples)
 {
     assert(samples >= 0 && samples <= ab->num_samples);
-    copy_planes(ab, ab->data, 0, ab->data, samples, ab->num_samples - samples);
+    ab->start = ring_index(ab, samples);
     ab->num_samples -= samples;
+    if (!ab->num_samples)
+        ab->start = 0;
 }
 
 void mp_audio_buffer_clear(struct mp_audio_buffer *ab)
 {
+    ab->start = 0;
     ab->num_samples = 0;
 }
-
 // Return number of buffered audio samples
 int mp_audio_buffer_samples(struct mp_audio_buffer *ab)
 {
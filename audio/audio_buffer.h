@@ -29,6 +29,7 @@ int mp_audio_buffer_get_write_available(struct mp_audio_buffer *ab);
 void mp_audio_buffer_append(struct mp_audio_buffer *ab, void **ptr, int samples);
 void mp_audio_buffer_prepend_silence(struct mp_audio_buffer *ab, int samples);
 void mp_audio_buffer_duplicate(struct mp_audio_buffer *ab, int samples);
+void mp_audio_buffer_linearize(struct mp_audio_buffer *ab);
 void mp_audio_buffer_peek(struct mp_audio_buffer *ab, uint8_t ***ptr,
                           int *samples);
 void mp_audio_buffer_skip(struct mp_audio_buffer *ab, int samples);
@@ -32,6 +32,7 @@
 #include "common/av_common.h"
 #include "common/codecs.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "common/msg.h"
 #include "demux/packet.h"
 #include "demux/stheader.h"
@@ -47,7 +48,7 @@ struct priv {
     bool preroll_done;
     double next_pts;
     AVRational codec_timebase;
-    bool eof_returned;
+    struct lavc_state state;
 
     struct mp_decoder public;
 };
@@ -157,7 +158,8 @@ static void reset(struct mp_filter *da)
     ctx->trim_samples = 0;
     ctx->preroll_done = false;
     ctx->next_pts = MP_NOPTS_VALUE;
-    ctx->eof_returned = false;
+    ctx->state.eof_returned = false;
+    ctx->state.decode_time = 0;
 }
 
 static bool send_packet(struct mp_filter *da, struct demux_packet *mpkt)
@@ -263,7 +265,7 @@ static void process(struct mp_filter *ad)
 {
     struct priv *priv = ad->priv;
 
-    lavc_process(ad, &priv->eof_returned, send_packet, receive_frame);
+    lavc_process(ad, &priv->state, send_packet, receive_frame);
 }
 
 static const struct mp_filter_info ad_lavc_filter = {
@@ -289,6 +291,8 @@ static struct mp_decoder *create(struct mp_filter *parent,
 
     struct priv *priv = da->priv;
     priv->public.f = da;
+    priv->state.metric_frame_us =
+        mp_metrics_get(da->global, "decode/audio-frame-us", MP_METRIC_HISTOGRAM);
 
     if (!init(da, codec, decoder)) {
         talloc_free(da);
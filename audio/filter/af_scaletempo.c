@@ -37,6 +37,7 @@
 
 #include "audio/aframe.h"
 #include "audio/format.h"
+#include "audio/xcorr.h"
 #include "common/common.h"
 #include "filters/f_autoconvert.h"
 #include "filters/filter_internal.h"
@@ -88,6 +89,7 @@ struct priv {
     int num_channels;
     void *buf_pre_corr;
     void *table_window;
+    struct mp_xcorr *xcorr;
     int (*best_overlap_offset)(struct priv *s);
 };
 
@@ -138,9 +140,6 @@ static bool fill_queue(struct priv *s)
 
 static int best_overlap_offset_float(struct priv *s)
 {
-    float best_corr = INT_MIN;
-    int best_off = 0;
-
     float *pw  = s->table_window;
     float *po  = s->buf_overlap;
     po += s->num_channels;
@@ -149,18 +148,8 @@ static int best_overlap_offset_float(struct priv *s)
         *ppc++ = *pw++ **po++;
 
     float *search_start = (float *)s->buf_queue + s->num_channels;
-    for (int off = 0; off < s->frames_search; off++) {
-        float corr = 0;
-        float *ps = search_start;
-        ppc = s->buf_pre_corr;
-        for (int i = s->num_channels; i < s->samples_overlap; i++)
-            corr += *ppc++ **ps++;
-        if (corr > best_corr) {
-            best_corr = corr;
-            best_off  = off;
-        }
-        search_start += s->num_channels;
-    }
+    int best_off = mp_xcorr_best_offset(s->xcorr, s->buf_pre_corr,
+                                        search_start);
 
     return best_off * 4 * s->num_channels;
 }
@@ -178,6 +167,11 @@ static int best_overlap_offset_s16(struct priv *s)
         *ppc++ = (*pw++ **po++) >> 15;
 
     int16_t *search_start = (int16_t *)s->buf_queue + s->num_channels;
+    if (mp_xcorr_uses_fft(s->xcorr)) {
+        best_off = mp_xcorr_best_offset_s16(s->xcorr, s->buf_pre_corr,
+                                            search_start);
+        return best_off * 2 * s->num_channels;
+    }
     for (int off = 0; off < s->frames_search; off++) {
         int64_t corr = 0;
         int16_t *ps = search_start;
@@ -438,10 +432,16 @@ static bool reinit(struct mp_filter *f)
         }
     }
 
+    TA_FREEP(&s->xcorr);
     s->frames_search = (frames_overlap > 1) ? srate * s->opts->ms_search : 0;
     if (s->frames_search <= 0)
         s->best_overlap_offset = NULL;
     else {
+        // Large search windows (many channels, high rates, big --search
+        // values) use FFT based correlation.
+        s->xcorr = mp_xcorr_create(s, MP_XCORR_AUTO,
+                                   (frames_overlap - 1) * nch,
+                                   s->frames_search, nch);
         if (use_int) {
             int64_t t = frames_overlap;
             int32_t n = 8589934588LL / (t * t); // 4 * (2^31 - 1) / t^2
@@ -496,12 +496,13 @@ static bool reinit(struct mp_filter *f)
 
     MP_DBG(f, ""
            "%.2f stride_in, %i stride_out, %i standing, "
-           "%i overlap, %i search, %i queue, %s mode\n",
+           "%i overlap, %i search%s, %i queue, %s mode\n",
            s->frames_stride_scaled,
            (int)(s->bytes_stride / nch / bps),
            (int)(s->bytes_standing / nch / bps),
            (int)(s->bytes_overlap / nch / bps),
            s->frames_search,
+           s->xcorr && mp_xcorr_uses_fft(s->xcorr) ? " (fft)" : "",
            (int)(s->bytes_queue / nch / bps),
            (use_int ? "s16" : "float"));
 
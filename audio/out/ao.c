@@ -34,6 +34,7 @@
 #include "common/msg.h"
 #include "common/common.h"
 #include "common/global.h"
+#include "common/metrics.h"
 
 extern const struct ao_driver audio_out_oss;
 extern const struct ao_driver audio_out_audiounit;
@@ -156,6 +157,8 @@ static struct ao *ao_alloc(bool probing, struct mpv_global *global,
         .log = mp_log_new(ao, log, name),
         .def_buffer = opts->audio_buffer,
         .client_name = talloc_strdup(ao, opts->audio_client_name),
+        .metric_underruns =
+            mp_metrics_get(global, "ao/underruns", MP_METRIC_COUNTER),
     };
     ao->priv = m_config_group_from_desc(ao, ao->log, global, &desc, name);
     if (!ao->priv)
@@ -652,9 +655,10 @@ void ao_set_gain(struct ao *ao, float gain)
             ((((int64_t)((d)[n]) - (center)) * (gain) + 128) >> 8) + (center),  \
             (low), (high))
 
+// (The integer bounds avoid promoting float samples to double.)
 #define MUL_GAIN_f(d, num_samples, gain)                                        \
     for (int n = 0; n < (num_samples); n++)                                     \
-        (d)[n] = MPCLAMP(((d)[n]) * (gain), -1.0, 1.0)
+        (d)[n] = MPCLAMP(((d)[n]) * (gain), -1, 1)
 
 static void process_plane(struct ao *ao, void *data, int num_samples)
 {
@@ -723,23 +727,68 @@ bool ao_need_conversion(struct ao_convert_fmt *fmt)
 #define SHIFT24(x) (((x)+1)*8)
 #endif
 
-static void convert_plane(int type, void *data, int num_samples)
+// Generic version of the 32->24 bit conversions, for the samples starting at
+// start (the ones before were handled by convert_24_fast()).
+static void convert_24_generic(int type, uint8_t *dst, const uint32_t *src,
+                               int start, int num_samples)
+{
+    int bytes = type == 1 ? 3 : 4;
+    for (int s = start; s < num_samples; s++) {
+        uint32_t val = src[s];
+        uint8_t *ptr = dst + s * bytes;
+        ptr[0] = val >> SHIFT24(0);
+        ptr[1] = val >> SHIFT24(1);
+        ptr[2] = val >> SHIFT24(2);
+        if (type == 2)
+            ptr[3] = 0;
+    }
+}
+
+// The fast paths work on whole words (and in type 1 on groups of 4 samples,
+// which pack into 3 words), so the compiler can vectorize them. dst may be
+// the same as src: a group is always read completely before it's written, and
+// the output is never ahead of the input.
+static int convert_24_fast(int type, uint8_t *dst, const uint32_t *src,
+                           int num_samples)
+{
+#if BYTE_ORDER == LITTLE_ENDIAN
+    if (type == 1) {
+        int groups = num_samples / 4;
+        for (int g = 0; g < groups; g++) {
+            const uint32_t *in = src + g * 4;
+            uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+            uint32_t out[3] = {
+                (a >> 8) | ((b >> 8) << 24),
+                (b >> 16) | ((c >> 8) << 16),
+                (c >> 24) | (d & ~(uint32_t)0xFF),
+            };
+            memcpy(dst + g * 12, out, sizeof(out));
+        }
+        return groups * 4;
+    }
+    if (type == 2) {
+        for (int s = 0; s < num_samples; s++) {
+            uint32_t val = src[s] >> 8;
+            memcpy(dst + s * 4, &val, 4);
+        }
+        return num_samples;
+    }
+#endif
+    return 0;
+}
+
+static void convert_plane(int type, void *dst, void *src, int sample_size,
+                          int num_samples)
 {
     switch (type) {
     case 0:
+        if (dst != src)
+            memcpy(dst, src, num_samples * sample_size);
         break;
     case 1: /* fall through */
     case 2: {
-        int bytes = type == 1 ? 3 : 4;
-        for (int s = 0; s < num_samples; s++) {
-            uint32_t val = *((uint32_t *)data + s);
-            uint8_t *ptr = (uint8_t *)data + s * bytes;
-            ptr[0] = val >> SHIFT24(0);
-            ptr[1] = val >> SHIFT24(1);
-            ptr[2] = val >> SHIFT24(2);
-            if (type == 2)
-                ptr[3] = 0;
-        }
+        int done = convert_24_fast(type, dst, src, num_samples);
+        convert_24_generic(type, dst, src, done, num_samples);
         break;
     }
     default:
@@ -747,15 +796,24 @@ static void convert_plane(int type, void *data, int num_samples)
     }
 }
 
-// data[n] contains the pointer to the first sample of the n-th plane, in the
-// format implied by fmt->src_fmt. src_fmt also controls whether the data is
-// all in one plane, or if there is a plane per channel.
-void ao_convert_inplace(struct ao_convert_fmt *fmt, void **data, int num_samples)
+// Like ao_convert_inplace(), but write the result to dst (whose planes can be
+// the same as src's). dst must have enough space for the target format.
+void ao_convert(struct ao_convert_fmt *fmt, void **dst, void **src,
+                int num_samples)
 {
     int type = get_conv_type(fmt);
     bool planar = af_fmt_is_planar(fmt->src_fmt);
     int planes = planar ? fmt->channels : 1;
     int plane_samples = num_samples * (planar ? 1: fmt->channels);
+    int sample_size = af_fmt_to_bytes(fmt->src_fmt);
     for (int n = 0; n < planes; n++)
-        convert_plane(type, data[n], plane_samples);
+        convert_plane(type, dst[n], src[n], sample_size, plane_samples);
+}
+
+// data[n] contains the pointer to the first sample of the n-th plane, in the
+// format implied by fmt->src_fmt. src_fmt also controls whether the data is
+// all in one plane, or if there is a plane per channel.
+void ao_convert_inplace(struct ao_convert_fmt *fmt, void **data, int num_samples)
+{
+    ao_convert(fmt, data, data, num_samples);
 }
@@ -38,6 +38,7 @@
 #include "options/m_config.h"
 #include "options/m_option.h"
 #include "common/msg.h"
+#include "common/metrics.h"
 #include "osdep/endian.h"
 
 #include <alsa/asoundlib.h>
@@ -969,6 +970,7 @@ static double get_delay(struct ao *ao)
 
     if (delay < 0) {
         /* underrun - move the application pointer forward to catch up */
+        mp_metric_add(ao->metric_underruns, 1);
         snd_pcm_forward(p->alsa, -delay);
         delay = 0;
     }
@@ -47,6 +47,7 @@ struct ao {
     struct mp_log *log; // Using e.g. "[ao/coreaudio]" as prefix
     int init_flags; // AO_INIT_* flags
     bool stream_silence;        // if audio inactive, just play silence
+    struct mp_metric *metric_underruns; // for drivers/API wrappers to update
 
     // Set by the driver on init. This is typically the period size, and the
     // smallest unit the driver will accept in one piece (although if
@@ -228,6 +229,8 @@ struct ao_convert_fmt {
 bool ao_can_convert_inplace(struct ao_convert_fmt *fmt);
 bool ao_need_conversion(struct ao_convert_fmt *fmt);
 void ao_convert_inplace(struct ao_convert_fmt *fmt, void **data, int num_samples);
+void ao_convert(struct ao_convert_fmt *fmt, void **dst, void **src,
+                int num_samples);
 
 int ao_read_data_converted(struct ao *ao, struct ao_convert_fmt *fmt,
                            void **data, int samples, int64_t out_time_us);
@@ -25,6 +25,7 @@
 
 #include "common/msg.h"
 #include "common/common.h"
+#include "common/metrics.h"
 
 #include "input/input.h"
 
@@ -153,8 +154,10 @@ int ao_read_data(struct ao *ao, void **data, int samples, int64_t out_time_us)
     int buffered_bytes = mp_ring_buffered(p->buffers[0]);
     bytes = MPMIN(buffered_bytes, full_bytes);
 
-    if (buffered_bytes < bytes && !atomic_load(&p->draining))
-        atomic_fetch_add(&p->underflow, (bytes - buffered_bytes) / ao->sstride);
+    if (buffered_bytes < full_bytes && !atomic_load(&p->draining)) {
+        atomic_fetch_add(&p->underflow, (full_bytes - buffered_bytes) / ao->sstride);
+        mp_metric_add(ao->metric_underruns, 1);
+    }
 
     if (bytes > 0)
         atomic_store(&p->end_time_us, out_time_us);
@@ -204,7 +207,6 @@ int ao_read_data_converted(struct ao *ao, struct ao_convert_fmt *fmt,
     int planes = planar ? fmt->channels : 1;
     int plane_samples = samples * (planar ? 1: fmt->channels);
     int src_plane_size = plane_samples * af_fmt_to_bytes(fmt->src_fmt);
-    int dst_plane_size = plane_samples * fmt->dst_bits / 8;
 
     int needed = src_plane_size * planes;
     if (needed > talloc_get_size(p->convert_buffer) || !p->convert_buffer) {
@@ -217,9 +219,8 @@ int ao_read_data_converted(struct ao *ao, struct ao_convert_fmt *fmt,
 
     int res = ao_read_data(ao, ndata, samples, out_time_us);
 
-    ao_convert_inplace(fmt, ndata, samples);
-    for (int n = 0; n < planes; n++)
-        memcpy(data[n], ndata[n], dst_plane_size);
+    // Write the converted samples directly to the driver's buffer.
+    ao_convert(fmt, data, ndata, samples);
 
     return res;
 }
@@ -293,6 +293,14 @@ static void ao_play_data(struct ao *ao)
         samples = realloc_silence(ao, space) ? space : 0;
     } else {
         mp_audio_buffer_peek(p->buffer, &planes, &samples);
+        // If the data to write wraps around the end of the ring buffer, make
+        // it contiguous, so it can be written in one go with period alignment.
+        // This happens at most once per pass through the buffer.
+        int avail = MPMIN(mp_audio_buffer_samples(p->buffer), space);
+        if (samples < avail) {
+            mp_audio_buffer_linearize(p->buffer);
+            mp_audio_buffer_peek(p->buffer, &planes, &samples);
+        }
     }
     int max = samples;
     if (samples > space)
@@ -0,0 +1,211 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libavcodec/avfft.h>
+#include <libavutil/mem.h>
+
+#include "common/common.h"
+
+#include "xcorr.h"
+
+// Rough number of operations per sample and log2(size) of a real FFT, relative
+// to a multiply-add in the (vectorized) direct search loop. The FFT path needs
+// 3 transforms per search, and is only worth it for large search windows.
+#define FFT_COST_FACTOR 16
+
+struct mp_xcorr {
+    int ref_len;
+    int num_offsets;
+    int stride;
+
+    // FFT path
+    int fft_bits;
+    RDFTContext *fwd, *inv;
+    FFTSample *fft_ref;     // reversed ref, zero padded
+    FFTSample *fft_search;  // search, zero padded
+};
+
+static void destroy_xcorr(void *p)
+{
+    struct mp_xcorr *c = p;
+
+    if (c->fwd)
+        av_rdft_end(c->fwd);
+    if (c->inv)
+        av_rdft_end(c->inv);
+    av_free(c->fft_ref);
+    av_free(c->fft_search);
+}
+
+struct mp_xcorr *mp_xcorr_create(void *ta_parent, enum mp_xcorr_mode mode,
+                                 int ref_len, int num_offsets, int stride)
+{
+    assert(ref_len > 0 && num_offsets > 0 && stride > 0);
+
+    struct mp_xcorr *c = talloc_zero(ta_parent, struct mp_xcorr);
+    talloc_set_destructor(c, destroy_xcorr);
+    c->ref_len = ref_len;
+    c->num_offsets = num_offsets;
+    c->stride = stride;
+
+    // Circular convolution of size N gives the wanted linear correlation
+    // values as long as N covers the whole search signal.
+    int search_len = ref_len + (num_offsets - 1) * stride;
+    int bits = 4; // minimum size supported by av_rdft_init()
+    while ((1 << bits) < search_len)
+        bits++;
+    int size = 1 << bits;
+
+    if (mode == MP_XCORR_AUTO) {
+        double direct = (double)num_offsets * ref_len;
+        double fft = (double)FFT_COST_FACTOR * size * bits;
+        mode = direct > fft ? MP_XCORR_FFT : MP_XCORR_DIRECT;
+    }
+
+    if (mode == MP_XCORR_FFT && bits <= 16) { // maximum size likewise
+        c->fwd = av_rdft_init(bits, DFT_R2C);
+        c->inv = av_rdft_init(bits, IDFT_C2R);
+        c->fft_ref = av_malloc_array(size, sizeof(FFTSample));
+        c->fft_search = av_malloc_array(size, sizeof(FFTSample));
+        if (c->fwd && c->inv && c->fft_ref && c->fft_search) {
+            c->fft_bits = bits;
+        } else {
+            // Fall back to the direct search.
+            destroy_xcorr(c);
+            *c = (struct mp_xcorr){ref_len, num_offsets, stride};
+        }
+    }
+
+    return c;
+}
+
+bool mp_xcorr_uses_fft(struct mp_xcorr *c)
+{
+    return c->fft_bits > 0;
+}
+
+float mp_xcorr_dot(const float *a, const float *b, int len)
+{
+    // Independent accumulators, so the compiler can vectorize the inner loop
+    // and the adds don't form one long dependency chain.
+    float acc[8] = {0};
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        for (int j = 0; j < 8; j++)
+            acc[j] += a[i + j] * b[i + j];
+    }
+    float sum = 0;
+    for (; i < len; i++)
+        sum += a[i] * b[i];
+    for (int j = 0; j < 8; j++)
+        sum += acc[j];
+    return sum;
+}
+
+static int best_offset_direct(struct mp_xcorr *c, const float *ref,
+                              const float *search)
+{
+    float best_corr = -INFINITY;
+    int best_off = 0;
+
+    for (int off = 0; off < c->num_offsets; off++) {
+        float corr = mp_xcorr_dot(ref, search + off * c->stride, c->ref_len);
+        if (corr > best_corr) {
+            best_corr = corr;
+            best_off = off;
+        }
+    }
+
+    return best_off;
+}
+
+// Expects fft_ref and fft_search to be filled. The correlation is computed as
+// convolution with the reversed reference, so the sign convention of the
+// transform doesn't matter. The result is scaled, which doesn't matter either.
+static int best_offset_fft(struct mp_xcorr *c)
+{
+    int size = 1 << c->fft_bits;
+    FFTSample *r = c->fft_ref;
+    FFTSample *s = c->fft_search;
+
+    av_rdft_calc(c->fwd, r);
+    av_rdft_calc(c->fwd, s);
+
+    // Packed format: DC and Nyquist are real and stored in [0] and [1].
+    s[0] *= r[0];
+    s[1] *= r[1];
+    for (int i = 2; i < size; i += 2) {
+        FFTSample re = s[i] * r[i] - s[i + 1] * r[i + 1];
+        FFTSample im = s[i] * r[i + 1] + s[i + 1] * r[i];
+        s[i] = re;
+        s[i + 1] = im;
+    }
+
+    av_rdft_calc(c->inv, s);
+
+    // correlation at offset n is convolution at n * stride + ref_len - 1
+    float best_corr = -INFINITY;
+    int best_off = 0;
+    FFTSample *res = s + c->ref_len - 1;
+    for (int off = 0; off < c->num_offsets; off++) {
+        float corr = res[off * c->stride];
+        if (corr > best_corr) {
+            best_corr = corr;
+            best_off = off;
+        }
+    }
+
+    return best_off;
+}
+
+#define LOAD_FFT_INPUT(c, ref, search) do {                                 \
+        int size_ = 1 << (c)->fft_bits;                                     \
+        int search_len_ = (c)->ref_len + ((c)->num_offsets - 1) * (c)->stride; \
+        for (int i = 0; i < (c)->ref_len; i++)                              \
+            (c)->fft_ref[i] = (ref)[(c)->ref_len - 1 - i];                  \
+        for (int i = (c)->ref_len; i < size_; i++)                          \
+            (c)->fft_ref[i] = 0;                                            \
+        for (int i = 0; i < search_len_; i++)                               \
+            (c)->fft_search[i] = (search)[i];                               \
+        for (int i = search_len_; i < size_; i++)                           \
+            (c)->fft_search[i] = 0;                                         \
+    } while (0)
+
+int mp_xcorr_best_offset(struct mp_xcorr *c, const float *ref,
+                         const float *search)
+{
+    if (!mp_xcorr_uses_fft(c))
+        return best_offset_direct(c, ref, search);
+
+    LOAD_FFT_INPUT(c, ref, search);
+    return best_offset_fft(c);
+}
+
+// Only supported with the FFT path; integer callers have their own (exact)
+// direct search.
+int mp_xcorr_best_offset_s16(struct mp_xcorr *c, const int32_t *ref,
+                             const int16_t *search)
+{
+    assert(mp_xcorr_uses_fft(c));
+
+    LOAD_FFT_INPUT(c, ref, search);
+    return best_offset_fft(c);
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_AUDIO_XCORR_H
+#define MP_AUDIO_XCORR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Search for the offset at which a reference signal correlates best with a
+// longer signal. Offsets are in units of stride samples (i.e. for interleaved
+// audio, stride is the number of channels), and the correlation at offset n is
+//      sum(ref[i] * search[n * stride + i]) for i in [0, ref_len)
+// search must hold ref_len + (num_offsets - 1) * stride samples.
+
+enum mp_xcorr_mode {
+    MP_XCORR_AUTO = 0,  // pick whichever is expected to be faster
+    MP_XCORR_DIRECT,    // brute force dot product for each offset
+    MP_XCORR_FFT,       // correlation via real FFT
+};
+
+struct mp_xcorr;
+
+struct mp_xcorr *mp_xcorr_create(void *ta_parent, enum mp_xcorr_mode mode,
+                                 int ref_len, int num_offsets, int stride);
+bool mp_xcorr_uses_fft(struct mp_xcorr *c);
+int mp_xcorr_best_offset(struct mp_xcorr *c, const float *ref,
+                         const float *search);
+int mp_xcorr_best_offset_s16(struct mp_xcorr *c, const int32_t *ref,
+                             const int16_t *search);
+
+float mp_xcorr_dot(const float *a, const float *b, int len);
+
+#endif
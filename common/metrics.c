@@ -0,0 +1,261 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include <libavutil/common.h>
+
+#include "common/common.h"
+#include "common/global.h"
+#include "misc/node.h"
+#include "mpv_talloc.h"
+#include "osdep/atomic.h"
+
+#include "metrics.h"
+
+// Counters and histograms are split into shards, and each thread updates only
+// "its" shard, so that frequently updated metrics don't bounce a single cache
+// line between threads. Reading sums all shards.
+#define NUM_SHARDS 8
+
+// Histogram buckets: values 0-3 have their own bucket, larger values are split
+// into 4 buckets per power of 2 (so a bucket's upper bound is at most 25% above
+// its lower bound). Values are clamped to UINT32_MAX.
+#define SUB_BUCKETS 4
+#define NUM_BUCKETS (4 + (32 - 2) * SUB_BUCKETS)
+
+// Per shard: count (counters) or sum (histograms), buckets (histograms only).
+// The histogram count is the sum of all buckets.
+#define SHARD_COUNT 0
+#define SHARD_SUM 0
+#define SHARD_BUCKETS 1
+
+// Keep shards on separate cache lines: each shard starts on a 64 byte boundary.
+#define CACHE_LINE 64
+#define SHARD_ALIGN (CACHE_LINE / sizeof(atomic_ullong))
+
+struct mp_metric {
+    char *name;
+    enum mp_metric_type type;
+    atomic_llong value;         // gauge value, or histogram max
+    int stride;                 // number of entries per shard in data
+    atomic_ullong *data;        // NUM_SHARDS * stride entries, aligned
+};
+
+struct mp_metrics {
+    pthread_mutex_t lock;
+    // --- protected by lock
+    struct mp_metric **metrics;
+    int num_metrics;
+};
+
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t shard_key;
+static atomic_int next_shard;
+
+static void init_shard_key(void)
+{
+    pthread_key_create(&shard_key, NULL);
+}
+
+// Return the shard index of the calling thread. Assigned round-robin on first
+// use in each thread.
+static int get_shard(void)
+{
+    pthread_once(&shard_key_once, init_shard_key);
+    uintptr_t v = (uintptr_t)pthread_getspecific(shard_key);
+    if (!v) {
+        v = atomic_fetch_add(&next_shard, 1) % NUM_SHARDS + 1;
+        pthread_setspecific(shard_key, (void *)v);
+    }
+    return v - 1;
+}
+
+static atomic_ullong *get_shard_data(struct mp_metric *m)
+{
+    return &m->data[get_shard() * m->stride];
+}
+
+static int bucket_index(uint64_t v)
+{
+    if (v < 4)
+        return v;
+    uint32_t v32 = MPMIN(v, UINT32_MAX);
+    int e = av_log2(v32);
+    int sub = (v32 >> (e - 2)) & (SUB_BUCKETS - 1);
+    return 4 + (e - 2) * SUB_BUCKETS + sub;
+}
+
+// Largest value that falls into the given bucket.
+static uint64_t bucket_max(int idx)
+{
+    if (idx < 4)
+        return idx;
+    if (idx == NUM_BUCKETS - 1)
+        return UINT32_MAX;
+    idx += 1;
+    int e = (idx - 4) / SUB_BUCKETS + 2;
+    int sub = (idx - 4) % SUB_BUCKETS;
+    return ((uint64_t)(SUB_BUCKETS + sub) << (e - 2)) - 1;
+}
+
+static void destroy_metrics(void *p)
+{
+    struct mp_metrics *metrics = p;
+    pthread_mutex_destroy(&metrics->lock);
+}
+
+struct mp_metrics *mp_metrics_create(void *ta_parent)
+{
+    struct mp_metrics *metrics = talloc_zero(ta_parent, struct mp_metrics);
+    talloc_set_destructor(metrics, destroy_metrics);
+    pthread_mutex_init(&metrics->lock, NULL);
+    return metrics;
+}
+
+struct mp_metric *mp_metrics_get(struct mpv_global *global, const char *name,
+                                 enum mp_metric_type type)
+{
+    struct mp_metrics *metrics = global ? global->metrics : NULL;
+    if (!metrics)
+        return NULL;
+
+    struct mp_metric *m = NULL;
+
+    pthread_mutex_lock(&metrics->lock);
+
+    for (int n = 0; n < metrics->num_metrics; n++) {
+        if (strcmp(metrics->metrics[n]->name, name) == 0) {
+            m = metrics->metrics[n];
+            if (m->type != type)
+                m = NULL;
+            goto done;
+        }
+    }
+
+    m = talloc_zero(metrics, struct mp_metric);
+    m->name = talloc_strdup(m, name);
+    m->type = type;
+    if (type != MP_METRIC_GAUGE) {
+        int entries = SHARD_BUCKETS;
+        if (type == MP_METRIC_HISTOGRAM)
+            entries += NUM_BUCKETS;
+        m->stride = MP_ALIGN_UP(entries, SHARD_ALIGN);
+        char *alloc = talloc_zero_size(m, NUM_SHARDS * m->stride *
+                                          sizeof(atomic_ullong) + CACHE_LINE - 1);
+        m->data = (atomic_ullong *)MP_ALIGN_UP((uintptr_t)alloc, CACHE_LINE);
+    }
+    MP_TARRAY_APPEND(metrics, metrics->metrics, metrics->num_metrics, m);
+
+done:
+    pthread_mutex_unlock(&metrics->lock);
+    return m;
+}
+
+void mp_metric_add(struct mp_metric *m, int64_t v)
+{
+    if (!m)
+        return;
+    assert(m->type == MP_METRIC_COUNTER);
+    atomic_fetch_add(&get_shard_data(m)[SHARD_COUNT], v);
+}
+
+void mp_metric_set(struct mp_metric *m, int64_t v)
+{
+    if (!m)
+        return;
+    assert(m->type == MP_METRIC_GAUGE);
+    atomic_store(&m->value, v);
+}
+
+void mp_metric_record(struct mp_metric *m, int64_t v)
+{
+    if (!m)
+        return;
+    assert(m->type == MP_METRIC_HISTOGRAM);
+    v = MPMAX(v, 0);
+    atomic_ullong *s = get_shard_data(m);
+    atomic_fetch_add(&s[SHARD_SUM], v);
+    atomic_fetch_add(&s[SHARD_BUCKETS + bucket_index(v)], 1);
+    long long max = atomic_load(&m->value);
+    while (v > max && !atomic_compare_exchange_strong(&m->value, &max, v)) {}
+}
+
+static uint64_t sum_shards(struct mp_metric *m, int index)
+{
+    uint64_t r = 0;
+    for (int n = 0; n < NUM_SHARDS; n++)
+        r += atomic_load(&m->data[n * m->stride + index]);
+    return r;
+}
+
+static void add_histogram(struct mp_metric *m, struct mpv_node *dst)
+{
+    uint64_t buckets[NUM_BUCKETS];
+    uint64_t count = 0;
+    for (int n = 0; n < NUM_BUCKETS; n++) {
+        buckets[n] = sum_shards(m, SHARD_BUCKETS + n);
+        count += buckets[n];
+    }
+    int64_t max = atomic_load(&m->value);
+
+    node_map_add_int64(dst, "count", count);
+    node_map_add_int64(dst, "sum", sum_shards(m, SHARD_SUM));
+    node_map_add_int64(dst, "max", max);
+
+    static const struct { const char *name; int permille; } pct[] = {
+        {"p50", 500}, {"p90", 900}, {"p99", 990},
+    };
+    for (int i = 0; i < MP_ARRAY_SIZE(pct); i++) {
+        uint64_t target = (count * pct[i].permille + 999) / 1000;
+        uint64_t seen = 0;
+        int64_t val = 0;
+        for (int n = 0; n < NUM_BUCKETS && count; n++) {
+            seen += buckets[n];
+            if (seen >= target) {
+                val = MPMIN(bucket_max(n), max);
+                break;
+            }
+        }
+        node_map_add_int64(dst, pct[i].name, val);
+    }
+}
+
+void mp_metrics_get_node(struct mp_metrics *metrics, struct mpv_node *dst)
+{
+    node_init(dst, MPV_FORMAT_NODE_MAP, NULL);
+
+    pthread_mutex_lock(&metrics->lock);
+
+    for (int n = 0; n < metrics->num_metrics; n++) {
+        struct mp_metric *m = metrics->metrics[n];
+        switch (m->type) {
+        case MP_METRIC_COUNTER:
+            node_map_add_int64(dst, m->name, sum_shards(m, SHARD_COUNT));
+            break;
+        case MP_METRIC_GAUGE:
+            node_map_add_int64(dst, m->name, atomic_load(&m->value));
+            break;
+        case MP_METRIC_HISTOGRAM:
+            add_histogram(m, node_map_add(dst, m->name, MPV_FORMAT_NODE_MAP));
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&metrics->lock);
+}
@@ -0,0 +1,41 @@
+#ifndef MP_METRICS_H_
+#define MP_METRICS_H_
+
+#include <stdint.h>
+
+struct mpv_global;
+struct mpv_node;
+struct mp_metrics;
+struct mp_metric;
+
+enum mp_metric_type {
+    MP_METRIC_COUNTER,      // monotonically increasing sum (mp_metric_add())
+    MP_METRIC_GAUGE,        // last set value (mp_metric_set())
+    MP_METRIC_HISTOGRAM,    // distribution of values (mp_metric_record())
+};
+
+// Create the registry. Typically there is only one, in mpv_global.metrics.
+struct mp_metrics *mp_metrics_create(void *ta_parent);
+
+// Return the metric with the given name, creating it if it does not exist yet.
+// The returned pointer stays valid until the registry is destroyed, so callers
+// should look it up once and keep it. Returns NULL if there is no registry, or
+// the name was already registered with a different type. All mp_metric_*
+// functions are no-ops if passed NULL.
+// By convention, names are "subsystem/what", and time values are in
+// microseconds with a "-us" suffix.
+struct mp_metric *mp_metrics_get(struct mpv_global *global, const char *name,
+                                 enum mp_metric_type type);
+
+// The following functions are thread-safe and lock-free.
+void mp_metric_add(struct mp_metric *m, int64_t v);
+void mp_metric_set(struct mp_metric *m, int64_t v);
+void mp_metric_record(struct mp_metric *m, int64_t v);
+
+// Snapshot of all metrics as MPV_FORMAT_NODE_MAP, with the metric names as
+// keys. Counters and gauges map to integers, histograms to a map with the
+// fields "count", "sum", "max", "p50", "p90" and "p99" (percentiles are
+// approximate: at most 25% too high).
+void mp_metrics_get_node(struct mp_metrics *metrics, struct mpv_node *dst);
+
+#endif
@@ -18,11 +18,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <math.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <inttypes.h>
 
 #include "mpv_talloc.h"
 
@@ -35,6 +37,7 @@
 #include "options/options.h"
 #include "options/path.h"
 #include "osdep/terminal.h"
+#include "osdep/threads.h"
 #include "osdep/io.h"
 #include "osdep/timer.h"
 
@@ -61,8 +64,11 @@ struct mp_log_root {
     int num_buffers;
     FILE *log_file;
     FILE *stats_file;
+    FILE *trace_file;
     char *log_path;
     char *stats_path;
+    char *trace_path;
+    int trace_generation; // incremented each time a new trace file is started
     // --- must be accessed atomically
     /* This is incremented every time the msglevels must be reloaded.
      * (This is perhaps better than maintaining a globally accessible and
@@ -70,8 +76,21 @@ struct mp_log_root {
     atomic_ulong reload_counter;
     // --- protected by mp_msg_lock
     bstr buffer;
+    // Lines for log_file and trace_file, written by log_file_thread. If the
+    // thread is not running, lines are written directly.
+    bool log_file_thread_running;
+    bool log_file_terminate;
+    pthread_t log_file_thread;
+    pthread_cond_t log_file_wakeup;
+    bstr log_file_queue;
+    uint64_t log_file_dropped;  // lines dropped because the queue was full
+    bstr trace_file_queue;
+    uint64_t trace_file_dropped;
 };
 
+// If more than this is queued for a file, drop further lines.
+#define LOG_FILE_QUEUE_SIZE (4 * 1024 * 1024)
+
 struct mp_log {
     struct mp_log_root *root;
     const char *prefix;
@@ -121,7 +140,7 @@ static void update_loglevel(struct mp_log *log)
         log->level = MPMAX(log->level, log->root->buffers[n]->level);
     if (log->root->log_file)
         log->level = MPMAX(log->level, MSGL_DEBUG);
-    if (log->root->stats_file)
+    if (log->root->stats_file || log->root->trace_file)
         log->level = MPMAX(log->level, MSGL_STATS);
     atomic_store(&log->reload_counter, atomic_load(&log->root->reload_counter));
     pthread_mutex_unlock(&mp_msg_lock);
@@ -288,11 +307,123 @@ static void write_log_file(struct mp_log *log, int lev, char *text)
     if (!root->log_file || lev > MPMAX(MSGL_DEBUG, log->terminal_level))
         return;
 
-    fprintf(root->log_file, "[%8.3f][%c][%s] %s",
-            (mp_time_us() - MP_START_TIME) / 1e6,
-            mp_log_levels[lev][0],
-            log->verbose_prefix, text);
-    fflush(root->log_file);
+    double time = (mp_time_us() - MP_START_TIME) / 1e6;
+    const char *fmt = "[%8.3f][%c][%s] %s";
+
+    if (!root->log_file_thread_running) {
+        fprintf(root->log_file, fmt, time, mp_log_levels[lev][0],
+                log->verbose_prefix, text);
+        fflush(root->log_file);
+        return;
+    }
+
+    if (root->log_file_queue.len >= LOG_FILE_QUEUE_SIZE) {
+        root->log_file_dropped++;
+        return;
+    }
+
+    bstr_xappend_asprintf(NULL, &root->log_file_queue, fmt, time,
+                          mp_log_levels[lev][0], log->verbose_prefix, text);
+    pthread_cond_signal(&root->log_file_wakeup);
+}
+
+// Swap *queue with the (emptied) spare buffer *buf, so the queue can be
+// refilled while *buf is written.
+static void take_queue(bstr *queue, bstr *buf)
+{
+    bstr queued = *queue;
+    *queue = (bstr){buf->start, 0};
+    *buf = queued;
+}
+
+// Write queued log and trace file lines in batches, so that threads which log
+// don't wait for disk I/O (and hold mp_msg_lock while doing so).
+static void *log_file_thread(void *p)
+{
+    struct mp_log_root *root = p;
+
+    mpthread_set_name("log-file");
+
+    bstr log_buf = {0}, trace_buf = {0};
+
+    pthread_mutex_lock(&mp_msg_lock);
+
+    while (1) {
+        if (root->log_file_queue.len || root->log_file_dropped ||
+            root->trace_file_queue.len || root->trace_file_dropped)
+        {
+            take_queue(&root->log_file_queue, &log_buf);
+            take_queue(&root->trace_file_queue, &trace_buf);
+            uint64_t log_dropped = root->log_file_dropped;
+            uint64_t trace_dropped = root->trace_file_dropped;
+            root->log_file_dropped = root->trace_file_dropped = 0;
+            FILE *log_f = root->log_file;
+            FILE *trace_f = root->trace_file;
+            pthread_mutex_unlock(&mp_msg_lock);
+
+            int64_t now = mp_time_us();
+            if (log_f && (log_buf.len || log_dropped)) {
+                fwrite(log_buf.start, log_buf.len, 1, log_f);
+                if (log_dropped) {
+                    fprintf(log_f, "[%8.3f][w][log] %"PRIu64" log messages "
+                            "dropped (log file writing too slow)\n",
+                            (now - MP_START_TIME) / 1e6, log_dropped);
+                }
+                fflush(log_f);
+            }
+            if (trace_f && (trace_buf.len || trace_dropped)) {
+                fwrite(trace_buf.start, trace_buf.len, 1, trace_f);
+                if (trace_dropped) {
+                    fprintf(trace_f, "{\"name\":\"%"PRIu64" trace events "
+                            "dropped\",\"ph\":\"i\",\"ts\":%"PRId64","
+                            "\"pid\":1,\"tid\":0,\"s\":\"g\"},\n",
+                            trace_dropped, now);
+                }
+                fflush(trace_f);
+            }
+
+            pthread_mutex_lock(&mp_msg_lock);
+            continue;
+        }
+        if (root->log_file_terminate)
+            break;
+        pthread_cond_wait(&root->log_file_wakeup, &mp_msg_lock);
+    }
+
+    root->log_file_thread_running = false;
+
+    pthread_mutex_unlock(&mp_msg_lock);
+
+    talloc_free(log_buf.start);
+    talloc_free(trace_buf.start);
+    return NULL;
+}
+
+static void start_log_file_thread(struct mp_log_root *root)
+{
+    pthread_mutex_lock(&mp_msg_lock);
+    if ((root->log_file || root->trace_file) &&
+        !root->log_file_thread_running)
+    {
+        root->log_file_terminate = false;
+        root->log_file_thread_running =
+            !pthread_create(&root->log_file_thread, NULL, log_file_thread, root);
+    }
+    pthread_mutex_unlock(&mp_msg_lock);
+}
+
+// Write all queued lines and stop the thread. Lines are written directly until
+// start_log_file_thread() is called again.
+static void stop_log_file_thread(struct mp_log_root *root)
+{
+    pthread_mutex_lock(&mp_msg_lock);
+    bool running = root->log_file_thread_running;
+    root->log_file_terminate = true;
+    pthread_cond_signal(&root->log_file_wakeup);
+    pthread_mutex_unlock(&mp_msg_lock);
+
+    if (running)
+        pthread_join(root->log_file_thread, NULL);
 }
 
 static void write_msg_to_buffers(struct mp_log *log, int lev, char *text)
@@ -337,6 +468,118 @@ static void dump_stats(struct mp_log *log, int lev, char *text)
         fprintf(root->stats_file, "%"PRId64" %s\n", mp_time_us(), text);
 }
 
+// Per-thread state for --dump-trace. Process-wide, so thread IDs are unique
+// across mpv instances.
+struct trace_thread {
+    int tid;
+    int generation;     // trace_generation the name was written for
+    char name[64];      // last written thread name
+};
+
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static int trace_next_tid; // protected by mp_msg_lock
+
+static void init_trace_key(void)
+{
+    pthread_key_create(&trace_key, free);
+}
+
+// Append s as JSON string contents. The names are from MP_STATS() calls, so
+// just replace anything that would need escaping.
+static void write_trace_str(bstr *dst, const char *s, size_t len)
+{
+    size_t start = dst->len;
+    bstr_xappend(NULL, dst, (bstr){(char *)s, len});
+    for (size_t n = start; n < dst->len; n++) {
+        unsigned char c = dst->start[n];
+        if (c == '"' || c == '\\' || c < 32)
+            dst->start[n] = '_';
+    }
+}
+
+// Write MP_STATS() events as Chrome trace events ("JSON Array Format", see
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU).
+// The event formats are the same as with --dump-stats.
+static void dump_trace(struct mp_log *log, int lev, char *text)
+{
+    struct mp_log_root *root = log->root;
+    if (lev != MSGL_STATS || !root->trace_file)
+        return;
+
+    bstr *f = &root->trace_file_queue;
+    if (f->len >= LOG_FILE_QUEUE_SIZE) {
+        root->trace_file_dropped++;
+        return;
+    }
+
+    int64_t ts = mp_time_us();
+
+    pthread_once(&trace_key_once, init_trace_key);
+    struct trace_thread *t = pthread_getspecific(trace_key);
+    if (!t) {
+        t = calloc(1, sizeof(*t));
+        if (!t)
+            return;
+        t->tid = ++trace_next_tid;
+        pthread_setspecific(trace_key, t);
+    }
+
+    char tmp[32];
+    const char *name = mpthread_get_name();
+    if (!name) {
+        snprintf(tmp, sizeof(tmp), "thread %d", t->tid);
+        name = tmp;
+    }
+    if (t->generation != root->trace_generation || strcmp(t->name, name) != 0) {
+        snprintf(t->name, sizeof(t->name), "%s", name);
+        t->generation = root->trace_generation;
+        bstr_xappend_asprintf(NULL, f, "{\"name\":\"thread_name\",\"ph\":\"M\","
+                              "\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                              t->tid);
+        write_trace_str(f, t->name, strlen(t->name));
+        bstr_xappend(NULL, f, bstr0("\"}},\n"));
+    }
+
+    bstr s = bstr0(text);
+    bstr_eatend0(&s, "\n");
+    const char *ph = "i";
+    double value = 0;
+    if (bstr_eatstart0(&s, "start ")) {
+        ph = "B";
+    } else if (bstr_eatstart0(&s, "end ")) {
+        ph = "E";
+    } else if (bstr_eatstart0(&s, "value ")) {
+        bstr rest;
+        value = bstrtod(s, &rest);
+        s = bstr_strip(rest);
+        ph = "C";
+    } else {
+        bstr_eatstart0(&s, "signal ");
+    }
+
+    bstr_xappend(NULL, f, bstr0("{\"name\":\""));
+    write_trace_str(f, s.start, s.len);
+    bstr_xappend(NULL, f, bstr0("\",\"cat\":\""));
+    write_trace_str(f, log->verbose_prefix, strlen(log->verbose_prefix));
+    bstr_xappend_asprintf(NULL, f, "\",\"ph\":\"%s\",\"ts\":%"PRId64","
+                          "\"pid\":1,\"tid\":%d", ph, ts, t->tid);
+    if (ph[0] == 'C') {
+        bstr_xappend_asprintf(NULL, f, ",\"args\":{\"value\":%f}",
+                              isfinite(value) ? value : 0);
+    } else if (ph[0] == 'i') {
+        bstr_xappend(NULL, f, bstr0(",\"s\":\"t\""));
+    }
+    bstr_xappend(NULL, f, bstr0("},\n"));
+
+    if (root->log_file_thread_running) {
+        pthread_cond_signal(&root->log_file_wakeup);
+    } else {
+        fwrite(f->start, f->len, 1, root->trace_file);
+        f->len = 0;
+    }
+}
+
 void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 {
     if (!mp_msg_test(log, lev))
@@ -358,6 +601,7 @@ void mp_msg_va(struct mp_log *log, int lev, const char *format, va_list va)
 
     if (lev == MSGL_STATS) {
         dump_stats(log, lev, text);
+        dump_trace(log, lev, text);
     } else if (lev == MSGL_STATUS && !test_terminal_level(log, lev)) {
         /* discard */
     } else {
@@ -455,6 +699,7 @@ void mp_msg_init(struct mpv_global *global)
         .global = global,
         .reload_counter = ATOMIC_VAR_INIT(1),
     };
+    pthread_cond_init(&root->log_file_wakeup, NULL);
 
     struct mp_log dummy = { .root = root };
     struct mp_log *log = mp_log_new(root, &dummy, "");
@@ -465,11 +710,14 @@ void mp_msg_init(struct mpv_global *global)
 }
 
 // If opt is different from *current_path, reopen *file and update *current_path.
-// If there's an error, _append_ it to err_buf.
+// If there's an error, _append_ it to err_buf. Returns whether the file was
+// replaced. If stop_log_thread is set, the log file thread is stopped before
+// replacing the file (the caller restarts it).
 // *current_path and *file are, rather trickily, only accessible under the
 // mp_msg_lock.
-static void reopen_file(char *opt, char **current_path, FILE **file,
-                        const char *type, struct mpv_global *global)
+static bool reopen_file(char *opt, char **current_path, FILE **file,
+                        const char *type, struct mpv_global *global,
+                        bool stop_log_thread)
 {
     void *tmp = talloc_new(NULL);
     bool fail = false;
@@ -481,7 +729,17 @@ static void reopen_file(char *opt, char **current_path, FILE **file,
     pthread_mutex_lock(&mp_msg_lock); // for *current_path/*file
 
     char *old_path = *current_path ? *current_path : "";
-    if (strcmp(old_path, new_path) != 0) {
+    bool changed = strcmp(old_path, new_path) != 0;
+
+    // The thread uses the file without holding the lock. *current_path is
+    // only changed by this function, so it's fine to unlock in between.
+    if (changed && stop_log_thread) {
+        pthread_mutex_unlock(&mp_msg_lock);
+        stop_log_file_thread(global->log->root);
+        pthread_mutex_lock(&mp_msg_lock);
+    }
+
+    if (changed) {
         if (*file)
             fclose(*file);
         *file = NULL;
@@ -499,6 +757,7 @@ static void reopen_file(char *opt, char **current_path, FILE **file,
         mp_err(global->log, "Failed to open %s file '%s'\n", type, new_path);
 
     talloc_free(tmp);
+    return changed;
 }
 
 void mp_msg_update_msglevels(struct mpv_global *global)
@@ -528,11 +787,29 @@ void mp_msg_update_msglevels(struct mpv_global *global)
     atomic_fetch_add(&root->reload_counter, 1);
     pthread_mutex_unlock(&mp_msg_lock);
 
-    reopen_file(opts->log_file, &root->log_path, &root->log_file,
-                "log", global);
+    bool restart = reopen_file(opts->log_file, &root->log_path,
+                               &root->log_file, "log", global, true);
 
     reopen_file(opts->dump_stats, &root->stats_path, &root->stats_file,
-                "stats", global);
+                "stats", global, false);
+
+    bool new_trace = reopen_file(opts->dump_trace, &root->trace_path,
+                                 &root->trace_file, "trace", global, true);
+
+    pthread_mutex_lock(&mp_msg_lock);
+    // Newly opened file. (The format allows omitting the closing "]", so
+    // nothing needs to be written when closing it.) The log file thread was
+    // stopped by reopen_file(), so nothing else writes to it yet.
+    if (new_trace && root->trace_file) {
+        fprintf(root->trace_file, "[\n");
+        root->trace_generation++;
+    }
+    // Make sure log levels pick up the opened stats/trace files.
+    atomic_fetch_add(&root->reload_counter, 1);
+    pthread_mutex_unlock(&mp_msg_lock);
+
+    if (restart || new_trace)
+        start_log_file_thread(root);
 }
 
 void mp_msg_force_stderr(struct mpv_global *global, bool force_stderr)
@@ -558,11 +835,18 @@ bool mp_msg_has_log_file(struct mpv_global *global)
 void mp_msg_uninit(struct mpv_global *global)
 {
     struct mp_log_root *root = global->log->root;
+    stop_log_file_thread(root);
     if (root->stats_file)
         fclose(root->stats_file);
     talloc_free(root->stats_path);
+    if (root->trace_file)
+        fclose(root->trace_file);
+    talloc_free(root->trace_path);
     if (root->log_file)
         fclose(root->log_file);
+    talloc_free(root->log_file_queue.start);
+    talloc_free(root->trace_file_queue.start);
+    pthread_cond_destroy(&root->log_file_wakeup);
     talloc_free(root->log_path);
     m_option_type_msglevels.free(&root->msg_levels);
     talloc_free(root);
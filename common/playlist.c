@@ -30,6 +30,7 @@
 struct playlist_entry *playlist_entry_new(const char *filename)
 {
     struct playlist_entry *e = talloc_zero(NULL, struct playlist_entry);
+    e->pl_index = -1;
     char *local_filename = mp_file_url_to_filename(e, bstr0(filename));
     e->filename = local_filename ? local_filename : talloc_strdup(e, filename);
     return e;
@@ -49,17 +50,20 @@ void playlist_entry_add_params(struct playlist_entry *e,
         playlist_entry_add_param(e, params[n].name, params[n].value);
 }
 
-// Add entry "add" after entry "after".
-// If "after" is NULL, add as first entry.
-// Post condition: add->prev == after
-void playlist_insert(struct playlist *pl, struct playlist_entry *after,
-                     struct playlist_entry *add)
+// Set pl_index of the entries in the range [start, end). end<0 means all
+// entries starting with start.
+static void playlist_update_indexes(struct playlist *pl, int start, int end)
+{
+    start = MPMAX(start, 0);
+    end = end < 0 ? pl->num_entries : MPMIN(end, pl->num_entries);
+    for (int n = start; n < end; n++)
+        pl->entries[n]->pl_index = n;
+}
+
+// Link add after "after" (or as first entry if NULL); doesn't touch entries[].
+static void link_entry(struct playlist *pl, struct playlist_entry *after,
+                       struct playlist_entry *add)
 {
-    assert(pl && add->pl == NULL && add->next == NULL && add->prev == NULL);
-    if (after) {
-        assert(after->pl == pl);
-        assert(pl->first && pl->last);
-    }
     add->prev = after;
     if (after) {
         add->next = after->next;
@@ -74,18 +78,11 @@ void playlist_insert(struct playlist *pl, struct playlist_entry *after,
         pl->last = add;
     }
     add->pl = pl;
-    talloc_steal(pl, add);
-}
-
-void playlist_add(struct playlist *pl, struct playlist_entry *add)
-{
-    playlist_insert(pl, pl->last, add);
 }
 
-static void playlist_unlink(struct playlist *pl, struct playlist_entry *entry)
+// Inverse of link_entry(); also updates pl->current.
+static void unlink_entry(struct playlist *pl, struct playlist_entry *entry)
 {
-    assert(pl && entry->pl == pl);
-
     if (pl->current == entry) {
         pl->current = entry->next;
         pl->current_was_replaced = true;
@@ -106,6 +103,41 @@ static void playlist_unlink(struct playlist *pl, struct playlist_entry *entry)
     entry->pl = NULL;
 }
 
+// Add entry "add" after entry "after".
+// If "after" is NULL, add as first entry.
+// Post condition: add->prev == after
+void playlist_insert(struct playlist *pl, struct playlist_entry *after,
+                     struct playlist_entry *add)
+{
+    assert(pl && add->pl == NULL && add->next == NULL && add->prev == NULL);
+    if (after) {
+        assert(after->pl == pl);
+        assert(pl->first && pl->last);
+    }
+    int index = after ? after->pl_index + 1 : 0;
+    link_entry(pl, after, add);
+    MP_TARRAY_INSERT_AT(pl, pl->entries, pl->num_entries, index, add);
+    playlist_update_indexes(pl, index, -1);
+    talloc_steal(pl, add);
+}
+
+void playlist_add(struct playlist *pl, struct playlist_entry *add)
+{
+    playlist_insert(pl, pl->last, add);
+}
+
+static void playlist_unlink(struct playlist *pl, struct playlist_entry *entry)
+{
+    assert(pl && entry->pl == pl);
+    assert(pl->entries[entry->pl_index] == entry);
+
+    int index = entry->pl_index;
+    unlink_entry(pl, entry);
+    MP_TARRAY_REMOVE_AT(pl->entries, pl->num_entries, index);
+    playlist_update_indexes(pl, index, -1);
+    entry->pl_index = -1;
+}
+
 void playlist_entry_unref(struct playlist_entry *e)
 {
     e->reserved--;
@@ -122,12 +154,23 @@ void playlist_remove(struct playlist *pl, struct playlist_entry *entry)
 
 void playlist_clear(struct playlist *pl)
 {
-    while (pl->first)
-        playlist_remove(pl, pl->first);
+    // (Removing from the end avoids moving the remaining entries.)
+    while (pl->last)
+        playlist_remove(pl, pl->last);
     assert(!pl->current);
     pl->current_was_replaced = false;
 }
 
+// Remove all entries, except pl->current.
+void playlist_clear_except_current(struct playlist *pl)
+{
+    for (int n = pl->num_entries - 1; n >= 0; n--) {
+        struct playlist_entry *e = pl->entries[n];
+        if (e != pl->current)
+            playlist_remove(pl, e);
+    }
+}
+
 // Moves the entry so that it takes "at"'s place (or move to end, if at==NULL).
 void playlist_move(struct playlist *pl, struct playlist_entry *entry,
                    struct playlist_entry *at)
@@ -135,11 +178,26 @@ void playlist_move(struct playlist *pl, struct playlist_entry *entry,
     if (entry == at)
         return;
 
+    assert(entry->pl == pl && (!at || at->pl == pl));
+
     struct playlist_entry *save_current = pl->current;
     bool save_replaced = pl->current_was_replaced;
 
-    playlist_unlink(pl, entry);
-    playlist_insert(pl, at ? at->prev : pl->last, entry);
+    unlink_entry(pl, entry);
+    link_entry(pl, at ? at->prev : pl->last, entry);
+
+    // Shift only the entries between the old and new position.
+    struct playlist_entry **e = pl->entries;
+    int from = entry->pl_index;
+    int to = at ? at->pl_index : pl->num_entries;
+    if (to > from) {
+        to -= 1; // index after removing entry
+        memmove(&e[from], &e[from + 1], (to - from) * sizeof(e[0]));
+    } else {
+        memmove(&e[to + 1], &e[to], (from - to) * sizeof(e[0]));
+    }
+    e[to] = entry;
+    playlist_update_indexes(pl, MPMIN(from, to), MPMAX(from, to) + 1);
 
     pl->current = save_current;
     pl->current_was_replaced = save_replaced;
@@ -150,34 +208,22 @@ void playlist_add_file(struct playlist *pl, const char *filename)
     playlist_add(pl, playlist_entry_new(filename));
 }
 
-static int playlist_count(struct playlist *pl)
-{
-    int c = 0;
-    for (struct playlist_entry *e = pl->first; e; e = e->next)
-        c++;
-    return c;
-}
-
 void playlist_shuffle(struct playlist *pl)
 {
-    struct playlist_entry *save_current = pl->current;
-    bool save_replaced = pl->current_was_replaced;
-    int count = playlist_count(pl);
-    struct playlist_entry **arr = talloc_array(NULL, struct playlist_entry *,
-                                               count);
-    for (int n = 0; n < count; n++) {
-        arr[n] = pl->first;
-        playlist_unlink(pl, pl->first);
-    }
+    struct playlist_entry **arr = pl->entries;
+    int count = pl->num_entries;
     for (int n = 0; n < count - 1; n++) {
         int j = (int)((double)(count - n) * rand() / (RAND_MAX + 1.0));
         MPSWAP(struct playlist_entry *, arr[n], arr[n + j]);
     }
-    for (int n = 0; n < count; n++)
-        playlist_add(pl, arr[n]);
-    talloc_free(arr);
-    pl->current = save_current;
-    pl->current_was_replaced = save_replaced;
+    // Relink the list in the new order.
+    for (int n = 0; n < count; n++) {
+        arr[n]->prev = n > 0 ? arr[n - 1] : NULL;
+        arr[n]->next = n < count - 1 ? arr[n + 1] : NULL;
+    }
+    pl->first = count ? arr[0] : NULL;
+    pl->last = count ? arr[count - 1] : NULL;
+    playlist_update_indexes(pl, 0, -1);
 }
 
 struct playlist_entry *playlist_get_next(struct playlist *pl, int direction)
@@ -216,6 +262,45 @@ void playlist_add_redirect(struct playlist *pl, const char *redirected_from)
     }
 }
 
+// Move all entries from source_pl to pl, inserting them after "after" (or as
+// first entries if NULL). This is the same as unlinking and inserting them one
+// by one, but O(n).
+void playlist_transfer_entries_after(struct playlist *pl,
+                                     struct playlist_entry *after,
+                                     struct playlist *source_pl)
+{
+    int count = source_pl->num_entries;
+    if (!count)
+        return;
+    assert(pl != source_pl);
+    assert(!after || after->pl == pl);
+
+    if (source_pl->current) {
+        source_pl->current = NULL;
+        source_pl->current_was_replaced = true;
+    }
+
+    int index = after ? after->pl_index + 1 : 0;
+    MP_TARRAY_GROW(pl, pl->entries, pl->num_entries + count);
+    memmove(&pl->entries[index + count], &pl->entries[index],
+            (pl->num_entries - index) * sizeof(pl->entries[0]));
+    memcpy(&pl->entries[index], source_pl->entries,
+           count * sizeof(pl->entries[0]));
+    pl->num_entries += count;
+
+    for (int n = 0; n < count; n++) {
+        struct playlist_entry *e = source_pl->entries[n];
+        e->prev = e->next = NULL;
+        link_entry(pl, after, e);
+        talloc_steal(pl, e);
+        after = e;
+    }
+    playlist_update_indexes(pl, index, -1);
+
+    source_pl->first = source_pl->last = NULL;
+    source_pl->num_entries = 0;
+}
+
 // Move all entries from source_pl to pl, appending them after the current entry
 // of pl. source_pl will be empty, and all entries have changed ownership to pl.
 void playlist_transfer_entries(struct playlist *pl, struct playlist *source_pl)
@@ -226,53 +311,33 @@ void playlist_transfer_entries(struct playlist *pl, struct playlist *source_pl)
     if (!add_after)
         add_after = pl->last;
 
-    while (source_pl->first) {
-        struct playlist_entry *e = source_pl->first;
-        playlist_unlink(source_pl, e);
-        playlist_insert(pl, add_after, e);
-        add_after = e;
-    }
+    playlist_transfer_entries_after(pl, add_after, source_pl);
 }
 
 void playlist_append_entries(struct playlist *pl, struct playlist *source_pl)
 {
-    while (source_pl->first) {
-        struct playlist_entry *e = source_pl->first;
-        playlist_unlink(source_pl, e);
-        playlist_add(pl, e);
-    }
+    playlist_transfer_entries_after(pl, pl->last, source_pl);
 }
 
 // Return number of entries between list start and e.
 // Return -1 if e is not on the list, or if e is NULL.
 int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e)
 {
-    struct playlist_entry *cur = pl->first;
-    int pos = 0;
-    if (!e)
+    if (!e || e->pl != pl)
         return -1;
-    while (cur && cur != e) {
-        cur = cur->next;
-        pos++;
-    }
-    return cur == e ? pos : -1;
+    return e->pl_index;
 }
 
 int playlist_entry_count(struct playlist *pl)
 {
-    return playlist_entry_to_index(pl, pl->last) + 1;
+    return pl->num_entries;
 }
 
 // Return entry for which playlist_entry_to_index() would return index.
 // Return NULL if not found.
 struct playlist_entry *playlist_entry_from_index(struct playlist *pl, int index)
 {
-    struct playlist_entry *e = pl->first;
-    for (int n = 0; ; n++) {
-        if (!e || n == index)
-            return e;
-        e = e->next;
-    }
+    return index >= 0 && index < pl->num_entries ? pl->entries[index] : NULL;
 }
 
 struct playlist *playlist_parse_file(const char *file, struct mpv_global *global)
@@ -28,6 +28,8 @@ struct playlist_param {
 struct playlist_entry {
     struct playlist_entry *prev, *next;
     struct playlist *pl;
+    // Position in pl->entries (-1 if pl==NULL).
+    int pl_index;
 
     char *filename;
 
@@ -64,6 +66,11 @@ struct playlist_entry {
 struct playlist {
     struct playlist_entry *first, *last;
 
+    // All entries in order (the same as following first->next...), for O(1)
+    // index lookups. Only to be changed by the playlist_* functions.
+    struct playlist_entry **entries;
+    int num_entries;
+
     // This provides some sort of stable iterator. If this entry is removed from
     // the playlist, current is set to the next element (or NULL), and
     // current_was_replaced is set to true.
@@ -85,6 +92,7 @@ void playlist_insert(struct playlist *pl, struct playlist_entry *after,
 void playlist_add(struct playlist *pl, struct playlist_entry *add);
 void playlist_remove(struct playlist *pl, struct playlist_entry *entry);
 void playlist_clear(struct playlist *pl);
+void playlist_clear_except_current(struct playlist *pl);
 
 void playlist_move(struct playlist *pl, struct playlist_entry *entry,
                    struct playlist_entry *at);
@@ -95,6 +103,9 @@ struct playlist_entry *playlist_get_next(struct playlist *pl, int direction);
 void playlist_add_base_path(struct playlist *pl, bstr base_path);
 void playlist_add_redirect(struct playlist *pl, const char *redirected_from);
 void playlist_transfer_entries(struct playlist *pl, struct playlist *source_pl);
+void playlist_transfer_entries_after(struct playlist *pl,
+                                     struct playlist_entry *after,
+                                     struct playlist *source_pl);
 void playlist_append_entries(struct playlist *pl, struct playlist *source_pl);
 
 int playlist_entry_to_index(struct playlist *pl, struct playlist_entry *e);
@@ -34,7 +34,9 @@
 #include "mpv_talloc.h"
 #include "common/msg.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "osdep/threads.h"
+#include "osdep/timer.h"
 
 #include "stream/stream.h"
 #include "demux.h"
@@ -123,6 +125,9 @@ const struct m_sub_options demux_conf = {
 struct demux_internal {
     struct mp_log *log;
 
+    struct mp_metric *metric_read_us;       // time per fill_buffer() call
+    struct mp_metric *metric_cache_bytes;   // total_bytes
+
     // The demuxer runs potentially in another thread, so we keep two demuxer
     // structs; the real demuxer can access the shadow struct only.
     // Since demuxer and user threads both don't use locks, a third demuxer
@@ -1369,12 +1374,19 @@ static bool read_packet(struct demux_internal *in)
     struct demuxer *demux = in->d_thread;
 
     bool eof = true;
-    if (demux->desc->fill_buffer && !demux_cancel_test(demux))
+    if (demux->desc->fill_buffer && !demux_cancel_test(demux)) {
+        MP_STATS(in, "start demux-read");
+        int64_t start = mp_time_us();
         eof = demux->desc->fill_buffer(demux) <= 0;
+        mp_metric_record(in->metric_read_us, mp_time_us() - start);
+        MP_STATS(in, "end demux-read");
+    }
     update_cache(in);
 
     pthread_mutex_lock(&in->lock);
 
+    mp_metric_set(in->metric_cache_bytes, in->total_bytes);
+
     if (!in->seeking) {
         if (eof) {
             for (int n = 0; n < in->num_streams; n++) {
@@ -1880,6 +1892,7 @@ static void demux_copy(struct demuxer *dst, struct demuxer *src)
         dst->num_attachments = src->num_attachments;
         dst->matroska_data = src->matroska_data;
         dst->playlist = src->playlist;
+        dst->playlist_loader = src->playlist_loader;
         dst->seekable = src->seekable;
         dst->partially_seekable = src->partially_seekable;
         dst->filetype = src->filetype;
@@ -1980,6 +1993,27 @@ static void update_final_metadata(demuxer_t *demuxer)
         mp_tags_merge(demuxer->metadata, in->stream_metadata);
 }
 
+// Move demuxer->playlist_loader to ta_parent, and unset it in all copies of the
+// demuxer, so that demux_update() doesn't bring the pointer back. Returns the
+// loader, or NULL if there is none.
+struct demux_playlist_loader *demux_steal_playlist_loader(struct demuxer *demuxer,
+                                                          void *ta_parent)
+{
+    assert(demuxer == demuxer->in->d_user);
+    struct demux_internal *in = demuxer->in;
+
+    pthread_mutex_lock(&in->lock);
+    struct demux_playlist_loader *loader = demuxer->playlist_loader;
+    demuxer->playlist_loader = NULL;
+    // (The demuxer thread reads this field only in demux_copy(), under the
+    // lock.)
+    in->d_thread->playlist_loader = NULL;
+    in->d_buffer->playlist_loader = NULL;
+    pthread_mutex_unlock(&in->lock);
+
+    return talloc_steal(ta_parent, loader);
+}
+
 // Called by the user thread (i.e. player) to update metadata and other things
 // from the demuxer thread.
 void demux_update(demuxer_t *demuxer)
@@ -2106,6 +2140,10 @@ static struct demuxer *open_given_type(struct mpv_global *global,
         .highest_av_pts = MP_NOPTS_VALUE,
         .seeking_in_progress = MP_NOPTS_VALUE,
         .demux_ts = MP_NOPTS_VALUE,
+        .metric_read_us =
+            mp_metrics_get(global, "demux/read-us", MP_METRIC_HISTOGRAM),
+        .metric_cache_bytes =
+            mp_metrics_get(global, "demux/cache-bytes", MP_METRIC_GAUGE),
     };
     pthread_mutex_init(&in->lock, NULL);
     pthread_cond_init(&in->wakeup, NULL);
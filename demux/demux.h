@@ -177,6 +177,9 @@ struct demuxer_params {
     bool initial_readahead;
     bstr init_fragment;
     bool skip_lavf_probing;
+    // Allow demux_playlist.c to read the playlist in the background (see
+    // demuxer.playlist_loader).
+    bool allow_playlist_loader;
     // -- demux_open_url() only
     int stream_flags;
     bool disable_cache;
@@ -220,6 +223,11 @@ typedef struct demuxer {
 
     // If the file is a playlist file
     struct playlist *playlist;
+    // If set, the rest of the playlist is still being read in the background,
+    // and can be fetched with demux_playlist_loader_read(). The caller can
+    // take it with demux_steal_playlist_loader() to keep it running after the
+    // demuxer is freed.
+    struct demux_playlist_loader *playlist_loader;
 
     struct mp_tags *metadata;
 
@@ -318,4 +326,12 @@ bool demux_matroska_uid_cmp(struct matroska_segment_uid *a,
 
 const char *stream_type_name(enum stream_type type);
 
+struct demux_playlist_loader;
+struct demux_playlist_loader *demux_steal_playlist_loader(struct demuxer *demuxer,
+                                                          void *ta_parent);
+bool demux_playlist_loader_read(struct demux_playlist_loader *l,
+                                struct playlist *pl);
+void demux_playlist_loader_set_wakeup_cb(struct demux_playlist_loader *l,
+                                         void (*cb)(void *ctx), void *ctx);
+
 #endif /* MPLAYER_DEMUXER_H */
@@ -19,19 +19,43 @@
 #include <string.h>
 #include <strings.h>
 #include <dirent.h>
+#include <pthread.h>
 
 #include "config.h"
 #include "common/common.h"
+#include "options/m_config.h"
 #include "options/options.h"
 #include "common/msg.h"
 #include "common/playlist.h"
 #include "options/path.h"
 #include "stream/stream.h"
 #include "osdep/io.h"
+#include "osdep/threads.h"
+#include "osdep/timer.h"
 #include "demux.h"
 
 #define PROBE_SIZE (8 * 1024)
 
+// Minimum time between passing entries read by the loader thread to the
+// player. Small playlists are read completely within the first interval.
+#define LOADER_BATCH_TIME 0.05
+
+#define OPT_BASE_STRUCT struct demux_playlist_opts
+struct demux_playlist_opts {
+    int incremental;
+};
+
+const struct m_sub_options demux_playlist_conf = {
+    .opts = (const m_option_t[]) {
+        OPT_FLAG("incremental", incremental, 0),
+        {0}
+    },
+    .size = sizeof(struct demux_playlist_opts),
+    .defaults = &(const struct demux_playlist_opts){
+        .incremental = 1,
+    },
+};
+
 static bool check_mimetype(struct stream *s, const char *const *list)
 {
     if (s->mime_type) {
@@ -56,10 +80,41 @@ struct pl_parser {
     enum demux_check check_level;
     struct stream *real_stream;
     char *format;
+    int num_added;
+    // If set, entries are passed to the loader while parsing.
+    struct demux_playlist_loader *loader;
+    double last_flush;
+};
+
+struct demux_playlist_loader {
+    struct mpv_global *global;
+    struct mp_cancel *cancel;
+    const struct pl_format *fmt;
+    char *url;
+    int stream_flags;
+    char *base_path;
+    pthread_t thread;
+
+    // --- Owned by the loader thread.
+    struct pl_parser *p;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    // --- Protected by lock.
+    struct playlist *pending; // read, but not fetched yet
+    char *format;
+    bool done;
+    bool failed;
+    void (*wakeup_cb)(void *ctx);
+    void *wakeup_cb_ctx;
 };
 
 static char *pl_get_line0(struct pl_parser *p)
 {
+    if (mp_cancel_test(p->s->cancel))
+        p->error = true;
+    if (p->error)
+        return NULL;
     char *res = stream_read_line(p->s, p->buffer, sizeof(p->buffer), p->utf16);
     if (res) {
         int len = strlen(res);
@@ -76,10 +131,42 @@ static bstr pl_get_line(struct pl_parser *p)
     return bstr0(pl_get_line0(p));
 }
 
+// Pass the entries read so far to the loader.
+static void pl_flush(struct pl_parser *p, bool done)
+{
+    struct demux_playlist_loader *l = p->loader;
+
+    if (p->add_base)
+        playlist_add_base_path(p->pl, bstr0(l->base_path));
+    p->last_flush = mp_time_sec();
+
+    pthread_mutex_lock(&l->lock);
+    playlist_append_entries(l->pending, p->pl);
+    talloc_free(l->format);
+    l->format = talloc_strdup(l, p->format);
+    l->done = done;
+    l->failed = done && p->error;
+    void (*wakeup_cb)(void *ctx) = l->wakeup_cb;
+    void *wakeup_cb_ctx = l->wakeup_cb_ctx;
+    pthread_cond_broadcast(&l->wakeup);
+    pthread_mutex_unlock(&l->lock);
+
+    if (wakeup_cb)
+        wakeup_cb(wakeup_cb_ctx);
+}
+
+static void pl_add_entry(struct pl_parser *p, struct playlist_entry *e)
+{
+    playlist_add(p->pl, e);
+    p->num_added++;
+    if (p->loader && mp_time_sec() - p->last_flush >= LOADER_BATCH_TIME)
+        pl_flush(p, false);
+}
+
 static void pl_add(struct pl_parser *p, bstr entry)
 {
     char *s = bstrto0(NULL, entry);
-    playlist_add_file(p->pl, s);
+    pl_add_entry(p, playlist_entry_new(s));
     talloc_free(s);
 }
 
@@ -137,7 +224,7 @@ ok:
             talloc_free(fn);
             e->title = talloc_steal(e, title);
             title = NULL;
-            playlist_add(p->pl, e);
+            pl_add_entry(p, e);
         }
         line = bstr_strip(pl_get_line(p));
     }
@@ -235,10 +322,24 @@ static bool same_st(struct stat *st1, struct stat *st2)
     return st1->st_dev == st2->st_dev && st1->st_ino == st2->st_ino;
 }
 
+struct dir_entry {
+    char *path;
+    // Sort key: the name, with a trailing '/' for directories. This makes
+    // sorting each directory on its own equivalent to sorting the full paths
+    // of all files in the tree, so entries can be added while scanning.
+    char *key;
+    bool is_dir;
+    struct stat st;
+};
+
+static int cmp_dir_entry(const void *a, const void *b)
+{
+    return strcmp(((struct dir_entry *)a)->key, ((struct dir_entry *)b)->key);
+}
+
 // Return true if this was a readable directory.
 static bool scan_dir(struct pl_parser *p, char *path,
-                     struct stat *dir_stack, int num_dir_stack,
-                     char ***files, int *num_files)
+                     struct stat *dir_stack, int num_dir_stack)
 {
     if (strlen(path) >= 8192 || num_dir_stack == MAX_DIR_STACK)
         return false; // things like mount bind loops
@@ -249,6 +350,10 @@ static bool scan_dir(struct pl_parser *p, char *path,
         return false;
     }
 
+    void *tmp = talloc_new(NULL);
+    struct dir_entry *entries = NULL;
+    int num_entries = 0;
+
     struct dirent *ep;
     while ((ep = readdir(dp))) {
         if (ep->d_name[0] == '.')
@@ -257,35 +362,46 @@ static bool scan_dir(struct pl_parser *p, char *path,
         if (mp_cancel_test(p->s->cancel))
             break;
 
-        char *file = mp_path_join(p, path, ep->d_name);
+        struct dir_entry e = {
+            .path = mp_path_join(tmp, path, ep->d_name),
+        };
+        e.is_dir = stat(e.path, &e.st) == 0 && S_ISDIR(e.st.st_mode);
+        e.key = talloc_asprintf(tmp, "%s%s", ep->d_name, e.is_dir ? "/" : "");
+        MP_TARRAY_APPEND(tmp, entries, num_entries, e);
+    }
+
+    closedir(dp);
+
+    if (entries)
+        qsort(entries, num_entries, sizeof(entries[0]), cmp_dir_entry);
+
+    for (int n = 0; n < num_entries; n++) {
+        struct dir_entry *e = &entries[n];
+
+        if (mp_cancel_test(p->s->cancel))
+            break;
 
-        struct stat st;
-        if (stat(file, &st) == 0 && S_ISDIR(st.st_mode)) {
-            for (int n = 0; n < num_dir_stack; n++) {
-                if (same_st(&dir_stack[n], &st)) {
-                    MP_VERBOSE(p, "Skip recursive entry: %s\n", file);
+        if (e->is_dir) {
+            for (int i = 0; i < num_dir_stack; i++) {
+                if (same_st(&dir_stack[i], &e->st)) {
+                    MP_VERBOSE(p, "Skip recursive entry: %s\n", e->path);
                     goto skip;
                 }
             }
 
-            dir_stack[num_dir_stack] = st;
-            scan_dir(p, file, dir_stack, num_dir_stack + 1, files, num_files);
+            dir_stack[num_dir_stack] = e->st;
+            scan_dir(p, e->path, dir_stack, num_dir_stack + 1);
         } else {
-            MP_TARRAY_APPEND(p, *files, *num_files, file);
+            pl_add_entry(p, playlist_entry_new(e->path));
         }
 
         skip: ;
     }
 
-    closedir(dp);
+    talloc_free(tmp);
     return true;
 }
 
-static int cmp_filename(const void *a, const void *b)
-{
-    return strcmp(*(char **)a, *(char **)b);
-}
-
 static int parse_dir(struct pl_parser *p)
 {
     if (!p->real_stream->is_directory)
@@ -297,21 +413,14 @@ static int parse_dir(struct pl_parser *p)
     if (!path)
         return -1;
 
-    char **files = NULL;
-    int num_files = 0;
-    struct stat dir_stack[MAX_DIR_STACK];
-
-    scan_dir(p, path, dir_stack, 0, &files, &num_files);
-
-    if (files)
-        qsort(files, num_files, sizeof(files[0]), cmp_filename);
+    // (Set before scanning, as the loader adds the base path while scanning.)
+    p->add_base = false;
 
-    for (int n = 0; n < num_files; n++)
-        playlist_add_file(p->pl, files[n]);
+    struct stat dir_stack[MAX_DIR_STACK];
 
-    p->add_base = false;
+    scan_dir(p, path, dir_stack, 0);
 
-    return num_files > 0 ? 0 : -1;
+    return p->num_added > 0 ? 0 : -1;
 }
 
 #define MIME_TYPES(...) \
@@ -351,6 +460,156 @@ static const struct pl_format *probe_pl(struct pl_parser *p)
     return NULL;
 }
 
+static void *loader_thread(void *arg)
+{
+    struct demux_playlist_loader *l = arg;
+    struct pl_parser *p = l->p;
+
+    mpthread_set_name("playlist");
+
+    p->s = stream_create(l->url, STREAM_READ | l->stream_flags, l->cancel,
+                         l->global);
+    if (p->s) {
+        p->real_stream = p->s;
+        p->utf16 = stream_skip_bom(p->s);
+        if (l->fmt->parse(p) < 0)
+            p->error = true;
+        free_stream(p->s);
+        p->s = NULL;
+    } else {
+        p->error = true;
+    }
+
+    pl_flush(p, true);
+    return NULL;
+}
+
+static void destroy_loader(void *ptr)
+{
+    struct demux_playlist_loader *l = ptr;
+
+    mp_cancel_trigger(l->cancel);
+    pthread_join(l->thread, NULL);
+    pthread_cond_destroy(&l->wakeup);
+    pthread_mutex_destroy(&l->lock);
+}
+
+// Move the entries read since the last call to the end of pl. Returns false
+// once all entries were read (the loader can be freed then).
+bool demux_playlist_loader_read(struct demux_playlist_loader *l,
+                                struct playlist *pl)
+{
+    pthread_mutex_lock(&l->lock);
+    playlist_append_entries(pl, l->pending);
+    bool more = !l->done;
+    pthread_mutex_unlock(&l->lock);
+    return more;
+}
+
+// cb is called from the loader thread when new entries are available.
+void demux_playlist_loader_set_wakeup_cb(struct demux_playlist_loader *l,
+                                         void (*cb)(void *ctx), void *ctx)
+{
+    pthread_mutex_lock(&l->lock);
+    l->wakeup_cb = cb;
+    l->wakeup_cb_ctx = ctx;
+    pthread_mutex_unlock(&l->lock);
+}
+
+// Whether the playlist can be read by the loader thread. It opens the file
+// again, so this works for regular files and directories only.
+static bool can_use_loader(struct demuxer *demuxer, struct pl_parser *p)
+{
+    if (!demuxer->params || !demuxer->params->allow_playlist_loader)
+        return false;
+
+    struct demux_playlist_opts *opts =
+        mp_get_config_group(NULL, demuxer->global, &demux_playlist_conf);
+    bool incremental = opts->incremental;
+    talloc_free(opts);
+    if (!incremental || !p->real_stream->is_local_file)
+        return false;
+
+    char *path = mp_file_get_path(NULL, bstr0(p->real_stream->url));
+    struct stat st;
+    bool ok = path && stat(path, &st) == 0 &&
+              (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode));
+    talloc_free(path);
+    return ok;
+}
+
+// Start reading the playlist on the loader thread, and wait until the first
+// entries are available. Returns the parse result like fmt->parse().
+static int start_loader(struct demuxer *demuxer, struct pl_parser *p,
+                        const struct pl_format *fmt)
+{
+    struct demux_playlist_loader *l = talloc_zero(demuxer, struct
+                                                  demux_playlist_loader);
+    *l = (struct demux_playlist_loader){
+        .global = demuxer->global,
+        .cancel = mp_cancel_new(l),
+        .fmt = fmt,
+        .url = talloc_strdup(l, p->real_stream->url),
+        .stream_flags = demuxer->params->stream_flags,
+        .base_path = bstrto0(l, mp_dirname(demuxer->filename)),
+        .pending = talloc_zero(l, struct playlist),
+    };
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->wakeup, NULL);
+
+    // The loader thread gets its own parser state; p->pl receives the first
+    // entries.
+    struct pl_parser *lp = talloc_zero(l, struct pl_parser);
+    *lp = (struct pl_parser){
+        .log = mp_log_new(lp, demuxer->log, NULL),
+        .pl = talloc_zero(lp, struct playlist),
+        .force = p->force,
+        .add_base = p->add_base,
+        .check_level = p->check_level,
+        .loader = l,
+        .last_flush = mp_time_sec(),
+    };
+    l->p = lp;
+
+    if (pthread_create(&l->thread, NULL, loader_thread, l)) {
+        pthread_cond_destroy(&l->wakeup);
+        pthread_mutex_destroy(&l->lock);
+        talloc_free(l);
+        return -1;
+    }
+    talloc_set_destructor(l, destroy_loader);
+
+    struct mp_cancel *cancel = demuxer->stream->cancel;
+    bool cancelled = false;
+    pthread_mutex_lock(&l->lock);
+    while (!l->done && !l->pending->first) {
+        if (mp_cancel_test(cancel)) {
+            cancelled = true;
+            break;
+        }
+        struct timespec ts = mp_rel_time_to_timespec(LOADER_BATCH_TIME);
+        pthread_cond_timedwait(&l->wakeup, &l->lock, &ts);
+    }
+    playlist_append_entries(p->pl, l->pending);
+    if (l->format)
+        p->format = talloc_strdup(demuxer, l->format);
+    bool done = l->done;
+    bool failed = l->failed || cancelled;
+    pthread_mutex_unlock(&l->lock);
+
+    // The loader added the base path already.
+    p->add_base = false;
+
+    if (done || failed) {
+        talloc_free(l);
+        return failed ? -1 : 0;
+    }
+
+    MP_VERBOSE(p, "Loading the rest of the playlist in the background.\n");
+    demuxer->playlist_loader = l;
+    return 0;
+}
+
 static int open_file(struct demuxer *demuxer, enum demux_check check)
 {
     if (!demuxer->access_references)
@@ -382,8 +641,13 @@ static int open_file(struct demuxer *demuxer, enum demux_check check)
     p->probing = false;
     p->error = false;
     p->s = demuxer->stream;
-    p->utf16 = stream_skip_bom(p->s);
-    bool ok = fmt->parse(p) >= 0 && !p->error;
+    bool ok;
+    if (can_use_loader(demuxer, p)) {
+        ok = start_loader(demuxer, p, fmt) >= 0 && !p->error;
+    } else {
+        p->utf16 = stream_skip_bom(p->s);
+        ok = fmt->parse(p) >= 0 && !p->error;
+    }
     if (p->add_base)
         playlist_add_base_path(p->pl, mp_dirname(demuxer->filename));
     demuxer->playlist = talloc_steal(demuxer, p->pl);
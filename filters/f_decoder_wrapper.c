@@ -35,6 +35,7 @@
 
 #include "common/codecs.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "common/recorder.h"
 
 #include "audio/aframe.h"
@@ -681,7 +682,7 @@ error:
     return NULL;
 }
 
-void lavc_process(struct mp_filter *f, bool *eof_flag,
+void lavc_process(struct mp_filter *f, struct lavc_state *state,
                   bool (*send)(struct mp_filter *f, struct demux_packet *pkt),
                   bool (*receive)(struct mp_filter *f, struct mp_frame *res))
 {
@@ -689,12 +690,20 @@ void lavc_process(struct mp_filter *f, bool *eof_flag,
         return;
 
     struct mp_frame frame = {0};
-    if (!receive(f, &frame)) {
-        if (!*eof_flag)
+    MP_STATS(f, "start decode");
+    int64_t start = mp_time_us();
+    bool ok = receive(f, &frame);
+    state->decode_time += mp_time_us() - start;
+    MP_STATS(f, "end decode");
+    if (!ok) {
+        if (!state->eof_returned)
             mp_pin_in_write(f->ppins[1], MP_EOF_FRAME);
-        *eof_flag = true;
+        state->eof_returned = true;
+        state->decode_time = 0;
     } else if (frame.type) {
-        *eof_flag = false;
+        state->eof_returned = false;
+        mp_metric_record(state->metric_frame_us, state->decode_time);
+        state->decode_time = 0;
         mp_pin_in_write(f->ppins[1], frame);
     } else {
         // Need to feed a packet.
@@ -710,7 +719,12 @@ void lavc_process(struct mp_filter *f, bool *eof_flag,
             }
             return;
         }
-        if (!send(f, pkt)) {
+        MP_STATS(f, "start decode-packet");
+        start = mp_time_us();
+        ok = send(f, pkt);
+        state->decode_time += mp_time_us() - start;
+        MP_STATS(f, "end decode-packet");
+        if (!ok) {
             // Should never happen, but can happen with broken decoders.
             MP_WARN(f, "could not consume packet\n");
             mp_pin_out_unread(f->ppins[0], frame);
@@ -26,6 +26,7 @@ struct mp_codec_params;
 struct mp_image_params;
 struct mp_decoder_list;
 struct demux_packet;
+struct mp_metric;
 
 // (free with talloc_free(mp_decoder_wrapper.f)
 struct mp_decoder_wrapper {
@@ -108,9 +109,16 @@ extern const struct mp_decoder_fns vd_lavc;
 extern const struct mp_decoder_fns ad_lavc;
 extern const struct mp_decoder_fns ad_spdif;
 
-// Convenience wrapper for lavc based decoders. eof_flag must be set to false
-// on init and resets.
-void lavc_process(struct mp_filter *f, bool *eof_flag,
+struct lavc_state {
+    bool eof_returned;
+    // Optional; time spent in send/receive per returned frame (in us).
+    struct mp_metric *metric_frame_us;
+    int64_t decode_time;
+};
+
+// Convenience wrapper for lavc based decoders. state must be zero-initialized
+// on init, and eof_returned/decode_time reset on resets.
+void lavc_process(struct mp_filter *f, struct lavc_state *state,
                   bool (*send)(struct mp_filter *f, struct demux_packet *pkt),
                   bool (*receive)(struct mp_filter *f, struct mp_frame *res));
 
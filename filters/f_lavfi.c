@@ -28,6 +28,7 @@
 #include <libavutil/mathematics.h>
 #include <libavutil/rational.h>
 #include <libavutil/error.h>
+#include <libavutil/hwcontext.h>
 #include <libavutil/opt.h>
 #include <libavfilter/avfilter.h>
 #include <libavfilter/buffersink.h>
@@ -37,6 +38,8 @@
 #include "common/av_common.h"
 #include "common/tags.h"
 #include "common/msg.h"
+#include "misc/thread_pool.h"
+#include "osdep/atomic.h"
 
 #include "audio/format.h"
 #include "audio/aframe.h"
@@ -67,6 +70,15 @@ struct lavfi {
     char **direct_filter_opts;
 
     AVFilterGraph *graph;
+    // Graph created in advance while the current one is draining, so the
+    // filters are already created and initialized when the new graph is
+    // configured. Taken over by precreate_graph().
+    AVFilterGraph *next_graph;
+    // Creating next_graph failed; don't try again until the graph is recreated.
+    bool next_graph_failed;
+    // Creates the filters for next_graph on a worker thread (or NULL).
+    struct graph_job *graph_job;
+    struct mp_task_group *graph_tasks;
     // Set to true once all inputs have been initialized, and the graph is
     // linked.
     bool initialized;
@@ -107,6 +119,9 @@ struct lavfi_pad {
 
     AVFilterContext *filter;
     int filter_pad;
+    // Same as filter/filter_pad, for lavfi.next_graph.
+    AVFilterContext *next_filter;
+    int next_filter_pad;
     // buffersrc or buffersink connected to filter/filter_pad
     AVFilterContext *buffer;
     AVRational timebase;
@@ -137,6 +152,7 @@ static void free_graph(struct lavfi *c)
     }
     c->initialized = false;
     c->draining_recover = false;
+    c->next_graph_failed = false;
 }
 
 static void add_pad(struct lavfi *c, int dir, int index, AVFilterContext *filter,
@@ -214,6 +230,7 @@ static void add_pad(struct lavfi *c, int dir, int index, AVFilterContext *filter
         p->name = talloc_strdup(p, name);
         p->type = type;
         p->pin_index = -1;
+        p->next_filter_pad = -1;
         p->metadata = talloc_zero(p, struct mp_tags);
         if (p->dir == MP_PIN_IN)
             MP_TARRAY_APPEND(c, c->in_pads, c->num_in_pads, p);
@@ -239,52 +256,110 @@ static void add_pads_direct(struct lavfi *c, int dir, AVFilterContext *f,
         add_pad(c, dir, n, f, n, avfilter_pad_get_name(pads, n), first_init);
 }
 
-// Parse the user-provided filter graph, and populate the unlinked filter pads.
-static void precreate_graph(struct lavfi *c, bool first_init)
+// Exchange the current graph (and the pad associations) with next_graph.
+static void swap_next_graph(struct lavfi *c)
 {
-    assert(!c->graph);
+    MPSWAP(AVFilterGraph *, c->graph, c->next_graph);
+    for (int n = 0; n < c->num_all_pads; n++) {
+        struct lavfi_pad *pad = c->all_pads[n];
 
-    c->failed = false;
+        MPSWAP(AVFilterContext *, pad->filter, pad->next_filter);
+        MPSWAP(int, pad->filter_pad, pad->next_filter_pad);
+    }
+}
 
-    c->graph = avfilter_graph_alloc();
-    if (!c->graph)
+static void free_next_graph(struct lavfi *c)
+{
+    avfilter_graph_free(&c->next_graph);
+    for (int n = 0; n < c->num_all_pads; n++) {
+        struct lavfi_pad *pad = c->all_pads[n];
+
+        pad->next_filter = NULL;
+        pad->next_filter_pad = -1;
+    }
+}
+
+// Result of parsing the user-provided filter graph (see create_graph()).
+struct graph_parse {
+    AVFilterGraph *graph;
+    AVFilterInOut *in, *out;    // unlinked pads (normal graphs)
+    AVFilterContext *filter;    // the filter (direct filters)
+};
+
+static void free_graph_parse(struct graph_parse *p)
+{
+    avfilter_inout_free(&p->in);
+    avfilter_inout_free(&p->out);
+    avfilter_graph_free(&p->graph);
+    p->filter = NULL;
+}
+
+// Create the filters of the user-provided filter graph. This touches only the
+// (immutable) filter options in c, so it can run on a worker thread.
+static bool create_graph(struct lavfi *c, struct mp_log *log,
+                         struct graph_parse *p)
+{
+    *p = (struct graph_parse){0};
+
+    p->graph = avfilter_graph_alloc();
+    if (!p->graph)
         abort();
 
-    if (mp_set_avopts(c->log, c->graph, c->graph_opts) < 0)
+    if (mp_set_avopts(log, p->graph, c->graph_opts) < 0)
         goto error;
 
     if (c->direct_filter) {
-        AVFilterContext *filter = avfilter_graph_alloc_filter(c->graph,
+        p->filter = avfilter_graph_alloc_filter(p->graph,
                             avfilter_get_by_name(c->graph_string), "filter");
-        if (!filter) {
-            MP_FATAL(c, "filter '%s' not found or failed to allocate\n",
+        if (!p->filter) {
+            mp_fatal(log, "filter '%s' not found or failed to allocate\n",
                      c->graph_string);
             goto error;
         }
 
-        if (mp_set_avopts(c->log, filter->priv, c->direct_filter_opts) < 0)
+        if (mp_set_avopts(log, p->filter->priv, c->direct_filter_opts) < 0)
             goto error;
 
-        if (avfilter_init_str(filter, NULL) < 0) {
-            MP_FATAL(c, "filter failed to initialize\n");
+        if (avfilter_init_str(p->filter, NULL) < 0) {
+            mp_fatal(log, "filter failed to initialize\n");
             goto error;
         }
+    } else {
+        if (avfilter_graph_parse2(p->graph, c->graph_string, &p->in, &p->out) < 0) {
+            mp_fatal(log, "parsing the filter graph failed\n");
+            goto error;
+        }
+    }
 
+    return true;
+
+error:
+    free_graph_parse(p);
+    return false;
+}
+
+// Set c->graph to the parsed graph, and populate the unlinked filter pads.
+// Returns false on failure; c->graph is unset then. p is freed in any case.
+static bool attach_graph(struct lavfi *c, struct graph_parse *p, bool first_init)
+{
+    assert(!c->graph);
+
+    c->failed = false;
+
+    c->graph = p->graph;
+    p->graph = NULL;
+
+    if (c->direct_filter) {
+        AVFilterContext *filter = p->filter;
         add_pads_direct(c, MP_PIN_IN, filter, filter->input_pads,
                         filter->nb_inputs, first_init);
         add_pads_direct(c, MP_PIN_OUT, filter, filter->output_pads,
                         filter->nb_outputs, first_init);
     } else {
-        AVFilterInOut *in = NULL, *out = NULL;
-        if (avfilter_graph_parse2(c->graph, c->graph_string, &in, &out) < 0) {
-            MP_FATAL(c, "parsing the filter graph failed\n");
-            goto error;
-        }
-        add_pads(c, MP_PIN_IN, in, first_init);
-        add_pads(c, MP_PIN_OUT, out, first_init);
-        avfilter_inout_free(&in);
-        avfilter_inout_free(&out);
+        add_pads(c, MP_PIN_IN, p->in, first_init);
+        add_pads(c, MP_PIN_OUT, p->out, first_init);
     }
+    free_graph_parse(p);
 
     for (int n = 0; n < c->num_all_pads; n++)
         c->failed |= !c->all_pads[n]->filter;
@@ -292,13 +367,120 @@ static void precreate_graph(struct lavfi *c, bool first_init)
     if (c->failed)
         goto error;
 
-    return;
+    return true;
 
 error:
-    free_graph(c);
+    avfilter_graph_free(&c->graph);
+    for (int n = 0; n < c->num_all_pads; n++) {
+        c->all_pads[n]->filter = NULL;
+        c->all_pads[n]->filter_pad = -1;
+    }
     c->failed = true;
-    mp_filter_internal_mark_failed(c->f);
-    return;
+    return false;
+}
+
+// Parse the user-provided filter graph, and populate the unlinked filter pads.
+// Returns false on failure; c->graph is unset then.
+static bool parse_graph(struct lavfi *c, bool first_init)
+{
+    struct graph_parse p;
+    if (!create_graph(c, c->log, &p)) {
+        c->failed = true;
+        return false;
+    }
+    return attach_graph(c, &p, first_init);
+}
+
+// Creating the replacement graph on a worker thread.
+struct graph_job {
+    struct lavfi *c;
+    // Written by the worker before done is set.
+    struct graph_parse result;
+    bool ok;
+    atomic_bool done;
+};
+
+static void run_graph_job(void *ctx)
+{
+    struct graph_job *job = ctx;
+    struct mp_filter *f = job->c->f;
+
+    // Errors are reported when the graph is recreated normally after draining.
+    job->ok = create_graph(job->c, mp_null_log, &job->result);
+    atomic_store(&job->done, true);
+    mp_filter_wakeup(f);
+}
+
+// Make the graph created by the finished graph_job the next_graph.
+static void finish_graph_job(struct lavfi *c)
+{
+    struct graph_job *job = c->graph_job;
+    c->graph_job = NULL;
+
+    bool ok = job->ok;
+    if (ok) {
+        swap_next_graph(c);
+        ok = attach_graph(c, &job->result, false);
+        swap_next_graph(c);
+    }
+    talloc_free(job);
+
+    // Not fatal yet: it's retried (and reported) after draining.
+    if (!ok) {
+        MP_VERBOSE(c, "could not create new graph while draining\n");
+        c->failed = false;
+        c->next_graph_failed = true;
+    }
+}
+
+// Set c->graph to a parsed, but not yet configured graph.
+static void precreate_graph(struct lavfi *c, bool first_init)
+{
+    assert(!c->graph);
+
+    if (c->graph_job) {
+        // Draining was faster than creating the new graph.
+        if (c->graph_tasks)
+            mp_task_group_wait(c->graph_tasks);
+        finish_graph_job(c);
+    }
+
+    if (c->next_graph) {
+        swap_next_graph(c);
+        return;
+    }
+
+    if (!parse_graph(c, first_init))
+        mp_filter_internal_mark_failed(c->f);
+}
+
+// Create the graph that replaces the current one once draining is done. This
+// does the costly part of the graph recreation (filter creation and init) on a
+// worker thread, while the old graph still outputs its buffered frames. Only
+// associating the new filters with the pads happens on the filter thread,
+// when the worker is done.
+static void prepare_next_graph(struct lavfi *c)
+{
+    if (c->next_graph || c->next_graph_failed || c->failed)
+        return;
+
+    if (!c->graph_job) {
+        if (!c->graph_tasks) {
+            struct mp_thread_pool *pool = mp_thread_pool_get_default(c);
+            if (pool)
+                c->graph_tasks = mp_task_group_create(c, pool);
+        }
+        c->graph_job = talloc_zero(NULL, struct graph_job);
+        c->graph_job->c = c;
+        if (c->graph_tasks) {
+            mp_task_group_queue(c->graph_tasks, run_graph_job, c->graph_job);
+        } else {
+            run_graph_job(c->graph_job);
+        }
+    }
+
+    if (atomic_load(&c->graph_job->done))
+        finish_graph_job(c);
 }
 
 // Ensure to send EOF to each input pad, so the graph can be drained properly.
@@ -330,7 +512,7 @@ static bool is_aformat_ok(struct mp_aframe *a, struct mp_aframe *b)
 static bool is_vformat_ok(struct mp_image *a, struct mp_image *b)
 {
     return a->imgfmt == b->imgfmt &&
-           a->w == b->w && a->h && b->h &&
+           a->w == b->w && a->h == b->h &&
            a->params.p_w == b->params.p_w && a->params.p_h == b->params.p_h;
 }
 static bool is_format_ok(struct mp_frame a, struct mp_frame b)
@@ -342,6 +524,53 @@ static bool is_format_ok(struct mp_frame a, struct mp_frame b)
     return false;
 }
 
+// Hardware frames with a new hw_frames_ctx, but otherwise unchanged format.
+// If the frames context is compatible (same device, underlying format and
+// size), set it on the buffersrc, instead of recreating the graph.
+static bool update_hw_frames_ctx(struct lavfi *c, struct lavfi_pad *pad)
+{
+    if (pad->type != MP_FRAME_VIDEO)
+        return true;
+
+    struct mp_image *fmt = pad->in_fmt.data;
+    struct mp_image *img = pad->pending.data;
+    if (fmt->hwctx == img->hwctx ||
+        (fmt->hwctx && img->hwctx && fmt->hwctx->data == img->hwctx->data))
+        return true;
+    if (!fmt->hwctx || !img->hwctx || !c->initialized)
+        return false;
+
+    AVHWFramesContext *a = (void *)fmt->hwctx->data;
+    AVHWFramesContext *b = (void *)img->hwctx->data;
+    if (a->device_ctx != b->device_ctx || a->sw_format != b->sw_format ||
+        a->width != b->width || a->height != b->height)
+        return false;
+
+    AVBufferSrcParameters *params = av_buffersrc_parameters_alloc();
+    if (!params)
+        return false;
+    params->hw_frames_ctx = img->hwctx;
+    int ret = av_buffersrc_parameters_set(pad->buffer, params);
+    av_free(params);
+    if (ret < 0)
+        return false;
+
+    // The link was configured with the old context; filters read it from there.
+    AVFilterLink *link = pad->buffer->outputs[0];
+    av_buffer_unref(&link->hw_frames_ctx);
+    link->hw_frames_ctx = av_buffer_ref(img->hwctx);
+    if (!link->hw_frames_ctx)
+        return false;
+
+    av_buffer_unref(&fmt->hwctx);
+    fmt->hwctx = av_buffer_ref(img->hwctx);
+    if (!fmt->hwctx)
+        return false;
+
+    MP_VERBOSE(c, "hw frames context change on %s\n", pad->name);
+    return true;
+}
+
 static void read_pad_input(struct lavfi *c, struct lavfi_pad *pad)
 {
     assert(pad->dir == MP_PIN_IN);
@@ -359,7 +588,8 @@ static void read_pad_input(struct lavfi *c, struct lavfi_pad *pad)
     }
 
     if (mp_frame_is_data(pad->pending) && pad->in_fmt.type &&
-        !is_format_ok(pad->pending, pad->in_fmt))
+        !(is_format_ok(pad->pending, pad->in_fmt) &&
+          update_hw_frames_ctx(c, pad)))
     {
         if (!c->draining_recover)
             MP_VERBOSE(c, "format change on %s\n", pad->name);
@@ -698,6 +928,8 @@ static void lavfi_process(struct mp_filter *f)
 
     // Start over on format changes or EOF draining.
     if (c->draining_recover) {
+        prepare_next_graph(c);
+
         // Wait until all outputs got EOF.
         bool all_eof = true;
         for (int n = 0; n < c->num_out_pads; n++)
@@ -729,6 +961,13 @@ static void lavfi_destroy(struct mp_filter *f)
     struct lavfi *c = f->priv;
 
     lavfi_reset(f);
+    // Wait for the worker thread.
+    TA_FREEP(&c->graph_tasks);
+    if (c->graph_job) {
+        free_graph_parse(&c->graph_job->result);
+        TA_FREEP(&c->graph_job);
+    }
+    free_next_graph(c);
     av_frame_free(&c->tmp_frame);
 }
 
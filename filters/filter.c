@@ -2,7 +2,10 @@
 
 #include "common/common.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "common/msg.h"
+#include "misc/node.h"
+#include "osdep/timer.h"
 #include "video/hwdec.h"
 
 #include "filter.h"
@@ -65,6 +68,12 @@ struct filter_runner {
 
     struct mp_filter *root_filter;
 
+    // Time per mp_filter_run() call (all process() calls it makes).
+    struct mp_metric *metric_run_us;
+
+    // Update mp_filter_internal.stats (set by mp_filter_get_stats()).
+    bool collect_stats;
+
     // If we're currently running the filter graph (for avoiding recursion).
     bool filtering;
 
@@ -105,6 +114,15 @@ struct mp_filter_internal {
     bool pending;
     bool async_pending;
     bool failed;
+
+    // Only updated if filter_runner.collect_stats is set. Times in us.
+    struct {
+        int64_t process_calls;
+        int64_t frames_in, frames_out;      // non-EOF frames
+        int64_t wall_time, cpu_time;        // total spent in process()
+        int64_t frame_wall, frame_cpu;      // since the last output frame
+        double avg_frame_wall, avg_frame_cpu; // rolling average per frame
+    } stats;
 };
 
 
@@ -173,6 +191,37 @@ static void flush_async_notifications(struct filter_runner *r)
     pthread_mutex_unlock(&r->async_lock);
 }
 
+static void process_with_stats(struct mp_filter *f)
+{
+    struct mp_filter_internal *in = f->in;
+    int64_t frames = in->stats.frames_out;
+    int64_t wall = mp_time_us();
+    int64_t cpu = mp_thread_cpu_time_us();
+
+    in->info->process(f);
+
+    wall = mp_time_us() - wall;
+    cpu = cpu >= 0 ? mp_thread_cpu_time_us() - cpu : 0;
+
+    in->stats.process_calls += 1;
+    in->stats.wall_time += wall;
+    in->stats.cpu_time += cpu;
+    in->stats.frame_wall += wall;
+    in->stats.frame_cpu += cpu;
+
+    // Attribute the time since the last output frame to the frames output by
+    // this call. (Exponential moving average over roughly 16 frames.)
+    frames = in->stats.frames_out - frames;
+    if (frames > 0) {
+        double w = in->stats.frame_wall / (double)frames;
+        double c = in->stats.frame_cpu / (double)frames;
+        bool first = in->stats.frames_out == frames;
+        in->stats.avg_frame_wall += first ? w : (w - in->stats.avg_frame_wall) / 16;
+        in->stats.avg_frame_cpu += first ? c : (c - in->stats.avg_frame_cpu) / 16;
+        in->stats.frame_wall = in->stats.frame_cpu = 0;
+    }
+}
+
 bool mp_filter_run(struct mp_filter *filter)
 {
     struct filter_runner *r = filter->in->runner;
@@ -185,13 +234,30 @@ bool mp_filter_run(struct mp_filter *filter)
 
     flush_async_notifications(r);
 
+    int64_t start = 0;
+    if (r->num_pending) {
+        MP_STATS(filter, "start filter");
+        start = mp_time_us();
+    }
+
     while (r->num_pending) {
         struct mp_filter *next = r->pending[r->num_pending - 1];
         r->num_pending -= 1;
         next->in->pending = false;
 
-        if (next->in->info->process)
+        if (!next->in->info->process)
+            continue;
+
+        if (r->collect_stats) {
+            process_with_stats(next);
+        } else {
             next->in->info->process(next);
+        }
+    }
+
+    if (start) {
+        mp_metric_record(r->metric_run_us, mp_time_us() - start);
+        MP_STATS(filter, "end filter");
     }
 
     r->filtering = false;
@@ -230,6 +296,10 @@ bool mp_pin_in_write(struct mp_pin *p, struct mp_frame frame)
         return false;
     }
     assert(p->conn->data.type == MP_FRAME_NONE);
+    if (p->owner->in->runner->collect_stats && frame.type != MP_FRAME_EOF) {
+        p->owner->in->stats.frames_out += 1;
+        p->conn->owner->in->stats.frames_in += 1;
+    }
     p->conn->data = frame;
     p->conn->data_requested = false;
     add_pending(p->conn->manual_connection);
@@ -706,6 +776,8 @@ struct mp_filter *mp_filter_create_with_params(struct mp_filter_params *params)
         *f->in->runner = (struct filter_runner){
             .global = params->global,
             .root_filter = f,
+            .metric_run_us = mp_metrics_get(params->global, "filter/run-us",
+                                            MP_METRIC_HISTOGRAM),
         };
         pthread_mutex_init(&f->in->runner->async_lock, NULL);
     }
@@ -785,6 +857,59 @@ static void dump_pin_state(struct mp_filter *f, struct mp_pin *pin)
         mp_frame_type_str(pin->data.type));
 }
 
+// dst must be an empty MPV_FORMAT_NODE_MAP.
+static void add_filter_stats(struct mp_filter *f, struct mpv_node *dst, bool cpu)
+{
+    struct mp_filter_internal *in = f->in;
+
+    node_map_add_string(dst, "name", in->name ? in->name : in->info->name);
+    node_map_add_string(dst, "type", in->info->name);
+    node_map_add_int64(dst, "process-calls", in->stats.process_calls);
+    node_map_add_int64(dst, "frames-in", in->stats.frames_in);
+    node_map_add_int64(dst, "frames-out", in->stats.frames_out);
+    node_map_add_double(dst, "wall-time", in->stats.wall_time / 1e6);
+    node_map_add_double(dst, "wall-per-frame", in->stats.avg_frame_wall / 1e6);
+    if (cpu) {
+        node_map_add_double(dst, "cpu-time", in->stats.cpu_time / 1e6);
+        node_map_add_double(dst, "cpu-per-frame", in->stats.avg_frame_cpu / 1e6);
+    }
+
+    // Frames waiting to be read by this filter. Only the end of a connection
+    // buffers data, and at most 1 frame.
+    int queued = 0;
+    struct mpv_node *pins = node_map_add(dst, "pins", MPV_FORMAT_NODE_ARRAY);
+    for (int n = 0; n < f->num_pins; n++) {
+        struct mp_pin *p = f->ppins[n];
+        struct mpv_node *pin = node_array_add(pins, MPV_FORMAT_NODE_MAP);
+        // (The private pin of a filter input is an output pin.)
+        bool is_input = p->dir == MP_PIN_OUT;
+        bool has_data = is_input && p->data.type;
+        bool requested = is_input ? p->data_requested
+                                  : p->conn && p->conn->data_requested;
+        node_map_add_string(pin, "name", p->name);
+        node_map_add_string(pin, "dir", is_input ? "in" : "out");
+        node_map_add_flag(pin, "queued", has_data);
+        node_map_add_flag(pin, "requested", requested);
+        queued += has_data;
+    }
+    node_map_add_int64(dst, "queued", queued);
+
+    struct mpv_node *children =
+        node_map_add(dst, "children", MPV_FORMAT_NODE_ARRAY);
+    for (int n = 0; n < in->num_children; n++) {
+        struct mpv_node *child = node_array_add(children, MPV_FORMAT_NODE_MAP);
+        add_filter_stats(in->children[n], child, cpu);
+    }
+}
+
+void mp_filter_get_stats(struct mp_filter *f, struct mpv_node *dst)
+{
+    f->in->runner->collect_stats = true;
+
+    node_init(dst, MPV_FORMAT_NODE_MAP, NULL);
+    add_filter_stats(f, dst, mp_thread_cpu_time_us() >= 0);
+}
+
 void mp_filter_dump_states(struct mp_filter *f)
 {
     MP_WARN(f, "%s[%p] (%s[%p])\n", filt_name(f), f,
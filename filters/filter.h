@@ -5,6 +5,7 @@
 #include "frame.h"
 
 struct mpv_global;
+struct mpv_node;
 struct mp_filter;
 
 // A filter input or output. These always come in pairs: one mp_pin is for
@@ -423,5 +424,11 @@ struct mp_filter *mp_filter_create_root(struct mpv_global *global);
 void mp_filter_root_set_wakeup_cb(struct mp_filter *root,
                                   void (*wakeup_cb)(void *ctx), void *ctx);
 
+// Return timing and queue state of f and all its children as a tree of
+// MPV_FORMAT_NODE_MAPs (see "filter-graph-stats" property). Collecting timing
+// is enabled on the first call (for the whole filter graph). Must be called
+// from the thread which runs the filter graph.
+void mp_filter_get_stats(struct mp_filter *f, struct mpv_node *dst);
+
 // Debugging internal stuff.
 void mp_filter_dump_states(struct mp_filter *f);
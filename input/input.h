@@ -280,4 +280,23 @@ char *mp_json_encode_event(struct mpv_event *event);
 struct mpv_handle;
 char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf);
 
+enum mp_ipc_protocol {
+    MP_IPC_JSON,        // newline-separated JSON (or text) commands
+    MP_IPC_MSGPACK,     // MessagePack, each prefixed with 32 bit BE length
+};
+
+// Return the length of the first complete message in buf, 0 if there is no
+// complete message yet, or -1 if the data is invalid (should disconnect).
+int64_t mp_ipc_next_message(enum mp_ipc_protocol proto, bstr buf);
+
+// Execute a message as delimited by mp_ipc_next_message(), and return the
+// reply (allocated under ctx; empty if none). The message can switch the
+// protocol used for the following messages.
+bstr mp_ipc_execute_message(struct mpv_handle *client, void *ctx,
+                            enum mp_ipc_protocol *proto, bstr msg);
+
+// Encode the event for sending with the given protocol (allocated under ctx).
+bstr mp_ipc_encode_event(void *ctx, enum mp_ipc_protocol proto,
+                         struct mpv_event *event);
+
 #endif /* MPLAYER_INPUT_H */
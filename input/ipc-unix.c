@@ -28,6 +28,10 @@
 
 #include "config.h"
 
+#if HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #include "osdep/io.h"
 #include "osdep/threads.h"
 
@@ -51,6 +55,9 @@ struct mp_ipc_ctx {
 
     pthread_t thread;
     int death_pipe[2];
+
+    // Write end of the ipc_worker connection pipe, or -1.
+    int worker_pipe;
 };
 
 struct client_arg {
@@ -64,9 +71,10 @@ struct client_arg {
     bool writable;
 };
 
-static int ipc_write_str(struct client_arg *client, const char *buf)
+static int ipc_write(struct client_arg *client, bstr data)
 {
-    size_t count = strlen(buf);
+    const unsigned char *buf = data.start;
+    size_t count = data.len;
     while (count > 0) {
         ssize_t rc = send(client->client_fd, buf, count, MSG_NOSIGNAL);
         if (rc <= 0) {
@@ -104,6 +112,7 @@ static void *client_thread(void *p)
 
     struct client_arg *arg = p;
     bstr client_msg = { talloc_strdup(NULL, ""), 0 };
+    enum mp_ipc_protocol proto = MP_IPC_JSON;
 
     mpthread_set_name(arg->client_name);
 
@@ -146,14 +155,14 @@ static void *client_thread(void *p)
                 if (!arg->writable)
                     continue;
 
-                char *event_msg = mp_json_encode_event(event);
-                if (!event_msg) {
+                bstr event_msg = mp_ipc_encode_event(NULL, proto, event);
+                if (!event_msg.start) {
                     MP_ERR(arg, "Encoding error\n");
                     goto done;
                 }
 
-                rc = ipc_write_str(arg, event_msg);
-                talloc_free(event_msg);
+                rc = ipc_write(arg, event_msg);
+                talloc_free(event_msg.start);
                 if (rc < 0) {
                     MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
                     goto done;
@@ -184,21 +193,35 @@ static void *client_thread(void *p)
 
                 bstr_xappend(NULL, &client_msg, append);
 
-                while (bstrchr(client_msg, '\n') != -1) {
-                    char *reply_msg = mp_ipc_consume_next_command(arg->client,
-                        NULL, &client_msg);
+                size_t pos = 0;
+                while (1) {
+                    bstr rest = bstr_cut(client_msg, pos);
+                    int64_t len = mp_ipc_next_message(proto, rest);
+                    if (len < 0) {
+                        MP_ERR(arg, "Invalid message received\n");
+                        goto done;
+                    }
+                    if (len == 0)
+                        break;
+                    pos += len;
+
+                    bstr reply_msg = mp_ipc_execute_message(arg->client, NULL,
+                        &proto, bstr_splice(rest, 0, len));
 
-                    if (reply_msg && arg->writable) {
-                        rc = ipc_write_str(arg, reply_msg);
+                    if (reply_msg.len && arg->writable) {
+                        rc = ipc_write(arg, reply_msg);
                         if (rc < 0) {
                             MP_ERR(arg, "Write error (%s)\n", mp_strerror(errno));
-                            talloc_free(reply_msg);
+                            talloc_free(reply_msg.start);
                             goto done;
                         }
                     }
 
-                    talloc_free(reply_msg);
+                    talloc_free(reply_msg.start);
                 }
+                memmove(client_msg.start, client_msg.start + pos,
+                        client_msg.len - pos);
+                client_msg.len -= pos;
             }
         }
     }
@@ -238,8 +261,436 @@ err:
     talloc_free(client);
 }
 
+#if HAVE_EPOLL
+
+// Socket clients are multiplexed on a single worker thread with epoll, instead
+// of using a thread per client. The listener thread creates the mpv_handle and
+// passes the conn to the worker through a pipe. Like the client threads, the
+// worker is detached; it exits once the listener is gone (closed the pipe) and
+// all of its clients disconnected or were shut down.
+
+// Maximum size of a single read() from a client socket.
+#define CONN_READ_SIZE (64 * 1024)
+
+// While this much output is queued for a client (because it doesn't read from
+// its socket fast enough), stop executing its commands and reading its events.
+// Once the client's event queue in the core is full, the client will get
+// MPV_EVENT_QUEUE_OVERFLOW, so memory usage is bounded.
+#define CONN_MAX_OUTPUT (1024 * 1024)
+
+enum watch_type {
+    WATCH_CONN_PIPE,
+    WATCH_SOCKET,
+    WATCH_WAKEUP,
+};
+
+// Referenced by epoll_event.data.ptr.
+struct watch {
+    enum watch_type type;
+    struct conn *conn;
+};
+
+struct conn {
+    struct mp_log *log;
+    struct mpv_handle *client;
+    int fd;
+    int wakeup_fd;
+    bool dead;              // destroy after the current epoll_wait() batch
+    bool events_pending;    // woken up, but not all events were read yet
+    enum mp_ipc_protocol proto;
+
+    bstr input;             // received data
+    size_t input_pos;       // part of input that was already executed
+    bstr output;            // queued output
+    size_t output_pos;      // part of output that was already sent
+
+    uint32_t sock_events, wakeup_events; // currently registered with epoll
+    struct watch sock_watch, wakeup_watch;
+};
+
+struct ipc_worker {
+    struct mp_log *log;
+    int epoll_fd;
+    int conn_pipe;          // read end of mp_ipc_ctx.worker_pipe
+    bool listener_gone;
+
+    struct conn **conns;
+    int num_conns;
+};
+
+static size_t conn_queued(struct conn *conn)
+{
+    return conn->output.len - conn->output_pos;
+}
+
+static bool conn_output_full(struct conn *conn)
+{
+    return conn_queued(conn) >= CONN_MAX_OUTPUT;
+}
+
+static void conn_queue_output(struct conn *conn, bstr data)
+{
+    bstr_xappend(conn, &conn->output, data);
+}
+
+// Send as much queued output as possible without blocking.
+static bool conn_flush_output(struct conn *conn)
+{
+    while (conn_queued(conn)) {
+        ssize_t rc = send(conn->fd, conn->output.start + conn->output_pos,
+                          conn_queued(conn), MSG_NOSIGNAL);
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            MP_ERR(conn, "Write error (%s)\n", mp_strerror(errno));
+            return false;
+        }
+        conn->output_pos += rc;
+    }
+    if (conn->output_pos == conn->output.len) {
+        conn->output.len = conn->output_pos = 0;
+    } else if (conn->output_pos > conn->output.len / 2) {
+        memmove(conn->output.start, conn->output.start + conn->output_pos,
+                conn_queued(conn));
+        conn->output.len = conn_queued(conn);
+        conn->output_pos = 0;
+    }
+    return true;
+}
+
+static void watch_fd(struct ipc_worker *w, int fd, struct watch *watch,
+                     uint32_t *cur, uint32_t events)
+{
+    if (*cur == events)
+        return;
+    struct epoll_event ev = {.events = events, .data.ptr = watch};
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)
+        MP_ERR(w, "epoll_ctl failed (%s)\n", mp_strerror(errno));
+    *cur = events;
+}
+
+// Execute buffered commands, as far as the output limit allows.
+static void conn_run_commands(struct conn *conn)
+{
+    while (!conn_output_full(conn)) {
+        bstr rest = bstr_cut(conn->input, conn->input_pos);
+        int64_t len = mp_ipc_next_message(conn->proto, rest);
+        if (len < 0) {
+            MP_ERR(conn, "Invalid message received\n");
+            conn->dead = true;
+            return;
+        }
+        if (!len)
+            break;
+        conn->input_pos += len;
+        bstr reply_msg = mp_ipc_execute_message(conn->client, NULL,
+                                                &conn->proto,
+                                                bstr_splice(rest, 0, len));
+        conn_queue_output(conn, reply_msg);
+        talloc_free(reply_msg.start);
+    }
+    if (conn->input_pos) {
+        memmove(conn->input.start, conn->input.start + conn->input_pos,
+                conn->input.len - conn->input_pos);
+        conn->input.len -= conn->input_pos;
+        conn->input_pos = 0;
+    }
+}
+
+// Read pending events, as far as the output limit allows.
+static void conn_read_events(struct conn *conn)
+{
+    while (conn->events_pending && !conn_output_full(conn)) {
+        mpv_event *event = mpv_wait_event(conn->client, 0);
+
+        if (event->event_id == MPV_EVENT_NONE) {
+            conn->events_pending = false;
+            break;
+        }
+
+        if (event->event_id == MPV_EVENT_SHUTDOWN) {
+            conn->dead = true;
+            return;
+        }
+
+        bstr event_msg = mp_ipc_encode_event(NULL, conn->proto, event);
+        if (!event_msg.start) {
+            MP_ERR(conn, "Encoding error\n");
+            conn->dead = true;
+            return;
+        }
+        conn_queue_output(conn, event_msg);
+        talloc_free(event_msg.start);
+    }
+}
+
+// Whether there are complete commands or events that weren't processed yet.
+static bool conn_has_work(struct conn *conn)
+{
+    return conn->events_pending ||
+           mp_ipc_next_message(conn->proto, conn->input) != 0;
+}
+
+// Execute buffered commands, read events, send output, and update what the
+// conn waits for, as far as the output limit allows.
+static void conn_process(struct ipc_worker *w, struct conn *conn)
+{
+    // Sending may make room below the output limit again. Nothing else wakes
+    // up the conn for the remaining work then, so continue until it's done or
+    // the socket is full.
+    do {
+        conn_run_commands(conn);
+        if (!conn->dead)
+            conn_read_events(conn);
+        if (conn->dead)
+            return;
+
+        if (!conn_flush_output(conn)) {
+            conn->dead = true;
+            return;
+        }
+    } while (!conn_output_full(conn) && conn_has_work(conn));
+
+    bool full = conn_output_full(conn);
+    watch_fd(w, conn->fd, &conn->sock_watch, &conn->sock_events,
+             (full ? 0 : EPOLLIN) | (conn_queued(conn) ? EPOLLOUT : 0));
+    watch_fd(w, conn->wakeup_fd, &conn->wakeup_watch, &conn->wakeup_events,
+             full ? 0 : EPOLLIN);
+}
+
+static void conn_read(struct conn *conn)
+{
+    // Only one read per readiness notification, so a client that sends a lot
+    // can't starve the others (epoll is level-triggered).
+    MP_TARRAY_GROW(NULL, conn->input.start, conn->input.len + CONN_READ_SIZE);
+    ssize_t bytes = read(conn->fd, conn->input.start + conn->input.len,
+                         CONN_READ_SIZE);
+    if (bytes < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return;
+        MP_ERR(conn, "Read error (%s)\n", mp_strerror(errno));
+        conn->dead = true;
+        return;
+    }
+
+    if (bytes == 0) {
+        MP_VERBOSE(conn, "Client disconnected\n");
+        conn->dead = true;
+        return;
+    }
+
+    conn->input.len += bytes;
+}
+
+static void conn_destroy(struct ipc_worker *w, struct conn *conn)
+{
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    if (conn->wakeup_fd >= 0)
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, conn->wakeup_fd, NULL);
+    if (conn->input.len > 0)
+        MP_WARN(conn, "Ignoring unterminated command on disconnect.\n");
+    talloc_free(conn->input.start);
+    close(conn->fd);
+    mpv_destroy(conn->client);
+    talloc_free(conn);
+}
+
+static void worker_add_conn(struct ipc_worker *w, struct conn *conn)
+{
+    conn->wakeup_fd = mpv_get_wakeup_pipe(conn->client);
+    if (conn->wakeup_fd < 0) {
+        MP_ERR(conn, "Could not get wakeup pipe\n");
+        conn_destroy(w, conn);
+        return;
+    }
+
+    fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL, 0) | O_NONBLOCK);
+
+    conn->sock_watch = (struct watch){WATCH_SOCKET, conn};
+    conn->wakeup_watch = (struct watch){WATCH_WAKEUP, conn};
+    conn->sock_events = conn->wakeup_events = EPOLLIN;
+    struct epoll_event sock_ev = {EPOLLIN, {.ptr = &conn->sock_watch}};
+    struct epoll_event wakeup_ev = {EPOLLIN, {.ptr = &conn->wakeup_watch}};
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, conn->fd, &sock_ev) < 0 ||
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, conn->wakeup_fd, &wakeup_ev) < 0)
+    {
+        MP_ERR(conn, "epoll_ctl failed (%s)\n", mp_strerror(errno));
+        conn_destroy(w, conn);
+        return;
+    }
+
+    MP_TARRAY_APPEND(w, w->conns, w->num_conns, conn);
+    MP_VERBOSE(conn, "Client connected\n");
+}
+
+static void worker_read_conn_pipe(struct ipc_worker *w)
+{
+    while (1) {
+        struct conn *conn;
+        ssize_t rc = read(w->conn_pipe, &conn, sizeof(conn));
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (rc != sizeof(conn)) {
+            // EOF (pointers are written atomically): listener exited.
+            w->listener_gone = true;
+            epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, w->conn_pipe, NULL);
+            return;
+        }
+        worker_add_conn(w, conn);
+    }
+}
+
+static void *worker_thread(void *p)
+{
+    pthread_detach(pthread_self());
+
+    struct ipc_worker *w = p;
+
+    mpthread_set_name("ipc clients");
+
+    struct sigaction sa = { .sa_handler = SIG_IGN, .sa_flags = SA_RESTART };
+    sigfillset(&sa.sa_mask);
+    sigaction(SIGPIPE, &sa, NULL);
+
+    struct watch pipe_watch = {WATCH_CONN_PIPE};
+    struct epoll_event pipe_ev = {EPOLLIN, {.ptr = &pipe_watch}};
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->conn_pipe, &pipe_ev) < 0) {
+        MP_ERR(w, "epoll_ctl failed (%s)\n", mp_strerror(errno));
+        w->listener_gone = true;
+    }
+
+    while (!w->listener_gone || w->num_conns) {
+        struct epoll_event events[64];
+        int num = epoll_wait(w->epoll_fd, events, MP_ARRAY_SIZE(events), -1);
+        if (num < 0) {
+            if (errno != EINTR)
+                MP_ERR(w, "epoll_wait failed (%s)\n", mp_strerror(errno));
+            continue;
+        }
+
+        for (int n = 0; n < num; n++) {
+            struct watch *watch = events[n].data.ptr;
+            struct conn *conn = watch->conn;
+            uint32_t ev = events[n].events;
+
+            if (watch->type == WATCH_CONN_PIPE) {
+                worker_read_conn_pipe(w);
+                continue;
+            }
+
+            if (conn->dead)
+                continue;
+
+            if (watch->type == WATCH_WAKEUP) {
+                mp_flush_wakeup_pipe(conn->wakeup_fd);
+                conn->events_pending = true;
+            } else if (ev & EPOLLIN) {
+                conn_read(conn);
+            } else if (ev & (EPOLLERR | EPOLLHUP)) {
+                // (Reported even while not waiting for input.)
+                MP_VERBOSE(conn, "Client disconnected\n");
+                conn->dead = true;
+            }
+
+            if (!conn->dead)
+                conn_process(w, conn);
+        }
+
+        for (int n = w->num_conns - 1; n >= 0; n--) {
+            struct conn *conn = w->conns[n];
+            if (conn->dead) {
+                MP_TARRAY_REMOVE_AT(w->conns, w->num_conns, n);
+                conn_destroy(w, conn);
+            }
+        }
+    }
+
+    close(w->conn_pipe);
+    close(w->epoll_fd);
+    talloc_free(w);
+    return NULL;
+}
+
+// Create the worker thread, and return the write end of its connection pipe,
+// or -1 on failure.
+static int ipc_start_worker(struct mp_ipc_ctx *ctx)
+{
+    int pipe_fds[2] = {-1, -1};
+    struct ipc_worker *w = talloc_ptrtype(NULL, w);
+    *w = (struct ipc_worker){
+        .log = mp_log_new(w, ctx->log, NULL),
+        .epoll_fd = epoll_create1(EPOLL_CLOEXEC),
+        .conn_pipe = -1,
+    };
+    if (w->epoll_fd < 0 || mp_make_wakeup_pipe(pipe_fds) < 0)
+        goto err;
+    // (mp_make_wakeup_pipe() makes both ends non-blocking; the listener
+    // should block instead of dropping connections.)
+    fcntl(pipe_fds[1], F_SETFL, fcntl(pipe_fds[1], F_GETFL, 0) & ~O_NONBLOCK);
+    w->conn_pipe = pipe_fds[0];
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, worker_thread, w))
+        goto err;
+
+    return pipe_fds[1];
+
+err:
+    MP_ERR(ctx, "Could not start IPC worker, using a thread per client.\n");
+    if (pipe_fds[0] >= 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+    }
+    if (w->epoll_fd >= 0)
+        close(w->epoll_fd);
+    talloc_free(w);
+    return -1;
+}
+
+static bool ipc_start_client_worker(struct mp_ipc_ctx *ctx, int id, int fd)
+{
+    struct conn *conn = talloc_ptrtype(NULL, conn);
+    *conn = (struct conn){
+        .fd = fd,
+        .wakeup_fd = -1,
+    };
+
+    char *name = talloc_asprintf(conn, "ipc-%d", id);
+    conn->client = mp_new_client(ctx->client_api, name);
+    if (!conn->client) {
+        close(fd);
+        talloc_free(conn);
+        return true;
+    }
+    conn->log = mp_client_get_log(conn->client);
+
+    if (write(ctx->worker_pipe, &conn, sizeof(conn)) != sizeof(conn)) {
+        MP_ERR(ctx, "Could not pass client to IPC worker\n");
+        close(fd);
+        mpv_destroy(conn->client);
+        talloc_free(conn);
+    }
+    return true;
+}
+
+#else
+
+static bool ipc_start_client_worker(struct mp_ipc_ctx *ctx, int id, int fd)
+{
+    return false;
+}
+
+#endif
+
 static void ipc_start_client_json(struct mp_ipc_ctx *ctx, int id, int fd)
 {
+    if (ctx->worker_pipe >= 0 && ipc_start_client_worker(ctx, id, fd))
+        return;
+
     struct client_arg *client = talloc_ptrtype(NULL, client);
     *client = (struct client_arg){
         .client_name = talloc_asprintf(client, "ipc-%d", id),
@@ -348,6 +799,10 @@ static void *ipc_thread(void *p)
 
     MP_VERBOSE(arg, "Listening to IPC socket.\n");
 
+#if HAVE_EPOLL
+    arg->worker_pipe = ipc_start_worker(arg);
+#endif
+
     int client_num = 0;
 
     struct pollfd fds[2] = {
@@ -380,6 +835,10 @@ done:
     if (ipc_fd >= 0)
         close(ipc_fd);
 
+    // Makes the worker exit once its clients are gone.
+    if (arg->worker_pipe >= 0)
+        close(arg->worker_pipe);
+
     return NULL;
 }
 
@@ -394,6 +853,7 @@ struct mp_ipc_ctx *mp_init_ipc(struct mp_client_api *client_api,
         .client_api = client_api,
         .path       = mp_get_user_path(arg, global, opts->ipc_path),
         .death_pipe = {-1, -1},
+        .worker_pipe = -1,
     };
     char *input_file = mp_get_user_path(arg, global, opts->input_file);
 
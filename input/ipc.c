@@ -17,9 +17,12 @@
 
 #include "config.h"
 
+#include <libavutil/intreadwrite.h>
+
 #include "common/msg.h"
 #include "input/input.h"
 #include "misc/json.h"
+#include "misc/msgpack.h"
 #include "options/m_option.h"
 #include "options/options.h"
 #include "options/path.h"
@@ -120,6 +123,26 @@ static void mpv_node_map_add_string(void *ta_parent, mpv_node *src, const char *
     mpv_node_map_add(ta_parent, src, key, &val_node);
 }
 
+static bool node_get_number(mpv_node *src, double *out)
+{
+    switch (src->format) {
+    case MPV_FORMAT_INT64:  *out = src->u.int64; return true;
+    case MPV_FORMAT_DOUBLE: *out = src->u.double_; return true;
+    default:                return false;
+    }
+}
+
+// Optional interval and delta arguments of observe_property commands.
+static bool get_throttle_args(mpv_node_list *args, double *interval,
+                              double *delta)
+{
+    if (args->num > 3 && !node_get_number(&args->values[3], interval))
+        return false;
+    if (args->num > 4 && !node_get_number(&args->values[4], delta))
+        return false;
+    return true;
+}
+
 static void mpv_event_to_node(void *ta_parent, mpv_event *event, mpv_node *dst)
 {
     mpv_node_map_add_string(ta_parent, dst, "event", mpv_event_name(event->event_id));
@@ -179,7 +202,7 @@ static void mpv_event_to_node(void *ta_parent, mpv_event *event, mpv_node *dst)
 
 char *mp_json_encode_event(mpv_event *event)
 {
-    void *ta_parent = talloc_new(NULL);
+    void *ta_parent = talloc_new_arena(NULL);
     mpv_node event_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
 
     mpv_event_to_node(ta_parent, event, &event_node);
@@ -193,33 +216,25 @@ char *mp_json_encode_event(mpv_event *event)
     return output;
 }
 
-// Function is allowed to modify src[n].
-static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
-                                  char *src)
+// Execute the command message msg_node (NULL if it couldn't be parsed), and
+// return the reply. proto is NULL if the connection can't switch protocols.
+static mpv_node execute_command(struct mpv_handle *client, void *ta_parent,
+                                mpv_node *msg_node, enum mp_ipc_protocol *proto)
 {
     int rc;
     const char *cmd = NULL;
-    struct mp_log *log = mp_client_get_log(client);
 
-    mpv_node msg_node;
     mpv_node reply_node = {.format = MPV_FORMAT_NODE_MAP, .u.list = NULL};
     mpv_node *reqid_node = NULL;
 
-    rc = json_parse(ta_parent, &msg_node, &src, 50);
-    if (rc < 0) {
-        mp_err(log, "malformed JSON received: '%s'\n", src);
-        rc = MPV_ERROR_INVALID_PARAMETER;
-        goto error;
-    }
-
-    if (msg_node.format != MPV_FORMAT_NODE_MAP) {
+    if (!msg_node || msg_node->format != MPV_FORMAT_NODE_MAP) {
         rc = MPV_ERROR_INVALID_PARAMETER;
         goto error;
     }
 
-    reqid_node = mpv_node_map_get(&msg_node, "request_id");
+    reqid_node = mpv_node_map_get(msg_node, "request_id");
 
-    mpv_node *cmd_node = mpv_node_map_get(&msg_node, "command");
+    mpv_node *cmd_node = mpv_node_map_get(msg_node, "command");
     if (!cmd_node ||
         (cmd_node->format != MPV_FORMAT_NODE_ARRAY) ||
         !cmd_node->u.list->num)
@@ -248,6 +263,33 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
         int64_t ver = mpv_client_api_version();
         mpv_node_map_add_int64(ta_parent, &reply_node, "data", ver);
         rc = MPV_ERROR_SUCCESS;
+    } else if (!strcmp("set_protocol", cmd)) {
+        if (cmd_node->u.list->num != 2) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (cmd_node->u.list->values[1].format != MPV_FORMAT_STRING) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (!proto) {
+            rc = MPV_ERROR_NOT_IMPLEMENTED;
+            goto error;
+        }
+
+        // The reply is still sent with the old protocol.
+        const char *name = cmd_node->u.list->values[1].u.string;
+        if (!strcmp(name, "json")) {
+            *proto = MP_IPC_JSON;
+        } else if (!strcmp(name, "msgpack")) {
+            *proto = MP_IPC_MSGPACK;
+        } else {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+        rc = MPV_ERROR_SUCCESS;
     } else if (!strcmp("get_property", cmd)) {
         mpv_node result_node;
 
@@ -267,6 +309,42 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
             mpv_free_node_contents(&result_node);
         }
+    } else if (!strcmp("get_properties", cmd)) {
+        mpv_node result_node;
+
+        if (cmd_node->u.list->num < 2) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        int num = cmd_node->u.list->num - 1;
+        const char **names = talloc_zero_array(ta_parent, const char *, num + 1);
+        for (int n = 0; n < num; n++) {
+            mpv_node *name = &cmd_node->u.list->values[n + 1];
+            if (name->format != MPV_FORMAT_STRING) {
+                rc = MPV_ERROR_INVALID_PARAMETER;
+                goto error;
+            }
+            names[n] = name->u.string;
+        }
+
+        rc = mpv_get_properties(client, names, &result_node);
+        if (rc >= 0) {
+            mpv_node_map_add(ta_parent, &reply_node, "data", &result_node);
+            mpv_free_node_contents(&result_node);
+        }
+    } else if (!strcmp("set_properties", cmd)) {
+        if (cmd_node->u.list->num != 2) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        if (cmd_node->u.list->values[1].format != MPV_FORMAT_NODE_MAP) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        rc = mpv_set_properties(client, &cmd_node->u.list->values[1]);
     } else if (!strcmp("get_property_string", cmd)) {
         if (cmd_node->u.list->num != 2) {
             rc = MPV_ERROR_INVALID_PARAMETER;
@@ -319,7 +397,7 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
                                      cmd_node->u.list->values[1].u.string,
                                      cmd_node->u.list->values[2].u.string);
     } else if (!strcmp("observe_property", cmd)) {
-        if (cmd_node->u.list->num != 3) {
+        if (cmd_node->u.list->num < 3 || cmd_node->u.list->num > 5) {
             rc = MPV_ERROR_INVALID_PARAMETER;
             goto error;
         }
@@ -334,12 +412,18 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
-        rc = mpv_observe_property(client,
-                                  cmd_node->u.list->values[1].u.int64,
-                                  cmd_node->u.list->values[2].u.string,
-                                  MPV_FORMAT_NODE);
+        double interval = 0, delta = 0;
+        if (!get_throttle_args(cmd_node->u.list, &interval, &delta)) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        rc = mpv_observe_property_throttled(client,
+                                            cmd_node->u.list->values[1].u.int64,
+                                            cmd_node->u.list->values[2].u.string,
+                                            MPV_FORMAT_NODE, interval, delta);
     } else if (!strcmp("observe_property_string", cmd)) {
-        if (cmd_node->u.list->num != 3) {
+        if (cmd_node->u.list->num < 3 || cmd_node->u.list->num > 5) {
             rc = MPV_ERROR_INVALID_PARAMETER;
             goto error;
         }
@@ -354,10 +438,16 @@ static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
             goto error;
         }
 
-        rc = mpv_observe_property(client,
-                                  cmd_node->u.list->values[1].u.int64,
-                                  cmd_node->u.list->values[2].u.string,
-                                  MPV_FORMAT_STRING);
+        double interval = 0, delta = 0;
+        if (!get_throttle_args(cmd_node->u.list, &interval, &delta)) {
+            rc = MPV_ERROR_INVALID_PARAMETER;
+            goto error;
+        }
+
+        rc = mpv_observe_property_throttled(client,
+                                            cmd_node->u.list->values[1].u.int64,
+                                            cmd_node->u.list->values[2].u.string,
+                                            MPV_FORMAT_STRING, interval, delta);
     } else if (!strcmp("unobserve_property", cmd)) {
         if (cmd_node->u.list->num != 2) {
             rc = MPV_ERROR_INVALID_PARAMETER;
@@ -436,6 +526,23 @@ error:
 
     mpv_node_map_add_string(ta_parent, &reply_node, "error", mpv_error_string(rc));
 
+    return reply_node;
+}
+
+// Function is allowed to modify src[n].
+static char *json_execute_command(struct mpv_handle *client, void *ta_parent,
+                                  char *src, enum mp_ipc_protocol *proto)
+{
+    mpv_node msg_node;
+    int rc = json_parse(ta_parent, &msg_node, &src, 50);
+    if (rc < 0) {
+        mp_err(mp_client_get_log(client), "malformed JSON received: '%s'\n",
+               src);
+    }
+
+    mpv_node reply_node =
+        execute_command(client, ta_parent, rc < 0 ? NULL : &msg_node, proto);
+
     char *output = talloc_strdup(ta_parent, "");
     json_write(&output, &reply_node);
     output = ta_talloc_strdup_append(output, "\n");
@@ -443,6 +550,133 @@ error:
     return output;
 }
 
+// Start a length-prefixed MessagePack frame.
+static bstr msgpack_begin_frame(void *ta_parent)
+{
+    bstr frame = {0};
+    bstr_xappend(ta_parent, &frame, (bstr){"\0\0\0\0", 4});
+    return frame;
+}
+
+static void msgpack_end_frame(bstr *frame)
+{
+    AV_WB32(frame->start, frame->len - 4);
+}
+
+static bstr msgpack_execute_command(struct mpv_handle *client, void *ctx,
+                                    void *ta_parent, bstr msg,
+                                    enum mp_ipc_protocol *proto)
+{
+    bstr payload = bstr_cut(msg, 4);
+    mpv_node msg_node;
+    bool ok = msgpack_parse(ta_parent, &msg_node, &payload, 50) >= 0 &&
+              !payload.len;
+    if (!ok)
+        mp_err(mp_client_get_log(client), "malformed MessagePack received\n");
+
+    mpv_node reply_node =
+        execute_command(client, ta_parent, ok ? &msg_node : NULL, proto);
+
+    bstr reply = msgpack_begin_frame(ctx);
+    msgpack_write(&reply, &reply_node);
+    msgpack_end_frame(&reply);
+    return reply;
+}
+
+// Write the event directly, without building a mpv_node like
+// mpv_event_to_node() (the result is the same).
+static void msgpack_write_event(bstr *dst, mpv_event *event)
+{
+    int num = 1 + !!event->reply_userdata + (event->error < 0);
+    switch (event->event_id) {
+    case MPV_EVENT_LOG_MESSAGE:     num += 3; break;
+    case MPV_EVENT_CLIENT_MESSAGE:  num += 1; break;
+    case MPV_EVENT_PROPERTY_CHANGE: num += 2; break;
+    default: ;
+    }
+    msgpack_write_map(dst, num);
+
+    msgpack_write_str(dst, "event");
+    msgpack_write_str(dst, mpv_event_name(event->event_id));
+
+    if (event->reply_userdata) {
+        msgpack_write_str(dst, "id");
+        msgpack_write_int(dst, event->reply_userdata);
+    }
+
+    if (event->error < 0) {
+        msgpack_write_str(dst, "error");
+        msgpack_write_str(dst, mpv_error_string(event->error));
+    }
+
+    switch (event->event_id) {
+    case MPV_EVENT_LOG_MESSAGE: {
+        mpv_event_log_message *msg = event->data;
+
+        msgpack_write_str(dst, "prefix");
+        msgpack_write_str(dst, msg->prefix);
+        msgpack_write_str(dst, "level");
+        msgpack_write_str(dst, msg->level);
+        msgpack_write_str(dst, "text");
+        msgpack_write_str(dst, msg->text);
+        break;
+    }
+
+    case MPV_EVENT_CLIENT_MESSAGE: {
+        mpv_event_client_message *msg = event->data;
+
+        msgpack_write_str(dst, "args");
+        msgpack_write_array(dst, msg->num_args);
+        for (int n = 0; n < msg->num_args; n++)
+            msgpack_write_str(dst, msg->args[n]);
+        break;
+    }
+
+    case MPV_EVENT_PROPERTY_CHANGE: {
+        mpv_event_property *prop = event->data;
+
+        msgpack_write_str(dst, "name");
+        msgpack_write_str(dst, prop->name);
+
+        msgpack_write_str(dst, "data");
+        switch (prop->format) {
+        case MPV_FORMAT_NODE:
+            msgpack_write(dst, prop->data);
+            break;
+        case MPV_FORMAT_DOUBLE:
+            msgpack_write_double(dst, *(double *)prop->data);
+            break;
+        case MPV_FORMAT_FLAG:
+            msgpack_write_bool(dst, *(int *)prop->data);
+            break;
+        case MPV_FORMAT_STRING:
+            msgpack_write_str(dst, *(char **)prop->data);
+            break;
+        default:
+            msgpack_write_nil(dst);
+        }
+        break;
+    }
+    default: ;
+    }
+}
+
+bstr mp_ipc_encode_event(void *ctx, enum mp_ipc_protocol proto,
+                         struct mpv_event *event)
+{
+    switch (proto) {
+    case MP_IPC_JSON:
+        return bstr0(talloc_steal(ctx, mp_json_encode_event(event)));
+    case MP_IPC_MSGPACK: {
+        bstr frame = msgpack_begin_frame(ctx);
+        msgpack_write_event(&frame, event);
+        msgpack_end_frame(&frame);
+        return frame;
+    }
+    }
+    abort();
+}
+
 static char *text_execute_command(struct mpv_handle *client, void *tmp, char *src)
 {
     mpv_command_string(client, src);
@@ -450,15 +684,11 @@ static char *text_execute_command(struct mpv_handle *client, void *tmp, char *sr
     return NULL;
 }
 
-char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf)
+// Execute a JSON or text command line.
+static char *execute_line(struct mpv_handle *client, void *ta_parent,
+                          bstr line, enum mp_ipc_protocol *proto)
 {
-    void *tmp = talloc_new(NULL);
-
-    bstr rest;
-    bstr line = bstr_getline(*buf, &rest);
-    char *line0 = bstrto0(tmp, line);
-    talloc_steal(tmp, buf->start);
-    *buf = bstrdup(NULL, rest);
+    char *line0 = bstrto0(ta_parent, line);
 
     json_skip_whitespace(&line0);
 
@@ -466,12 +696,67 @@ char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *bu
     if (line0[0] == '\0' || line0[0] == '#') {
         // skip
     } else if (line0[0] == '{') {
-        reply_msg = json_execute_command(client, tmp, line0);
+        reply_msg = json_execute_command(client, ta_parent, line0, proto);
     } else {
-        reply_msg = text_execute_command(client, tmp, line0);
+        reply_msg = text_execute_command(client, ta_parent, line0);
     }
+    return reply_msg;
+}
+
+char *mp_ipc_consume_next_command(struct mpv_handle *client, void *ctx, bstr *buf)
+{
+    void *tmp = talloc_new_arena(NULL);
 
-    talloc_steal(ctx, reply_msg);
+    bstr rest;
+    bstr line = bstr_getline(*buf, &rest);
+    talloc_steal(tmp, buf->start);
+    *buf = bstrdup(NULL, rest);
+
+    // (Can't steal the reply out of the arena.)
+    char *reply_msg = talloc_strdup(ctx, execute_line(client, tmp, line, NULL));
     talloc_free(tmp);
     return reply_msg;
 }
+
+// Larger MessagePack frames are considered a protocol error.
+#define MAX_FRAME_SIZE (64 * 1024 * 1024)
+
+int64_t mp_ipc_next_message(enum mp_ipc_protocol proto, bstr buf)
+{
+    switch (proto) {
+    case MP_IPC_JSON: {
+        int end = bstrchr(buf, '\n');
+        return end < 0 ? 0 : end + 1;
+    }
+    case MP_IPC_MSGPACK: {
+        if (buf.len < 4)
+            return 0;
+        uint32_t len = AV_RB32(buf.start);
+        if (len > MAX_FRAME_SIZE)
+            return -1;
+        return buf.len - 4 >= len ? 4 + (int64_t)len : 0;
+    }
+    }
+    abort();
+}
+
+bstr mp_ipc_execute_message(struct mpv_handle *client, void *ctx,
+                            enum mp_ipc_protocol *proto, bstr msg)
+{
+    // All temporary data (parsed message, property values, reply string) goes
+    // into an arena, which is freed with a few block frees at the end.
+    void *tmp = talloc_new_arena(NULL);
+    bstr reply = {0};
+
+    switch (*proto) {
+    case MP_IPC_JSON:
+        reply = bstr0(talloc_strdup(ctx, execute_line(client, tmp, msg, proto)));
+        break;
+    case MP_IPC_MSGPACK:
+        reply = msgpack_execute_command(client, ctx, tmp, msg, proto);
+        break;
+    }
+
+    talloc_free(tmp);
+    return reply;
+}
@@ -210,7 +210,7 @@ extern "C" {
  * relational operators (<, >, <=, >=).
  */
 #define MPV_MAKE_VERSION(major, minor) (((major) << 16) | (minor) | 0UL)
-#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 100)
+#define MPV_CLIENT_API_VERSION MPV_MAKE_VERSION(1, 102)
 
 /**
  * The API user is allowed to "#define MPV_ENABLE_DEPRECATED 0" before
@@ -1024,6 +1024,18 @@ int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format,
  */
 int mpv_set_property_string(mpv_handle *ctx, const char *name, const char *data);
 
+/**
+ * Set several properties at once, in the order of the map entries. Like with
+ * mpv_get_properties(), the core is locked only once for all of them.
+ *
+ * All properties are attempted even if setting one of them fails.
+ *
+ * @param map a MPV_FORMAT_NODE_MAP, mapping property names to new values
+ *            (as with mpv_set_property() and MPV_FORMAT_NODE).
+ * @return error code of the first property that failed, or 0
+ */
+int mpv_set_properties(mpv_handle *ctx, mpv_node *map);
+
 /**
  * Set a property asynchronously. You will receive the result of the operation
  * as MPV_EVENT_SET_PROPERTY_REPLY event. The mpv_event.error field will contain
@@ -1098,6 +1110,20 @@ char *mpv_get_property_osd_string(mpv_handle *ctx, const char *name);
 int mpv_get_property_async(mpv_handle *ctx, uint64_t reply_userdata,
                            const char *name, mpv_format format);
 
+/**
+ * Read the values of several properties at once. The properties are read in
+ * one go while the core is locked, so the values are consistent with each
+ * other, and the locking overhead is paid only once.
+ *
+ * @param names NULL-terminated list of property names.
+ * @param[out] result Set to a MPV_FORMAT_NODE_MAP with an entry for each name,
+ *                    in the same order. The entry for a property that could
+ *                    not be read is set to MPV_FORMAT_NONE. Free the result
+ *                    with mpv_free_node_contents().
+ * @return error code (the status of individual properties is not reported)
+ */
+int mpv_get_properties(mpv_handle *ctx, const char **names, mpv_node *result);
+
 /**
  * Get a notification whenever the given property changes. You will receive
  * updates as MPV_EVENT_PROPERTY_CHANGE. Note that this is not very precise:
@@ -1151,6 +1177,31 @@ int mpv_get_property_async(mpv_handle *ctx, uint64_t reply_userdata,
 int mpv_observe_property(mpv_handle *mpv, uint64_t reply_userdata,
                          const char *name, mpv_format format);
 
+/**
+ * Like mpv_observe_property(), but limit the rate of change events. This is
+ * useful for properties which change very often, such as "time-pos".
+ *
+ * Changes that happen within min_interval seconds after the last change event
+ * for this property are coalesced: only one event is sent once the interval
+ * has passed, and it contains the latest value.
+ *
+ * If min_delta is set, and the property is observed with MPV_FORMAT_INT64,
+ * MPV_FORMAT_DOUBLE, or MPV_FORMAT_NODE (and the value is a number), changes
+ * whose absolute difference to the last reported value is less than min_delta
+ * are not reported. Other changes (including the property becoming
+ * unavailable) are always reported.
+ *
+ * Use mpv_unobserve_property() to remove the observer.
+ *
+ * @param min_interval minimum time between change events in seconds, or 0
+ * @param min_delta minimum change of numeric values, or 0
+ * @return error code (MPV_ERROR_INVALID_PARAMETER if min_interval or min_delta
+ *         is negative)
+ */
+int mpv_observe_property_throttled(mpv_handle *mpv, uint64_t reply_userdata,
+                                   const char *name, mpv_format format,
+                                   double min_interval, double min_delta);
+
 /**
  * Undo mpv_observe_property(). This will remove all observed properties for
  * which the given number was passed as reply_userdata to mpv_observe_property.
@@ -19,12 +19,22 @@
 #include <assert.h>
 
 #include "common/common.h"
+#include "osdep/atomic.h"
 #include "osdep/threads.h"
 #include "osdep/timer.h"
 
 #include "dispatch.h"
 
 struct mp_dispatch_queue {
+    // Newly appended items, newest first. Producers push to it without taking
+    // the lock; it's moved to head/tail (with the lock held) before the list is
+    // used.
+    mp_atomic_ptr incoming;
+    // Set if the target thread is known to be awake and will look at incoming
+    // before blocking or returning from mp_dispatch_queue_process(). Producers
+    // skip the wakeup while it's set.
+    atomic_bool wakeup_pending;
+    // --- the following fields are protected by lock
     struct mp_dispatch_item *head, *tail;
     pthread_mutex_t lock;
     pthread_cond_t cond;
@@ -68,6 +78,7 @@ static void queue_dtor(void *p)
 {
     struct mp_dispatch_queue *queue = p;
     assert(!queue->head);
+    assert(!atomic_load(&queue->incoming));
     assert(!queue->idling);
     assert(!queue->lock_request);
     assert(!queue->frame);
@@ -110,29 +121,67 @@ void mp_dispatch_set_wakeup_fn(struct mp_dispatch_queue *queue,
     queue->wakeup_ctx = wakeup_ctx;
 }
 
-static void mp_dispatch_append(struct mp_dispatch_queue *queue,
-                               struct mp_dispatch_item *item)
+// Append the item to the locked list. Must be called with the lock held.
+static void append_locked(struct mp_dispatch_queue *queue,
+                          struct mp_dispatch_item *item)
 {
-    pthread_mutex_lock(&queue->lock);
     if (item->mergeable) {
         for (struct mp_dispatch_item *cur = queue->head; cur; cur = cur->next) {
             if (cur->mergeable && cur->fn == item->fn &&
                 cur->fn_data == item->fn_data)
             {
                 talloc_free(item);
-                pthread_mutex_unlock(&queue->lock);
                 return;
             }
         }
     }
 
+    item->next = NULL;
     if (queue->tail) {
         queue->tail->next = item;
     } else {
         queue->head = item;
     }
     queue->tail = item;
+}
+
+// Move all items from incoming to the locked list, in the order they were
+// appended. Must be called with the lock held.
+static void drain_incoming(struct mp_dispatch_queue *queue)
+{
+    if (!atomic_load(&queue->incoming))
+        return;
+    struct mp_dispatch_item *list = atomic_exchange(&queue->incoming, NULL);
+
+    struct mp_dispatch_item *reversed = NULL;
+    while (list) {
+        struct mp_dispatch_item *next = list->next;
+        list->next = reversed;
+        reversed = list;
+        list = next;
+    }
+    while (reversed) {
+        struct mp_dispatch_item *item = reversed;
+        reversed = item->next;
+        append_locked(queue, item);
+    }
+}
 
+static void mp_dispatch_append(struct mp_dispatch_queue *queue,
+                               struct mp_dispatch_item *item)
+{
+    void *head = atomic_load(&queue->incoming);
+    do {
+        item->next = head;
+    } while (!atomic_compare_exchange_strong(&queue->incoming, &head, item));
+
+    // Only the first producer since the target thread went idle needs to wake
+    // it up. (Check before writing to avoid cache line ping-pong.)
+    if (atomic_load(&queue->wakeup_pending) ||
+        atomic_exchange(&queue->wakeup_pending, true))
+        return;
+
+    pthread_mutex_lock(&queue->lock);
     // Wake up the main thread; note that other threads might wait on this
     // condition for reasons, so broadcast the condition.
     pthread_cond_broadcast(&queue->cond);
@@ -206,6 +255,7 @@ void mp_dispatch_cancel_fn(struct mp_dispatch_queue *queue,
                            mp_dispatch_fn fn, void *fn_data)
 {
     pthread_mutex_lock(&queue->lock);
+    drain_incoming(queue);
     struct mp_dispatch_item **pcur = &queue->head;
     queue->tail = NULL;
     while (*pcur) {
@@ -271,6 +321,7 @@ void mp_dispatch_queue_process(struct mp_dispatch_queue *queue, double timeout)
     if (queue->lock_request)
         pthread_cond_broadcast(&queue->cond);
     while (1) {
+        drain_incoming(queue);
         if (queue->lock_request || queue->frame != &frame || frame.locked) {
             // Block due to something having called mp_dispatch_lock(). This
             // is either a lock "acquire" (lock_request=true), or a lock in
@@ -306,12 +357,19 @@ void mp_dispatch_queue_process(struct mp_dispatch_queue *queue, double timeout)
             } else {
                 item->completed = true;
             }
-        } else if (wait > 0 && !queue->interrupted) {
-            struct timespec ts = mp_time_us_to_timespec(wait);
-            if (pthread_cond_timedwait(&queue->cond, &queue->lock, &ts))
-                wait = 0;
         } else {
-            break;
+            // Going to block or return: producers must wake us up from now on.
+            // Paired with the wakeup_pending check in mp_dispatch_append().
+            atomic_store(&queue->wakeup_pending, false);
+            if (atomic_load(&queue->incoming))
+                continue;
+            if (wait > 0 && !queue->interrupted) {
+                struct timespec ts = mp_time_us_to_timespec(wait);
+                if (pthread_cond_timedwait(&queue->cond, &queue->lock, &ts))
+                    wait = 0;
+            } else {
+                break;
+            }
         }
     }
     queue->idling = false;
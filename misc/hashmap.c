@@ -0,0 +1,135 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "common/common.h"
+
+#include "hashmap.h"
+
+struct entry {
+    bstr key;       // key.start==NULL: empty slot
+    uint32_t hash;
+    int value;
+};
+
+// Open addressing with linear probing. Deletion uses backward shifting, so
+// there are no tombstones.
+struct mp_hashmap {
+    struct entry *entries;
+    int size;       // power of 2 (or 0)
+    int count;
+};
+
+static uint32_t hash_bstr(bstr key)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t n = 0; n < key.len; n++) {
+        h ^= key.start[n];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+struct mp_hashmap *mp_hashmap_create(void *ta_parent)
+{
+    return talloc_zero(ta_parent, struct mp_hashmap);
+}
+
+static struct entry *lookup(struct mp_hashmap *map, bstr key, uint32_t hash)
+{
+    if (!map->size)
+        return NULL;
+    int mask = map->size - 1;
+    for (int i = hash & mask; ; i = (i + 1) & mask) {
+        struct entry *e = &map->entries[i];
+        if (!e->key.start || (e->hash == hash && bstr_equals(e->key, key)))
+            return e;
+    }
+}
+
+static void resize(struct mp_hashmap *map, int new_size)
+{
+    struct entry *old = map->entries;
+    int old_size = map->size;
+
+    map->entries = talloc_zero_array(map, struct entry, new_size);
+    map->size = new_size;
+    for (int n = 0; n < old_size; n++) {
+        if (old[n].key.start)
+            *lookup(map, old[n].key, old[n].hash) = old[n];
+    }
+    talloc_free(old);
+}
+
+void mp_hashmap_set(struct mp_hashmap *map, bstr key, int value)
+{
+    // Keep the load factor at or below 1/2.
+    if ((map->count + 1) * 2 > map->size)
+        resize(map, MPMAX(map->size * 2, 16));
+
+    uint32_t hash = hash_bstr(key);
+    struct entry *e = lookup(map, key, hash);
+    if (!e->key.start) {
+        // (Make sure the key is non-NULL even if it has 0 length.)
+        e->key = (bstr){talloc_memdup(map, key.start ? (void *)key.start : "",
+                                      key.len), key.len};
+        e->hash = hash;
+        map->count++;
+    }
+    e->value = value;
+}
+
+int *mp_hashmap_find(struct mp_hashmap *map, bstr key)
+{
+    struct entry *e = lookup(map, key, hash_bstr(key));
+    return e && e->key.start ? &e->value : NULL;
+}
+
+bool mp_hashmap_remove(struct mp_hashmap *map, bstr key)
+{
+    struct entry *e = lookup(map, key, hash_bstr(key));
+    if (!e || !e->key.start)
+        return false;
+
+    talloc_free(e->key.start);
+    map->count--;
+
+    // Move following entries of the same probe sequence into the hole.
+    int mask = map->size - 1;
+    int hole = e - map->entries;
+    for (int i = (hole + 1) & mask; map->entries[i].key.start; i = (i + 1) & mask) {
+        int home = map->entries[i].hash & mask;
+        // Can the entry at i be moved to the hole? Only if its home position
+        // is not cyclically in (hole, i].
+        bool in_range = hole <= i ? (home > hole && home <= i)
+                                  : (home > hole || home <= i);
+        if (!in_range) {
+            map->entries[hole] = map->entries[i];
+            hole = i;
+        }
+    }
+    map->entries[hole] = (struct entry){0};
+    return true;
+}
+
+int mp_hashmap_count(struct mp_hashmap *map)
+{
+    return map->count;
+}
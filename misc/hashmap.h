@@ -0,0 +1,44 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_HASHMAP_H
+#define MP_HASHMAP_H
+
+#include "misc/bstr.h"
+
+// Simple hash table mapping byte strings to ints (typically indexes into some
+// other array). Keys are copied. Not thread-safe.
+struct mp_hashmap;
+
+struct mp_hashmap *mp_hashmap_create(void *ta_parent);
+
+// Add the key, or overwrite the value of an existing entry.
+void mp_hashmap_set(struct mp_hashmap *map, bstr key, int value);
+
+// Return a pointer to the value for the key, or NULL if it's not in the map.
+// The pointer is valid until the next call that changes the map.
+int *mp_hashmap_find(struct mp_hashmap *map, bstr key);
+
+bool mp_hashmap_remove(struct mp_hashmap *map, bstr key);
+
+int mp_hashmap_count(struct mp_hashmap *map);
+
+// For using pointers as keys.
+#define MP_HASHMAP_PTR_KEY(ptr) \
+    ((bstr){(unsigned char *)&(void *){(void *)(ptr)}, sizeof(void *)})
+
+#endif
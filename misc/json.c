@@ -75,6 +75,44 @@ void json_skip_whitespace(char **src)
     eat_ws(src);
 }
 
+struct json_parser {
+    void *ta_parent;
+
+    // Elements of all lists that are currently being parsed. A list is copied
+    // to an exactly sized allocation once it's complete. (Keys are only set
+    // for objects.) Initially points to the _buf arrays, which are enough for
+    // small messages.
+    struct mpv_node *values;
+    char **keys;
+    int num_values, alloc_values;
+    struct mpv_node values_buf[16];
+    char *keys_buf[16];
+};
+
+static void push_value(struct json_parser *p, struct mpv_node *value, char *key)
+{
+    if (p->num_values == p->alloc_values) {
+        int alloc = p->alloc_values * 2;
+        struct mpv_node *values = talloc_array(NULL, struct mpv_node, alloc);
+        char **keys = talloc_array(NULL, char *, alloc);
+        memcpy(values, p->values, p->num_values * sizeof(values[0]));
+        memcpy(keys, p->keys, p->num_values * sizeof(keys[0]));
+        if (p->values != p->values_buf) {
+            talloc_free(p->values);
+            talloc_free(p->keys);
+        }
+        p->values = values;
+        p->keys = keys;
+        p->alloc_values = alloc;
+    }
+    p->values[p->num_values] = *value;
+    p->keys[p->num_values] = key;
+    p->num_values++;
+}
+
+static int parse_node(struct json_parser *p, struct mpv_node *dst, char **src,
+                      int max_depth);
+
 static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
 {
     if (!eat_c(src, '"'))
@@ -82,13 +120,16 @@ static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
     char *str = *src;
     char *cur = str;
     bool has_escapes = false;
-    while (cur[0] && cur[0] != '"') {
-        if (cur[0] == '\\') {
-            has_escapes = true;
-            // skip >\"< and >\\< (latter to handle >\\"< correctly)
-            if (cur[1] == '"' || cur[1] == '\\')
-                cur++;
-        }
+    while (1) {
+        // strcspn() is typically vectorized; most strings have no escapes at
+        // all, so this usually finds the end in one call.
+        cur += strcspn(cur, "\"\\");
+        if (cur[0] != '\\')
+            break;
+        has_escapes = true;
+        // skip >\"< and >\\< (latter to handle >\\"< correctly)
+        if (cur[1] == '"' || cur[1] == '\\')
+            cur++;
         cur++;
     }
     if (cur[0] != '"')
@@ -109,7 +150,7 @@ static int read_str(void *ta_parent, struct mpv_node *dst, char **src)
     return 0;
 }
 
-static int read_sub(void *ta_parent, struct mpv_node *dst, char **src,
+static int read_sub(struct json_parser *p, struct mpv_node *dst, char **src,
                     int max_depth)
 {
     bool is_arr = eat_c(src, '[');
@@ -117,47 +158,48 @@ static int read_sub(void *ta_parent, struct mpv_node *dst, char **src,
     if (!is_arr && !is_obj)
         return -1; // not an array or object
     char term = is_obj ? '}' : ']';
-    struct mpv_node_list *list = talloc_zero(ta_parent, struct mpv_node_list);
+    int first = p->num_values;
     while (1) {
         eat_ws(src);
         if (eat_c(src, term))
             break;
-        if (list->num > 0 && !eat_c(src, ','))
+        if (p->num_values > first && !eat_c(src, ','))
             return -1; // missing ','
         eat_ws(src);
+        struct mpv_node keynode = {0};
         if (is_obj) {
-            struct mpv_node keynode;
-            if (read_str(list, &keynode, src) < 0)
+            if (read_str(p->ta_parent, &keynode, src) < 0)
                 return -1; // key is not a string
             eat_ws(src);
             if (!eat_c(src, ':'))
                 return -1; // ':' missing
             eat_ws(src);
-            MP_TARRAY_GROW(list, list->keys, list->num);
-            list->keys[list->num] = keynode.u.string;
         }
-        MP_TARRAY_GROW(list, list->values, list->num);
-        if (json_parse(ta_parent, &list->values[list->num], src, max_depth) < 0)
+        struct mpv_node value;
+        if (parse_node(p, &value, src, max_depth) < 0)
             return -1;
-        list->num++;
+        // (parse_node() can reallocate the arrays, so append only now.)
+        push_value(p, &value, keynode.u.string);
     }
+    int num = p->num_values - first;
+    struct mpv_node_list *list = talloc_ptrtype(p->ta_parent, list);
+    *list = (struct mpv_node_list){.num = num};
+    if (num) {
+        list->values = talloc_array(list, struct mpv_node, num);
+        memcpy(list->values, p->values + first, num * sizeof(list->values[0]));
+        if (is_obj) {
+            list->keys = talloc_array(list, char *, num);
+            memcpy(list->keys, p->keys + first, num * sizeof(list->keys[0]));
+        }
+    }
+    p->num_values = first;
     dst->format = is_obj ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
     dst->u.list = list;
     return 0;
 }
 
-/* Parse the string in *src as JSON, and write the result into *dst.
- * max_depth limits the recursion and JSON tree depth.
- * Warning: this overwrites the input string (what *src points to)!
- * Returns:
- *   0: success, *dst is valid, *src points to the end (the caller must check
- *      whether *src really terminates)
- *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
- *      (ta_free_children(ta_parent) is the only way to free them)
- * The input string can be mutated in both cases. *dst might contain string
- * elements, which point into the (mutated) input string.
- */
-int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
+static int parse_node(struct json_parser *p, struct mpv_node *dst, char **src,
+                      int max_depth)
 {
     max_depth -= 1;
     if (max_depth < 0)
@@ -183,9 +225,9 @@ int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
         dst->u.flag = 0;
         return 0;
     } else if (c == '"') {
-        return read_str(ta_parent, dst, src);
+        return read_str(p->ta_parent, dst, src);
     } else if (c == '[' || c == '{') {
-        return read_sub(ta_parent, dst, src, max_depth);
+        return read_sub(p, dst, src, max_depth);
     } else if (c == '-' || (c >= '0' && c <= '9')) {
         // The number could be either a float or an int. JSON doesn't make a
         // difference, but the client API does.
@@ -194,6 +236,16 @@ int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
         long long int numi = strtoll(*src, &nsrci, 0);
         if (errno)
             nsrci = *src;
+        // strtod() can't parse more than this, so skip it.
+        char next = *nsrci;
+        if (nsrci > *src && next != '.' && next != 'e' && next != 'E' &&
+            next != 'p' && next != 'P')
+        {
+            *src = nsrci;
+            dst->format = MPV_FORMAT_INT64;
+            dst->u.int64 = numi;
+            return 0;
+        }
         errno = 0;
         double numf = strtod(*src, &nsrcf);
         if (errno)
@@ -215,23 +267,106 @@ int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
     return -1; // character doesn't start a valid token
 }
 
+/* Parse the string in *src as JSON, and write the result into *dst.
+ * max_depth limits the recursion and JSON tree depth.
+ * Warning: this overwrites the input string (what *src points to)!
+ * Returns:
+ *   0: success, *dst is valid, *src points to the end (the caller must check
+ *      whether *src really terminates)
+ *  -1: failure, *dst is invalid, there may be dead allocs under ta_parent
+ *      (ta_free_children(ta_parent) is the only way to free them)
+ * The input string can be mutated in both cases. *dst might contain string
+ * elements, which point into the (mutated) input string.
+ * If the result is freed as a whole, parsing into a ta_new_arena() is faster.
+ */
+int json_parse(void *ta_parent, struct mpv_node *dst, char **src, int max_depth)
+{
+    struct json_parser p = {
+        .ta_parent = ta_parent,
+        .alloc_values = MP_ARRAY_SIZE(p.values_buf),
+    };
+    p.values = p.values_buf;
+    p.keys = p.keys_buf;
+    int r = parse_node(&p, dst, src, max_depth);
+    if (p.values != p.values_buf) {
+        talloc_free(p.values);
+        talloc_free(p.keys);
+    }
+    return r;
+}
+
+// Make sure there's space for n more bytes and a terminating 0 in b, and
+// return the end of the string.
+static char *reserve(bstr *b, size_t n)
+{
+    size_t size = talloc_get_size(b->start);
+    if (b->len + n + 1 > size) {
+        size = MPMAX(size * 2, b->len + n + 1);
+        b->start = talloc_realloc_size(NULL, b->start, size);
+    }
+    return b->start + b->len;
+}
 
-#define APPEND(b, s) bstr_xappend(NULL, (b), bstr0(s))
+static void append(bstr *b, const void *data, size_t len)
+{
+    memcpy(reserve(b, len), data, len);
+    b->len += len;
+}
+
+#define APPEND(b, s) append((b), (s), strlen(s))
+
+static bool needs_escape(unsigned char c)
+{
+    return c < 32 || c == '"' || c == '\\';
+}
+
+#define BYTES_1 0x0101010101010101ULL
+#define BYTES_80 0x8080808080808080ULL
+// Nonzero if any byte in x is < n (n <= 128).
+#define HAS_LESS(x, n) (((x) - BYTES_1 * (n)) & ~(x) & BYTES_80)
+// Nonzero if any byte in x is c.
+#define HAS_BYTE(x, c) HAS_LESS((x) ^ (BYTES_1 * (c)), 1)
+
+// Return the length of the prefix of str that needs no escaping. Checks 8
+// bytes at once, since most strings don't need any escaping.
+static size_t plain_run(const unsigned char *str, size_t len)
+{
+    size_t n = 0;
+    for (; n + 8 <= len; n += 8) {
+        uint64_t x;
+        memcpy(&x, str + n, 8);
+        if (HAS_LESS(x, 32) || HAS_BYTE(x, '"') || HAS_BYTE(x, '\\'))
+            break;
+    }
+    while (n < len && !needs_escape(str[n]))
+        n++;
+    return n;
+}
 
 static void write_json_str(bstr *b, unsigned char *str)
 {
+    size_t len = strlen(str);
+    size_t run = plain_run(str, len);
+    if (run == len) {
+        char *dst = reserve(b, len + 2);
+        dst[0] = '"';
+        memcpy(dst + 1, str, len);
+        dst[len + 1] = '"';
+        b->len += len + 2;
+        return;
+    }
     APPEND(b, "\"");
-    while (1) {
-        unsigned char *cur = str;
-        while (cur[0] >= 32 && cur[0] != '"' && cur[0] != '\\')
-            cur++;
-        if (!cur[0])
+    while (len) {
+        run = plain_run(str, len);
+        append(b, str, run);
+        if (run == len)
             break;
-        bstr_xappend(NULL, b, (bstr){str, cur - str});
-        bstr_xappend_asprintf(NULL, b, "\\u%04x", (unsigned char)cur[0]);
-        str = cur + 1;
+        char esc[8];
+        snprintf(esc, sizeof(esc), "\\u%04x", str[run]);
+        APPEND(b, esc);
+        str += run + 1;
+        len -= run + 1;
     }
-    APPEND(b, str);
     APPEND(b, "\"");
 }
 
@@ -239,9 +374,10 @@ static void add_indent(bstr *b, int indent)
 {
     if (indent < 0)
         return;
-    bstr_xappend(NULL, b, bstr0("\n"));
-    for (int n = 0; n < indent; n++)
-        bstr_xappend(NULL, b, bstr0(" "));
+    char *dst = reserve(b, indent + 1);
+    dst[0] = '\n';
+    memset(dst + 1, ' ', indent);
+    b->len += indent + 1;
 }
 
 static int json_append(bstr *b, const struct mpv_node *src, int indent)
@@ -253,9 +389,12 @@ static int json_append(bstr *b, const struct mpv_node *src, int indent)
     case MPV_FORMAT_FLAG:
         APPEND(b, src->u.flag ? "true" : "false");
         return 0;
-    case MPV_FORMAT_INT64:
-        bstr_xappend_asprintf(NULL, b, "%"PRId64, src->u.int64);
+    case MPV_FORMAT_INT64: {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%"PRId64, src->u.int64);
+        APPEND(b, buf);
         return 0;
+    }
     case MPV_FORMAT_DOUBLE:
         bstr_xappend_asprintf(NULL, b, "%f", src->u.double_);
         return 0;
@@ -286,10 +425,44 @@ static int json_append(bstr *b, const struct mpv_node *src, int indent)
     return -1; // unknown format
 }
 
+// Estimate the size of the output of json_append(). This is exact, except for
+// numbers and strings that need escaping.
+static size_t estimate_size(const struct mpv_node *src, int indent)
+{
+    switch (src->format) {
+    case MPV_FORMAT_NONE:       return 4;
+    case MPV_FORMAT_FLAG:       return 5;
+    case MPV_FORMAT_INT64:      return 20;
+    case MPV_FORMAT_DOUBLE:     return 16;
+    case MPV_FORMAT_STRING:     return strlen(src->u.string) + 2;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP: {
+        struct mpv_node_list *list = src->u.list;
+        bool is_obj = src->format == MPV_FORMAT_NODE_MAP;
+        int next_indent = indent >= 0 ? indent + 1 : -1;
+        size_t size = 2 + (indent >= 0 ? indent + 1 : 0);
+        for (int n = 0; n < list->num; n++) {
+            size += 1 + (next_indent >= 0 ? next_indent + 1 : 0);
+            if (is_obj)
+                size += strlen(list->keys[n]) + 3;
+            size += estimate_size(&list->values[n], next_indent);
+        }
+        return size;
+    }
+    }
+    return 0;
+}
+
 static int json_append_str(char **dst, struct mpv_node *src, int indent)
 {
     bstr buffer = bstr0(*dst);
+    // Reserve the space up front, so that appending usually doesn't need to
+    // reallocate at all.
+    size_t size = buffer.len + estimate_size(src, indent) + 1;
+    if (talloc_get_size(buffer.start) < size)
+        buffer.start = talloc_realloc_size(NULL, buffer.start, size);
     int r = json_append(&buffer, src, indent);
+    reserve(&buffer, 0)[0] = '\0';
     *dst = buffer.start;
     return r;
 }
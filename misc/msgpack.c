@@ -0,0 +1,338 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* MessagePack parser and writer, mapping to and from mpv_node.
+ *
+ * See: https://github.com/msgpack/msgpack/blob/master/spec.md
+ *
+ * Parser: ext types and unsigned integers larger than INT64_MAX are rejected.
+ * Map keys must be strings. Strings are 0-terminated copies (so strings with
+ * embedded 0 bytes are cut), bin objects become MPV_FORMAT_BYTE_ARRAY.
+ *
+ * Writer: integers and containers use the smallest encoding; doubles are
+ * always written as float 64.
+ */
+
+#include <string.h>
+
+#include <libavutil/intreadwrite.h>
+#include <libavutil/intfloat.h>
+
+#include "common/common.h"
+
+#include "msgpack.h"
+
+static bool read_bytes(bstr *src, size_t n, const unsigned char **out)
+{
+    if (src->len < n)
+        return false;
+    *out = src->start;
+    *src = bstr_cut(*src, n);
+    return true;
+}
+
+static bool read_uint(bstr *src, int bytes, uint64_t *out)
+{
+    const unsigned char *p;
+    if (!read_bytes(src, bytes, &p))
+        return false;
+    switch (bytes) {
+    case 1: *out = p[0]; break;
+    case 2: *out = AV_RB16(p); break;
+    case 4: *out = AV_RB32(p); break;
+    case 8: *out = AV_RB64(p); break;
+    }
+    return true;
+}
+
+static int read_str(void *ta_parent, struct mpv_node *dst, bstr *src,
+                    size_t len)
+{
+    const unsigned char *p;
+    if (!read_bytes(src, len, &p))
+        return -1;
+    dst->format = MPV_FORMAT_STRING;
+    dst->u.string = talloc_strndup(ta_parent, p, len);
+    return 0;
+}
+
+static int read_bin(void *ta_parent, struct mpv_node *dst, bstr *src,
+                    size_t len)
+{
+    const unsigned char *p;
+    if (!read_bytes(src, len, &p))
+        return -1;
+    struct mpv_byte_array *ba = talloc_ptrtype(ta_parent, ba);
+    *ba = (struct mpv_byte_array){
+        .data = talloc_memdup(ta_parent, (void *)p, len),
+        .size = len,
+    };
+    dst->format = MPV_FORMAT_BYTE_ARRAY;
+    dst->u.ba = ba;
+    return 0;
+}
+
+static int read_list(void *ta_parent, struct mpv_node *dst, bstr *src,
+                     size_t num, bool is_map, int max_depth)
+{
+    if (max_depth <= 0)
+        return -1;
+    // Each entry needs at least 1 byte (2 for maps); reject bogus sizes before
+    // allocating.
+    if (num > src->len)
+        return -1;
+    struct mpv_node_list *list = talloc_zero(ta_parent, struct mpv_node_list);
+    dst->format = is_map ? MPV_FORMAT_NODE_MAP : MPV_FORMAT_NODE_ARRAY;
+    dst->u.list = list;
+    list->values = talloc_zero_array(ta_parent, struct mpv_node, num);
+    if (is_map)
+        list->keys = talloc_zero_array(ta_parent, char *, num);
+    for (size_t n = 0; n < num; n++) {
+        if (is_map) {
+            struct mpv_node key;
+            if (msgpack_parse(ta_parent, &key, src, max_depth - 1) < 0)
+                return -1;
+            if (key.format != MPV_FORMAT_STRING)
+                return -1;
+            list->keys[n] = key.u.string;
+        }
+        if (msgpack_parse(ta_parent, &list->values[n], src, max_depth - 1) < 0)
+            return -1;
+        list->num++;
+    }
+    return 0;
+}
+
+int msgpack_parse(void *ta_parent, struct mpv_node *dst, bstr *src,
+                  int max_depth)
+{
+    const unsigned char *p;
+    if (!read_bytes(src, 1, &p))
+        return -1;
+    unsigned char c = p[0];
+    uint64_t v;
+
+    if (c <= 0x7f || c >= 0xe0) {
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = (int8_t)c;
+        return 0;
+    }
+    if ((c & 0xe0) == 0xa0)
+        return read_str(ta_parent, dst, src, c & 0x1f);
+    if ((c & 0xf0) == 0x90)
+        return read_list(ta_parent, dst, src, c & 0xf, false, max_depth);
+    if ((c & 0xf0) == 0x80)
+        return read_list(ta_parent, dst, src, c & 0xf, true, max_depth);
+
+    switch (c) {
+    case 0xc0:
+        dst->format = MPV_FORMAT_NONE;
+        return 0;
+    case 0xc2:
+    case 0xc3:
+        dst->format = MPV_FORMAT_FLAG;
+        dst->u.flag = c == 0xc3;
+        return 0;
+    case 0xc4: case 0xc5: case 0xc6:
+        if (!read_uint(src, 1 << (c - 0xc4), &v))
+            return -1;
+        return read_bin(ta_parent, dst, src, v);
+    case 0xca:
+        if (!read_uint(src, 4, &v))
+            return -1;
+        dst->format = MPV_FORMAT_DOUBLE;
+        dst->u.double_ = av_int2float(v);
+        return 0;
+    case 0xcb:
+        if (!read_uint(src, 8, &v))
+            return -1;
+        dst->format = MPV_FORMAT_DOUBLE;
+        dst->u.double_ = av_int2double(v);
+        return 0;
+    case 0xcc: case 0xcd: case 0xce: case 0xcf:
+        if (!read_uint(src, 1 << (c - 0xcc), &v) || v > INT64_MAX)
+            return -1;
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = v;
+        return 0;
+    case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+        int bytes = 1 << (c - 0xd0);
+        if (!read_uint(src, bytes, &v))
+            return -1;
+        // Sign-extend.
+        int shift = 64 - bytes * 8;
+        dst->format = MPV_FORMAT_INT64;
+        dst->u.int64 = (int64_t)(v << shift) >> shift;
+        return 0;
+    }
+    case 0xd9: case 0xda: case 0xdb:
+        if (!read_uint(src, 1 << (c - 0xd9), &v))
+            return -1;
+        return read_str(ta_parent, dst, src, v);
+    case 0xdc: case 0xdd:
+        if (!read_uint(src, c == 0xdc ? 2 : 4, &v))
+            return -1;
+        return read_list(ta_parent, dst, src, v, false, max_depth);
+    case 0xde: case 0xdf:
+        if (!read_uint(src, c == 0xde ? 2 : 4, &v))
+            return -1;
+        return read_list(ta_parent, dst, src, v, true, max_depth);
+    }
+    return -1; // ext types, reserved 0xc1
+}
+
+static void write_bytes(bstr *dst, const void *data, size_t size)
+{
+    bstr_xappend(NULL, dst, (bstr){(unsigned char *)data, size});
+}
+
+static void write_byte(bstr *dst, unsigned char c)
+{
+    write_bytes(dst, &c, 1);
+}
+
+// Write type byte c followed by v as big endian integer of the given size.
+static void write_tagged(bstr *dst, unsigned char c, int bytes, uint64_t v)
+{
+    unsigned char buf[9] = {c};
+    switch (bytes) {
+    case 1: buf[1] = v; break;
+    case 2: AV_WB16(buf + 1, v); break;
+    case 4: AV_WB32(buf + 1, v); break;
+    case 8: AV_WB64(buf + 1, v); break;
+    }
+    write_bytes(dst, buf, 1 + bytes);
+}
+
+void msgpack_write_nil(bstr *dst)
+{
+    write_byte(dst, 0xc0);
+}
+
+void msgpack_write_bool(bstr *dst, bool v)
+{
+    write_byte(dst, v ? 0xc3 : 0xc2);
+}
+
+void msgpack_write_int(bstr *dst, int64_t v)
+{
+    if (v >= -32 && v <= 127) {
+        write_byte(dst, (unsigned char)v);
+    } else if (v >= INT8_MIN && v <= INT8_MAX) {
+        write_tagged(dst, 0xd0, 1, v);
+    } else if (v >= INT16_MIN && v <= INT16_MAX) {
+        write_tagged(dst, 0xd1, 2, v);
+    } else if (v >= INT32_MIN && v <= INT32_MAX) {
+        write_tagged(dst, 0xd2, 4, v);
+    } else {
+        write_tagged(dst, 0xd3, 8, v);
+    }
+}
+
+void msgpack_write_double(bstr *dst, double v)
+{
+    write_tagged(dst, 0xcb, 8, av_double2int(v));
+}
+
+void msgpack_write_str(bstr *dst, const char *s)
+{
+    size_t len = strlen(s);
+    if (len < 32) {
+        write_byte(dst, 0xa0 | len);
+    } else if (len <= UINT8_MAX) {
+        write_tagged(dst, 0xd9, 1, len);
+    } else if (len <= UINT16_MAX) {
+        write_tagged(dst, 0xda, 2, len);
+    } else {
+        write_tagged(dst, 0xdb, 4, len);
+    }
+    write_bytes(dst, s, len);
+}
+
+void msgpack_write_bin(bstr *dst, const void *data, size_t size)
+{
+    if (size <= UINT8_MAX) {
+        write_tagged(dst, 0xc4, 1, size);
+    } else if (size <= UINT16_MAX) {
+        write_tagged(dst, 0xc5, 2, size);
+    } else {
+        write_tagged(dst, 0xc6, 4, size);
+    }
+    write_bytes(dst, data, size);
+}
+
+void msgpack_write_array(bstr *dst, uint32_t num)
+{
+    if (num < 16) {
+        write_byte(dst, 0x90 | num);
+    } else if (num <= UINT16_MAX) {
+        write_tagged(dst, 0xdc, 2, num);
+    } else {
+        write_tagged(dst, 0xdd, 4, num);
+    }
+}
+
+void msgpack_write_map(bstr *dst, uint32_t num)
+{
+    if (num < 16) {
+        write_byte(dst, 0x80 | num);
+    } else if (num <= UINT16_MAX) {
+        write_tagged(dst, 0xde, 2, num);
+    } else {
+        write_tagged(dst, 0xdf, 4, num);
+    }
+}
+
+void msgpack_write(bstr *dst, struct mpv_node *src)
+{
+    switch (src->format) {
+    case MPV_FORMAT_STRING:
+        msgpack_write_str(dst, src->u.string);
+        break;
+    case MPV_FORMAT_FLAG:
+        msgpack_write_bool(dst, src->u.flag);
+        break;
+    case MPV_FORMAT_INT64:
+        msgpack_write_int(dst, src->u.int64);
+        break;
+    case MPV_FORMAT_DOUBLE:
+        msgpack_write_double(dst, src->u.double_);
+        break;
+    case MPV_FORMAT_BYTE_ARRAY:
+        msgpack_write_bin(dst, src->u.ba->data, src->u.ba->size);
+        break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP: {
+        struct mpv_node_list *list = src->u.list;
+        bool is_map = src->format == MPV_FORMAT_NODE_MAP;
+        int num = list ? list->num : 0;
+        if (is_map) {
+            msgpack_write_map(dst, num);
+        } else {
+            msgpack_write_array(dst, num);
+        }
+        for (int n = 0; n < num; n++) {
+            if (is_map)
+                msgpack_write_str(dst, list->keys[n]);
+            msgpack_write(dst, &list->values[n]);
+        }
+        break;
+    }
+    default:
+        msgpack_write_nil(dst);
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of mpv.
+ *
+ * mpv is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * mpv is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mpv.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP_MSGPACK_H
+#define MP_MSGPACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "misc/bstr.h"
+
+// We reuse mpv_node.
+#include "libmpv/client.h"
+
+// Parse one MessagePack object at the start of *src, and advance *src past it.
+// All memory is allocated under ta_parent. Returns <0 on error.
+int msgpack_parse(void *ta_parent, struct mpv_node *dst, bstr *src,
+                  int max_depth);
+
+// The writer functions append to *dst. dst->start must be NULL or a talloc
+// allocation, which is reallocated as needed.
+void msgpack_write(bstr *dst, struct mpv_node *src);
+
+// For writing objects without building a mpv_node first. A map or array header
+// must be followed by exactly num entries (key and value for maps).
+void msgpack_write_nil(bstr *dst);
+void msgpack_write_bool(bstr *dst, bool v);
+void msgpack_write_int(bstr *dst, int64_t v);
+void msgpack_write_double(bstr *dst, double v);
+void msgpack_write_str(bstr *dst, const char *s);
+void msgpack_write_bin(bstr *dst, const void *data, size_t size);
+void msgpack_write_array(bstr *dst, uint32_t num);
+void msgpack_write_map(bstr *dst, uint32_t num);
+
+#endif
@@ -17,67 +17,232 @@
 
 #include <pthread.h>
 
+#include <libavutil/cpu.h>
+
 #include "common/common.h"
+#include "osdep/atomic.h"
+#include "osdep/threads.h"
 
 #include "thread_pool.h"
 
+// Each worker thread has its own queue. Work queued from a worker thread goes
+// to its own queue; work queued from other threads is distributed round-robin.
+// Workers take work from the front of their own queue first, and steal from
+// the front of the other queues if it's empty, so within a queue, items always
+// run in the order they were queued.
+
 struct work {
     void (*fn)(void *ctx);
     void *fn_ctx;
+    struct mp_task_group *group;
+};
+
+struct worker {
+    struct mp_thread_pool *pool;
+    pthread_t thread;
+    bool thread_created;
+
+    pthread_mutex_t lock;
+
+    // --- the following fields are protected by lock
+    // Ring buffer; the number of allocated elements is a power of 2.
+    struct work *work;
+    size_t alloc_work;
+    size_t first_work;
+    size_t num_work;
 };
 
 struct mp_thread_pool {
-    pthread_t *threads;
-    int num_threads;
+    struct worker **workers;
+    int num_workers;
+
+    atomic_int pending;         // queued work items, over all workers
+    atomic_int num_sleeping;    // workers waiting on wakeup
+    atomic_uint next_worker;    // for round-robin distribution
 
     pthread_mutex_t lock;
     pthread_cond_t wakeup;
 
     // --- the following fields are protected by lock
     bool terminate;
-    struct work *work;
-    int num_work;
 };
 
+struct mp_task_group {
+    struct mp_thread_pool *pool;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+
+    // --- the following fields are protected by lock
+    int pending;                // queued or running work items
+};
+
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t worker_key;
+
+static void init_worker_key(void)
+{
+    pthread_key_create(&worker_key, NULL);
+}
+
+// Return the worker struct if the calling thread is a worker of pool.
+static struct worker *get_current_worker(struct mp_thread_pool *pool)
+{
+    pthread_once(&worker_key_once, init_worker_key);
+    struct worker *w = pthread_getspecific(worker_key);
+    return w && w->pool == pool ? w : NULL;
+}
+
+static void push_work(struct worker *w, struct work work)
+{
+    pthread_mutex_lock(&w->lock);
+    if (w->num_work == w->alloc_work) {
+        size_t new_alloc = MPMAX(w->alloc_work * 2, 16);
+        struct work *new = talloc_array(w, struct work, new_alloc);
+        for (size_t n = 0; n < w->num_work; n++)
+            new[n] = w->work[(w->first_work + n) & (w->alloc_work - 1)];
+        talloc_free(w->work);
+        w->work = new;
+        w->alloc_work = new_alloc;
+        w->first_work = 0;
+    }
+    w->work[(w->first_work + w->num_work) & (w->alloc_work - 1)] = work;
+    w->num_work += 1;
+    // (Increment while w->lock is held, so it never goes negative.)
+    atomic_fetch_add(&w->pool->pending, 1);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Remove the oldest work item from w. If group is not NULL, remove the oldest
+// item belonging to that group instead.
+static bool pop_work(struct worker *w, struct mp_task_group *group,
+                     struct work *out)
+{
+    bool found = false;
+    pthread_mutex_lock(&w->lock);
+    size_t mask = w->alloc_work - 1;
+    for (size_t n = 0; n < w->num_work; n++) {
+        size_t idx = (w->first_work + n) & mask;
+        if (group && w->work[idx].group != group)
+            continue;
+        *out = w->work[idx];
+        // Close the gap by moving the items before it up by one.
+        for (size_t i = n; i > 0; i--) {
+            w->work[(w->first_work + i) & mask] =
+                w->work[(w->first_work + i - 1) & mask];
+        }
+        w->first_work = (w->first_work + 1) & mask;
+        w->num_work -= 1;
+        atomic_fetch_add(&w->pool->pending, -1);
+        found = true;
+        break;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return found;
+}
+
+// Take work from self first (if not NULL), then from the other workers.
+static bool take_work(struct mp_thread_pool *pool, struct worker *self,
+                      struct mp_task_group *group, struct work *out)
+{
+    if (!atomic_load(&pool->pending))
+        return false;
+    if (self && pop_work(self, group, out))
+        return true;
+    int start = self ? 0 : atomic_load(&pool->next_worker) % pool->num_workers;
+    for (int n = 0; n < pool->num_workers; n++) {
+        struct worker *w = pool->workers[(start + n) % pool->num_workers];
+        if (w != self && pop_work(w, group, out))
+            return true;
+    }
+    return false;
+}
+
+static void run_work(struct work *work)
+{
+    work->fn(work->fn_ctx);
+
+    struct mp_task_group *group = work->group;
+    if (group) {
+        pthread_mutex_lock(&group->lock);
+        group->pending -= 1;
+        if (!group->pending)
+            pthread_cond_broadcast(&group->wakeup);
+        pthread_mutex_unlock(&group->lock);
+    }
+}
+
 static void *worker_thread(void *arg)
 {
-    struct mp_thread_pool *pool = arg;
+    struct worker *w = arg;
+    struct mp_thread_pool *pool = w->pool;
+
+    mpthread_set_name("worker");
+    pthread_once(&worker_key_once, init_worker_key);
+    pthread_setspecific(worker_key, w);
 
-    pthread_mutex_lock(&pool->lock);
     while (1) {
-        while (!pool->num_work && !pool->terminate)
+        struct work work;
+        if (take_work(pool, w, NULL, &work)) {
+            run_work(&work);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        // Paired with the num_sleeping check in queue_work(): either the
+        // producer sees num_sleeping>0 and signals, or we see pending>0.
+        atomic_fetch_add(&pool->num_sleeping, 1);
+        while (!atomic_load(&pool->pending) && !pool->terminate)
             pthread_cond_wait(&pool->wakeup, &pool->lock);
+        atomic_fetch_add(&pool->num_sleeping, -1);
+        bool terminate = pool->terminate && !atomic_load(&pool->pending);
+        pthread_mutex_unlock(&pool->lock);
 
-        if (!pool->num_work && pool->terminate)
+        if (terminate)
             break;
+    }
 
-        assert(pool->num_work > 0);
-        struct work work = pool->work[pool->num_work - 1];
-        pool->num_work -= 1;
+    pthread_setspecific(worker_key, NULL);
+    return NULL;
+}
 
-        pthread_mutex_unlock(&pool->lock);
-        work.fn(work.fn_ctx);
-        pthread_mutex_lock(&pool->lock);
+static void queue_work(struct mp_thread_pool *pool, struct work work)
+{
+    struct worker *w = get_current_worker(pool);
+    if (!w) {
+        unsigned int idx = atomic_fetch_add(&pool->next_worker, 1);
+        w = pool->workers[idx % pool->num_workers];
     }
-    assert(pool->num_work == 0);
-    pthread_mutex_unlock(&pool->lock);
+    push_work(w, work);
 
-    return NULL;
+    if (atomic_load(&pool->num_sleeping)) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wakeup);
+        pthread_mutex_unlock(&pool->lock);
+    }
 }
 
 static void thread_pool_dtor(void *ctx)
 {
     struct mp_thread_pool *pool = ctx;
 
+    // Would wait for itself.
+    assert(!get_current_worker(pool));
+
     pthread_mutex_lock(&pool->lock);
     pool->terminate = true;
     pthread_cond_broadcast(&pool->wakeup);
     pthread_mutex_unlock(&pool->lock);
 
-    for (int n = 0; n < pool->num_threads; n++)
-        pthread_join(pool->threads[n], NULL);
+    for (int n = 0; n < pool->num_workers; n++) {
+        struct worker *w = pool->workers[n];
+        if (w->thread_created)
+            pthread_join(w->thread, NULL);
+    }
 
-    assert(pool->num_work == 0);
+    assert(atomic_load(&pool->pending) == 0);
+    for (int n = 0; n < pool->num_workers; n++)
+        pthread_mutex_destroy(&pool->workers[n]->lock);
     pthread_cond_destroy(&pool->wakeup);
     pthread_mutex_destroy(&pool->lock);
 }
@@ -86,7 +251,7 @@ static void thread_pool_dtor(void *ctx)
 // NULL if the worker threads could not be created. The thread pool can be
 // destroyed with talloc_free(pool), or indirectly with talloc_free(ta_parent).
 // If there are still work items on freeing, it will block until all work items
-// are done, and the threads terminate.
+// are done, and the threads terminate. It must not be freed from a work item.
 struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads)
 {
     assert(threads > 0);
@@ -97,29 +262,134 @@ struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads)
     pthread_mutex_init(&pool->lock, NULL);
     pthread_cond_init(&pool->wakeup, NULL);
 
+    // Create all worker structs first, since workers steal from each other.
     for (int n = 0; n < threads; n++) {
-        pthread_t thread;
-        if (pthread_create(&thread, NULL, worker_thread, pool)) {
+        struct worker *w = talloc_zero(pool, struct worker);
+        w->pool = pool;
+        pthread_mutex_init(&w->lock, NULL);
+        MP_TARRAY_APPEND(pool, pool->workers, pool->num_workers, w);
+    }
+
+    for (int n = 0; n < threads; n++) {
+        struct worker *w = pool->workers[n];
+        if (pthread_create(&w->thread, NULL, worker_thread, w)) {
             talloc_free(pool);
             return NULL;
         }
-        MP_TARRAY_APPEND(pool, pool->threads, pool->num_threads, thread);
+        w->thread_created = true;
+    }
+
+    return pool;
+}
+
+static pthread_mutex_t default_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_thread_pool *default_pool;
+static int default_pool_refs;
+
+static void default_pool_ref_dtor(void *ctx)
+{
+    struct mp_thread_pool *pool = NULL;
+    pthread_mutex_lock(&default_pool_lock);
+    assert(default_pool_refs > 0);
+    default_pool_refs -= 1;
+    if (!default_pool_refs) {
+        pool = default_pool;
+        default_pool = NULL;
     }
+    pthread_mutex_unlock(&default_pool_lock);
+    talloc_free(pool);
+}
 
+// Return the process-wide thread pool, which has one worker thread per CPU.
+// It is shared by all users, and created on first use. The returned pointer
+// stays valid until ta_parent is freed; the pool is destroyed once all users
+// are gone. Don't free the pool directly. Returns NULL on failure.
+struct mp_thread_pool *mp_thread_pool_get_default(void *ta_parent)
+{
+    pthread_mutex_lock(&default_pool_lock);
+    if (!default_pool)
+        default_pool = mp_thread_pool_create(NULL, MPMAX(av_cpu_count(), 1));
+    struct mp_thread_pool *pool = default_pool;
+    if (pool) {
+        default_pool_refs += 1;
+        void *ref = talloc_new(ta_parent);
+        talloc_set_destructor(ref, default_pool_ref_dtor);
+    }
+    pthread_mutex_unlock(&default_pool_lock);
     return pool;
 }
 
+int mp_thread_pool_get_num_threads(struct mp_thread_pool *pool)
+{
+    return pool->num_workers;
+}
+
 // Queue a function to be run on a worker thread: fn(fn_ctx)
 // If no worker thread is currently available, it's appended to a list in memory
 // with unbounded size. This function always returns immediately.
 // Concurrent queue calls are allowed, as long as it does not overlap with
-// pool destruction.
+// pool destruction. Work items queued from the same thread are started in
+// order (but may run concurrently if there are multiple worker threads).
 void mp_thread_pool_queue(struct mp_thread_pool *pool, void (*fn)(void *ctx),
                           void *fn_ctx)
 {
-    pthread_mutex_lock(&pool->lock);
-    struct work work = {fn, fn_ctx};
-    MP_TARRAY_INSERT_AT(pool, pool->work, pool->num_work, 0, work);
-    pthread_cond_signal(&pool->wakeup);
-    pthread_mutex_unlock(&pool->lock);
+    queue_work(pool, (struct work){fn, fn_ctx});
+}
+
+static void task_group_dtor(void *ctx)
+{
+    struct mp_task_group *group = ctx;
+
+    mp_task_group_wait(group);
+    pthread_cond_destroy(&group->wakeup);
+    pthread_mutex_destroy(&group->lock);
+}
+
+// Create a group of work items, which can be waited on as a whole. Freeing the
+// group waits until all its work items are done. The pool must outlive it.
+struct mp_task_group *mp_task_group_create(void *ta_parent,
+                                           struct mp_thread_pool *pool)
+{
+    struct mp_task_group *group = talloc_zero(ta_parent, struct mp_task_group);
+    group->pool = pool;
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->wakeup, NULL);
+    talloc_set_destructor(group, task_group_dtor);
+    return group;
+}
+
+// Like mp_thread_pool_queue(), but add the work item to the group.
+void mp_task_group_queue(struct mp_task_group *group, void (*fn)(void *ctx),
+                         void *fn_ctx)
+{
+    pthread_mutex_lock(&group->lock);
+    group->pending += 1;
+    pthread_mutex_unlock(&group->lock);
+
+    queue_work(group->pool, (struct work){fn, fn_ctx, group});
+}
+
+// Wait until all work items queued to the group so far are done. Items of the
+// group that haven't started yet are run on the calling thread, so this can be
+// called from work items too (e.g. to split work recursively), and never waits
+// for unrelated work.
+void mp_task_group_wait(struct mp_task_group *group)
+{
+    struct worker *self = get_current_worker(group->pool);
+    while (1) {
+        struct work work;
+        if (take_work(group->pool, self, group, &work)) {
+            run_work(&work);
+            continue;
+        }
+
+        // All remaining items are running on other threads.
+        pthread_mutex_lock(&group->lock);
+        bool done = !group->pending;
+        if (!done)
+            pthread_cond_wait(&group->wakeup, &group->lock);
+        pthread_mutex_unlock(&group->lock);
+        if (done)
+            break;
+    }
 }
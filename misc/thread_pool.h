@@ -2,9 +2,18 @@
 #define MPV_MP_THREAD_POOL_H
 
 struct mp_thread_pool;
+struct mp_task_group;
 
 struct mp_thread_pool *mp_thread_pool_create(void *ta_parent, int threads);
+struct mp_thread_pool *mp_thread_pool_get_default(void *ta_parent);
+int mp_thread_pool_get_num_threads(struct mp_thread_pool *pool);
 void mp_thread_pool_queue(struct mp_thread_pool *pool, void (*fn)(void *ctx),
                           void *fn_ctx);
 
+struct mp_task_group *mp_task_group_create(void *ta_parent,
+                                           struct mp_thread_pool *pool);
+void mp_task_group_queue(struct mp_task_group *group, void (*fn)(void *ctx),
+                         void *fn_ctx);
+void mp_task_group_wait(struct mp_task_group *group);
+
 #endif
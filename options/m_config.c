@@ -40,6 +40,7 @@
 #include "common/msg.h"
 #include "common/msg_control.h"
 #include "misc/dispatch.h"
+#include "misc/hashmap.h"
 #include "misc/node.h"
 #include "osdep/atomic.h"
 
@@ -58,6 +59,8 @@ struct m_config_shadow {
     pthread_mutex_t lock;
     struct m_config *root;
     char *data;
+    long long change_ts;    // incremented on every option write
+    long long *opt_ts;      // change_ts of the last write to root->opts[n]
     struct m_config_cache **listeners;
     int num_listeners;
 };
@@ -189,6 +192,9 @@ struct m_config *m_config_new(void *talloc_ctx, struct mp_log *log,
         .opts = config->optstruct,
     };
 
+    config->name_index = mp_hashmap_create(config);
+    config->data_index = mp_hashmap_create(config);
+
     if (options)
         add_options(config, NULL, config->optstruct, defaults, options);
     return config;
@@ -479,6 +485,32 @@ static void init_opt_inplace(const struct m_option *opt, void *dst,
     m_option_copy(opt, dst, &temp);
 }
 
+// Add config->opts[n] to the lookup tables. If several options have the same
+// name (or data pointer), the first one wins.
+static void index_option(struct m_config *config, int n)
+{
+    struct m_config_option *co = &config->opts[n];
+    bstr name = bstr0(co->name);
+    if (!mp_hashmap_find(config->name_index, name))
+        mp_hashmap_set(config->name_index, name, n);
+    if (co->data) {
+        bstr key = MP_HASHMAP_PTR_KEY(co->data);
+        if (!mp_hashmap_find(config->data_index, key))
+            mp_hashmap_set(config->data_index, key, n);
+    }
+}
+
+// (Re)build the lookup tables from scratch.
+static void build_index(struct m_config *config)
+{
+    talloc_free(config->name_index);
+    talloc_free(config->data_index);
+    config->name_index = mp_hashmap_create(config);
+    config->data_index = mp_hashmap_create(config);
+    for (int n = 0; n < config->num_opts; n++)
+        index_option(config, n);
+}
+
 static void m_config_add_option(struct m_config *config,
                                 struct m_config_option *parent,
                                 void *optstruct,
@@ -534,6 +566,7 @@ static void m_config_add_option(struct m_config *config,
             init_opt_inplace(arg, co.data, co.default_data);
 
         MP_TARRAY_APPEND(config, config->opts, config->num_opts, co);
+        index_option(config, config->num_opts - 1);
 
         if (arg->type == &m_option_type_obj_settings_list)
             init_obj_settings_list(config, (const struct m_obj_list *)arg->priv);
@@ -546,14 +579,8 @@ struct m_config_option *m_config_get_co_raw(const struct m_config *config,
     if (!name.len)
         return NULL;
 
-    for (int n = 0; n < config->num_opts; n++) {
-        struct m_config_option *co = &config->opts[n];
-        struct bstr coname = bstr0(co->name);
-        if (bstrcmp(coname, name) == 0)
-            return co;
-    }
-
-    return NULL;
+    int *n = mp_hashmap_find(config->name_index, name);
+    return n ? &config->opts[*n] : NULL;
 }
 
 // Like m_config_get_co_raw(), but resolve aliases.
@@ -1191,6 +1218,8 @@ void m_config_create_shadow(struct m_config *config)
 
     config->shadow = talloc_zero(config, struct m_config_shadow);
     config->shadow->data = talloc_zero_size(config->shadow, config->shadow_size);
+    config->shadow->opt_ts = talloc_zero_array(config->shadow, long long,
+                                               config->num_opts);
 
     config->shadow->root = config;
     pthread_mutex_init(&config->shadow->lock, NULL);
@@ -1250,8 +1279,13 @@ struct m_config_cache *m_config_cache_alloc(void *ta_parent,
     }
 
     cache->ts = -1;
+    cache->change_ts = -1;
     cache->group = -1;
 
+    cache->root_index = talloc_array(cache, int, config->num_opts);
+    for (int n = 0; n < config->num_opts; n++)
+        cache->root_index[n] = n;
+
     for (int n = 0; n < config->num_groups; n++) {
         if (config->groups[n].group == group) {
             cache->opts = config->groups[n].opts;
@@ -1272,6 +1306,7 @@ struct m_config_cache *m_config_cache_alloc(void *ta_parent,
         for (int n = 0; n < num_opts; n++) {
             struct m_config_option *co = &config->opts[n];
             if (is_group_included(config, co->group, cache->group)) {
+                cache->root_index[config->num_opts] = n;
                 config->opts[config->num_opts++] = *co;
             } else {
                 m_option_free(co->opt, co->data);
@@ -1281,6 +1316,8 @@ struct m_config_cache *m_config_cache_alloc(void *ta_parent,
             if (!is_group_included(config, n, cache->group))
                 TA_FREEP(&config->groups[n].opts);
         }
+        // (Indexes into opts changed.)
+        build_index(config);
     }
 
     m_config_cache_update(cache);
@@ -1299,12 +1336,28 @@ bool m_config_cache_update(struct m_config_cache *cache)
 
     pthread_mutex_lock(&shadow->lock);
     cache->ts = atomic_load(&shadow->root->groups[cache->group].ts);
+    cache->num_changed = cache->next_changed = 0;
+    // Copy only options written since the last update.
     for (int n = 0; n < cache->shadow_config->num_opts; n++) {
         struct m_config_option *co = &cache->shadow_config->opts[n];
-        if (co->shadow_offset >= 0)
+        if (co->shadow_offset >= 0 &&
+            shadow->opt_ts[cache->root_index[n]] > cache->change_ts)
+        {
             m_option_copy(co->opt, co->data, shadow->data + co->shadow_offset);
+            MP_TARRAY_APPEND(cache, cache->changed, cache->num_changed, n);
+        }
     }
+    cache->change_ts = shadow->change_ts;
     pthread_mutex_unlock(&shadow->lock);
+    return cache->num_changed > 0;
+}
+
+bool m_config_cache_get_next_changed(struct m_config_cache *cache, void **opt)
+{
+    if (cache->next_changed >= cache->num_changed)
+        return false;
+    int n = cache->changed[cache->next_changed++];
+    *opt = cache->shadow_config->opts[n].data;
     return true;
 }
 
@@ -1315,8 +1368,11 @@ void m_config_notify_change_co(struct m_config *config,
 
     if (shadow) {
         pthread_mutex_lock(&shadow->lock);
-        if (co->shadow_offset >= 0)
+        if (co->shadow_offset >= 0) {
             m_option_copy(co->opt, shadow->data + co->shadow_offset, co->data);
+            // (config is the root config if it has a shadow)
+            shadow->opt_ts[co - config->opts] = ++shadow->change_ts;
+        }
         pthread_mutex_unlock(&shadow->lock);
     }
 
@@ -1349,16 +1405,12 @@ void m_config_notify_change_co(struct m_config *config,
 
 void m_config_notify_change_opt_ptr(struct m_config *config, void *ptr)
 {
-    for (int n = 0; n < config->num_opts; n++) {
-        struct m_config_option *co = &config->opts[n];
-        if (co->data == ptr) {
-            m_config_notify_change_co(config, co);
-            return;
-        }
-    }
+    int *n = mp_hashmap_find(config->data_index, MP_HASHMAP_PTR_KEY(ptr));
     // ptr doesn't point to any config->optstruct field declared in the
     // option list?
-    assert(false);
+    if (!n)
+        return;
+    m_config_notify_change_co(config, &config->opts[*n]);
 }
 
 void m_config_cache_set_wakeup_cb(struct m_config_cache *cache,
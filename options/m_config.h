@@ -34,6 +34,7 @@ struct m_option_type;
 struct m_sub_options;
 struct m_obj_desc;
 struct m_obj_settings;
+struct mp_hashmap;
 struct mp_log;
 
 // Config option
@@ -60,6 +61,9 @@ typedef struct m_config {
     // Registered options.
     struct m_config_option *opts; // all options, even suboptions
     int num_opts;
+    // Map option names and data pointers to indexes into opts.
+    struct mp_hashmap *name_index;
+    struct mp_hashmap *data_index;
 
     // Creation parameters
     size_t size;
@@ -275,6 +279,11 @@ struct m_config_cache {
     struct m_config_shadow *shadow;
     struct m_config *shadow_config;
     long long ts;
+    long long change_ts;    // m_config_shadow.change_ts at the last update
+    int *root_index;        // root option index for shadow_config->opts[n]
+    int *changed;           // shadow_config->opts indexes changed by last update
+    int num_changed;
+    int next_changed;
     int group;
     bool in_list;
     // --- Implicitly synchronized by setting/unsetting wakeup_cb.
@@ -316,12 +325,18 @@ void m_config_cache_set_dispatch_change_cb(struct m_config_cache *cache,
                                            void (*cb)(void *ctx), void *cb_ctx);
 
 // Update the options in cache->opts to current global values. Return whether
-// there was an update notification at all (which may or may not indicate that
-// some options have changed).
+// any option was written since the last update (which may or may not mean the
+// value is different). Only these options are copied.
 // Keep in mind that while the cache->opts pointer does not change, the option
 // data itself will (e.g. string options might be reallocated).
 bool m_config_cache_update(struct m_config_cache *cache);
 
+// Iterate over the options updated by the last m_config_cache_update() call.
+// Sets *opt to the option field in cache->opts and returns true, or returns
+// false if there are no more. Can be used to skip reinitialization if only
+// unrelated options changed.
+bool m_config_cache_get_next_changed(struct m_config_cache *cache, void **opt);
+
 // Like m_config_cache_alloc(), but return the struct (m_config_cache->opts)
 // directly, with no way to update the config. Basically this returns a copy
 // with a snapshot of the current option values.
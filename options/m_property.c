@@ -35,9 +35,15 @@
 #include "m_property.h"
 #include "common/msg.h"
 #include "common/common.h"
+#include "misc/hashmap.h"
+
+struct m_property_index {
+    const struct m_property *list;
+    struct mp_hashmap *names;   // name => index into list
+};
 
 static int m_property_multiply(struct mp_log *log,
-                               const struct m_property *prop_list,
+                               struct m_property_index *prop_list,
                                const char *property, double f, void *ctx)
 {
     union m_option_value val = {0};
@@ -72,16 +78,48 @@ struct m_property *m_property_list_find(const struct m_property *list,
     return NULL;
 }
 
-static int do_action(const struct m_property *prop_list, const char *name,
+struct m_property_index *m_property_index_create(void *ta_parent,
+                                                 const struct m_property *list)
+{
+    struct m_property_index *index = talloc_zero(ta_parent,
+                                                 struct m_property_index);
+    index->list = list;
+    index->names = mp_hashmap_create(index);
+    for (int n = 0; list[n].name; n++) {
+        // Like m_property_list_find(), the first entry wins on duplicates.
+        if (!mp_hashmap_find(index->names, bstr0(list[n].name)))
+            mp_hashmap_set(index->names, bstr0(list[n].name), n);
+    }
+    return index;
+}
+
+int m_property_index_get_pos(struct m_property_index *index, bstr name)
+{
+    int *pos = mp_hashmap_find(index->names, name);
+    return pos ? *pos : -1;
+}
+
+struct m_property *m_property_index_find(struct m_property_index *index,
+                                         bstr name)
+{
+    int pos = m_property_index_get_pos(index, name);
+    return pos >= 0 ? (struct m_property *)&index->list[pos] : NULL;
+}
+
+const struct m_property *m_property_index_get_list(struct m_property_index *index)
+{
+    return index->list;
+}
+
+static int do_action(struct m_property_index *prop_list, const char *name,
                      int action, void *arg, void *ctx)
 {
     struct m_property *prop;
     struct m_property_action_arg ka;
     const char *sep = strchr(name, '/');
     if (sep && sep[1]) {
-        char base[128];
-        snprintf(base, sizeof(base), "%.*s", (int)(sep - name), name);
-        prop = m_property_list_find(prop_list, base);
+        prop = m_property_index_find(prop_list,
+                                     (bstr){(unsigned char *)name, sep - name});
         ka = (struct m_property_action_arg) {
             .key = sep + 1,
             .action = action,
@@ -90,14 +128,14 @@ static int do_action(const struct m_property *prop_list, const char *name,
         action = M_PROPERTY_KEY_ACTION;
         arg = &ka;
     } else
-        prop = m_property_list_find(prop_list, name);
+        prop = m_property_index_find(prop_list, bstr0(name));
     if (!prop)
         return M_PROPERTY_UNKNOWN;
     return prop->call(ctx, prop, action, arg);
 }
 
 // (as a hack, log can be NULL on read-only paths)
-int m_property_do(struct mp_log *log, const struct m_property *prop_list,
+int m_property_do(struct mp_log *log, struct m_property_index *prop_list,
                   const char *name, int action, void *arg, void *ctx)
 {
     union m_option_value val = {0};
@@ -235,7 +273,7 @@ static void m_property_unkey(int *action, void **arg)
     }
 }
 
-static int m_property_do_bstr(const struct m_property *prop_list, bstr name,
+static int m_property_do_bstr(struct m_property_index *prop_list, bstr name,
                               int action, void *arg, void *ctx)
 {
     char name0[64];
@@ -253,7 +291,7 @@ static void append_str(char **s, int *len, bstr append)
     *len = *len + append.len;
 }
 
-static int expand_property(const struct m_property *prop_list, char **ret,
+static int expand_property(struct m_property_index *prop_list, char **ret,
                            int *ret_len, bstr prop, bool silent_error, void *ctx)
 {
     bool cond_yes = bstr_eatstart0(&prop, "?");
@@ -284,7 +322,7 @@ static int expand_property(const struct m_property *prop_list, char **ret,
     return skip;
 }
 
-char *m_properties_expand_string(const struct m_property *prop_list,
+char *m_properties_expand_string(struct m_property_index *prop_list,
                                  const char *str0, void *ctx)
 {
     char *ret = NULL;
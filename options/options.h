@@ -123,6 +123,7 @@ typedef struct MPOpts {
     int property_print_help;
     int use_terminal;
     char *dump_stats;
+    char *dump_trace;
     int verbose;
     int msg_really_quiet;
     char **msg_levels;
@@ -318,6 +319,7 @@ typedef struct MPOpts {
     struct demux_rawvideo_opts *demux_rawvideo;
     struct demux_lavf_opts *demux_lavf;
     struct demux_mkv_opts *demux_mkv;
+    struct demux_playlist_opts *demux_playlist;
 
     struct demux_opts *demux_opts;
 
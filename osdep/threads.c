@@ -16,6 +16,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <pthread.h>
 
@@ -34,8 +36,26 @@ int mpthread_mutex_init_recursive(pthread_mutex_t *mutex)
     return r;
 }
 
+static pthread_once_t name_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t name_key;
+
+static void init_name_key(void)
+{
+    pthread_key_create(&name_key, free);
+}
+
+const char *mpthread_get_name(void)
+{
+    pthread_once(&name_key_once, init_name_key);
+    return pthread_getspecific(name_key);
+}
+
 void mpthread_set_name(const char *name)
 {
+    pthread_once(&name_key_once, init_name_key);
+    free(pthread_getspecific(name_key));
+    pthread_setspecific(name_key, strdup(name));
+
     char tname[80];
     snprintf(tname, sizeof(tname), "mpv/%s", name);
 #if HAVE_GLIBC_THREAD_NAME
@@ -10,4 +10,8 @@ int mpthread_mutex_init_recursive(pthread_mutex_t *mutex);
 // Set thread name (for debuggers).
 void mpthread_set_name(const char *name);
 
+// Return the name last set with mpthread_set_name() on the calling thread, or
+// NULL if none was set. Valid until the next mpthread_set_name() call.
+const char *mpthread_get_name(void);
+
 #endif
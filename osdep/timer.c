@@ -81,6 +81,16 @@ int64_t mp_add_timeout(int64_t time_us, double timeout_sec)
     return time_us + ti;
 }
 
+int64_t mp_thread_cpu_time_us(void)
+{
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+#endif
+    return -1;
+}
+
 static void get_realtime(struct timespec *out_ts)
 {
 #if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0
@@ -37,6 +37,10 @@ uint64_t mp_raw_time_us(void);
 // Sleep in microseconds.
 void mp_sleep_us(int64_t us);
 
+// Return the CPU time used by the calling thread in microseconds, or -1 if
+// this is not supported on the platform. Slower than mp_time_us().
+int64_t mp_thread_cpu_time_us(void);
+
 #define MP_START_TIME 10000000
 
 // Return the amount of time that has passed since the last call, in
@@ -935,15 +935,31 @@ void fill_audio_out_buffers(struct MPContext *mpctx)
     if (audio_eof && !opts->gapless_audio)
         playflags |= AOPLAY_FINAL_CHUNK;
 
-    uint8_t **planes;
-    int samples;
-    mp_audio_buffer_peek(ao_c->ao_buffer, &planes, &samples);
+    int samples = mp_audio_buffer_samples(ao_c->ao_buffer);
     if (audio_eof || samples >= align)
         samples = samples / align * align;
     samples = MPMIN(samples, mpctx->paused ? 0 : playsize);
-    int played = write_to_ao(mpctx, planes, samples, playflags);
-    assert(played >= 0 && played <= samples);
-    mp_audio_buffer_skip(ao_c->ao_buffer, played);
+
+    // The buffer is a ring buffer, so the data can come in 2 segments.
+    int played = 0;
+    do {
+        uint8_t **planes;
+        int segment;
+        mp_audio_buffer_peek(ao_c->ao_buffer, &planes, &segment);
+        segment = MPMIN(segment, samples - played);
+        if (segment < samples - played && segment % align) {
+            // Can't split the data at the wrap point.
+            mp_audio_buffer_linearize(ao_c->ao_buffer);
+            continue;
+        }
+        int flags = segment == samples - played ? playflags : 0;
+        int r = write_to_ao(mpctx, planes, segment, flags);
+        assert(r >= 0 && r <= segment);
+        mp_audio_buffer_skip(ao_c->ao_buffer, r);
+        played += r;
+        if (r < segment)
+            break;
+    } while (played < samples);
 
     mpctx->audio_drop_throttle =
         MPMAX(0, mpctx->audio_drop_throttle - played / play_samplerate);
@@ -31,12 +31,14 @@
 #include "input/cmd_list.h"
 #include "misc/ctype.h"
 #include "misc/dispatch.h"
+#include "misc/node.h"
 #include "misc/rendezvous.h"
 #include "options/m_config.h"
 #include "options/m_option.h"
 #include "options/m_property.h"
 #include "options/path.h"
 #include "options/parse_configfile.h"
+#include "osdep/atomic.h"
 #include "osdep/threads.h"
 #include "osdep/timer.h"
 #include "osdep/io.h"
@@ -75,16 +77,37 @@ struct mp_client_api {
     struct mp_custom_protocol *custom_protocols;
     int num_custom_protocols;
 
+    // Observed properties of all clients, indexed by property ID + 1 (so
+    // unknown properties with ID -1 go to index 0).
+    struct property_subscribers *subscribers;
+    int num_subscribers;
+    int num_throttled;      // number of observed properties with min_interval
+
     struct mpv_render_context *render_context;
     struct mpv_opengl_cb_context *gl_cb_ctx;
+
+    // If set, client wakeups caused by the playloop are deferred until the
+    // next mp_client_defer_wakeups(mpctx, false), so that a burst of events
+    // causes only one wakeup. Set and cleared by the core thread only.
+    atomic_bool defer_wakeups;
+    atomic_bool have_deferred;  // some mpv_handle.wakeup_deferred is set
+};
+
+struct property_subscribers {
+    struct observe_property **props;
+    int num_props;
 };
 
 struct observe_property {
     char *name;
     int id;                 // ==mp_get_property_id(name)
+    int index;              // position in client->properties
     uint64_t event_mask;    // ==mp_get_property_event_mask(name)
     int64_t reply_id;
     mpv_format format;
+    int64_t min_interval;   // minimum time between change events (us), or 0
+    double min_delta;       // minimum change of numeric values, or 0
+    int64_t next_event;     // earliest time of next change event (us)
     bool changed;           // property change should be signaled to user
     bool need_new_value;    // a new value should be retrieved
     bool updating;          // a new value is being retrieved
@@ -120,6 +143,7 @@ struct mpv_handle {
 
     uint64_t event_mask;
     bool queued_wakeup;
+    bool wakeup_deferred;   // wakeup_client() pending, see defer_wakeups
     int suspend_count;
 
     mpv_event *events;      // ringbuffer of max_events entries
@@ -134,6 +158,7 @@ struct mpv_handle {
     int lowest_changed;     // attempt at making change processing incremental
     int properties_updating;
     uint64_t property_event_masks; // or-ed together event masks of all properties
+    int64_t throttle_deadline;  // when a delayed property change is due, or 0
 
     bool fuzzy_initialized; // see scripting.c wait_loaded()
     bool is_weak;           // can not keep core alive on its own
@@ -143,6 +168,8 @@ struct mpv_handle {
 static bool gen_log_message_event(struct mpv_handle *ctx);
 static bool gen_property_change_event(struct mpv_handle *ctx);
 static void notify_property_events(struct mpv_handle *ctx, uint64_t event_mask);
+static void remove_subscriber(struct mp_client_api *clients,
+                              struct observe_property *prop);
 
 void mp_clients_init(struct MPContext *mpctx)
 {
@@ -316,6 +343,47 @@ static void wakeup_client(struct mpv_handle *ctx)
     pthread_mutex_unlock(&ctx->wakeup_lock);
 }
 
+// Like wakeup_client(), but defer the wakeup if the core batches them.
+// Called with ctx->lock held. May be called from any thread.
+static void notify_client(struct mpv_handle *ctx)
+{
+    struct mp_client_api *clients = ctx->clients;
+    if (atomic_load(&clients->defer_wakeups)) {
+        ctx->wakeup_deferred = true;
+        atomic_store(&clients->have_deferred, true);
+        // If the core stopped deferring in the meantime, it may have flushed
+        // before seeing have_deferred. Pairs with the store/exchange in
+        // mp_client_defer_wakeups(): one of the two sides will see the other.
+        if (atomic_load(&clients->defer_wakeups))
+            return;
+        ctx->wakeup_deferred = false;
+    }
+    wakeup_client(ctx);
+}
+
+// Start (defer==true) or stop deferring client wakeups. Stopping performs all
+// wakeups that were deferred. Must be called from the core thread.
+void mp_client_defer_wakeups(struct MPContext *mpctx, bool defer)
+{
+    struct mp_client_api *clients = mpctx->clients;
+
+    atomic_store(&clients->defer_wakeups, defer);
+    if (defer || !atomic_exchange(&clients->have_deferred, false))
+        return;
+
+    pthread_mutex_lock(&clients->lock);
+    for (int n = 0; n < clients->num_clients; n++) {
+        struct mpv_handle *ctx = clients->clients[n];
+        pthread_mutex_lock(&ctx->lock);
+        if (ctx->wakeup_deferred) {
+            ctx->wakeup_deferred = false;
+            wakeup_client(ctx);
+        }
+        pthread_mutex_unlock(&ctx->lock);
+    }
+    pthread_mutex_unlock(&clients->lock);
+}
+
 // Note: the caller has to deal with sporadic wakeups.
 static int wait_wakeup(struct mpv_handle *ctx, int64_t end)
 {
@@ -401,6 +469,11 @@ static void mp_destroy_client(mpv_handle *ctx, bool terminate)
     for (int n = 0; n < clients->num_clients; n++) {
         if (clients->clients[n] == ctx) {
             MP_TARRAY_REMOVE_AT(clients->clients, clients->num_clients, n);
+            for (int i = 0; i < ctx->num_properties; i++) {
+                remove_subscriber(clients, ctx->properties[i]);
+                if (ctx->properties[i]->min_interval)
+                    clients->num_throttled--;
+            }
             while (ctx->num_events) {
                 talloc_free(ctx->events[ctx->first_event].data);
                 ctx->first_event = (ctx->first_event + 1) % ctx->max_events;
@@ -633,7 +706,7 @@ static int append_event(struct mpv_handle *ctx, struct mpv_event event, bool cop
         dup_event_data(&event);
     ctx->events[(ctx->first_event + ctx->num_events) % ctx->max_events] = event;
     ctx->num_events++;
-    wakeup_client(ctx);
+    notify_client(ctx);
     if (event.event_id == MPV_EVENT_SHUTDOWN)
         ctx->event_mask &= ctx->event_mask & ~(1ULL << MPV_EVENT_SHUTDOWN);
     return 0;
@@ -952,6 +1025,25 @@ static bool compare_value(void *a, void *b, mpv_format format)
     abort();
 }
 
+// Return whether a and b are numbers which differ by less than delta.
+static bool within_delta(void *a, void *b, mpv_format format, double delta)
+{
+    switch (format) {
+    case MPV_FORMAT_INT64:
+        return fabs((double)*(int64_t *)a - *(int64_t *)b) < delta;
+    case MPV_FORMAT_DOUBLE:
+        return fabs(*(double *)a - *(double *)b) < delta;
+    case MPV_FORMAT_NODE: {
+        struct mpv_node *a_n = a, *b_n = b;
+        if (a_n->format != b_n->format)
+            return false;
+        return within_delta(&a_n->u, &b_n->u, a_n->format, delta);
+    }
+    default:
+        return false;
+    }
+}
+
 void mpv_free_node_contents(mpv_node *node)
 {
     static const struct m_option type = { .type = CONF_TYPE_NODE };
@@ -1335,6 +1427,97 @@ int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format,
     return req.status;
 }
 
+struct properties_request {
+    struct MPContext *mpctx;
+    const char **names;
+    mpv_node *map;
+    int status;
+};
+
+static void getproperties_fn(void *arg)
+{
+    struct properties_request *req = arg;
+
+    node_init(req->map, MPV_FORMAT_NODE_MAP, NULL);
+    for (int n = 0; req->names[n]; n++) {
+        struct mpv_node *entry = node_map_add(req->map, req->names[n],
+                                              MPV_FORMAT_NONE);
+        struct getproperty_request get = {
+            .mpctx = req->mpctx,
+            .name = req->names[n],
+            .format = MPV_FORMAT_NODE,
+            .data = entry,
+        };
+        getproperty_fn(&get);
+        // On failure, the entry stays MPV_FORMAT_NONE.
+        if (get.status < 0) {
+            *entry = (struct mpv_node){.format = MPV_FORMAT_NONE};
+        } else {
+            // m_option_type_node memory management rules.
+            talloc_steal(req->map->u.list, node_get_alloc(entry));
+        }
+    }
+}
+
+int mpv_get_properties(mpv_handle *ctx, const char **names, mpv_node *result)
+{
+    if (!ctx->mpctx->initialized)
+        return MPV_ERROR_UNINITIALIZED;
+    if (!names || !result)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    struct properties_request req = {
+        .mpctx = ctx->mpctx,
+        .names = names,
+        .map = result,
+    };
+    run_locked(ctx, getproperties_fn, &req);
+    return 0;
+}
+
+static void setproperties_fn(void *arg)
+{
+    struct properties_request *req = arg;
+    mpv_node_list *list = req->map->u.list;
+
+    for (int n = 0; n < list->num; n++) {
+        struct setproperty_request set = {
+            .mpctx = req->mpctx,
+            .name = list->keys[n],
+            .format = MPV_FORMAT_NODE,
+            .data = &list->values[n],
+        };
+        setproperty_fn(&set);
+        if (set.status < 0 && req->status >= 0)
+            req->status = set.status;
+    }
+}
+
+int mpv_set_properties(mpv_handle *ctx, mpv_node *map)
+{
+    if (!map || map->format != MPV_FORMAT_NODE_MAP)
+        return MPV_ERROR_INVALID_PARAMETER;
+
+    if (!ctx->mpctx->initialized) {
+        // Goes through the option code; there's no core lock to save.
+        int status = 0;
+        for (int n = 0; n < map->u.list->num; n++) {
+            int r = mpv_set_property(ctx, map->u.list->keys[n],
+                                     MPV_FORMAT_NODE, &map->u.list->values[n]);
+            if (r < 0 && status >= 0)
+                status = r;
+        }
+        return status;
+    }
+
+    struct properties_request req = {
+        .mpctx = ctx->mpctx,
+        .map = map,
+    };
+    run_locked(ctx, setproperties_fn, &req);
+    return req.status;
+}
+
 char *mpv_get_property_string(mpv_handle *ctx, const char *name)
 {
     char *str = NULL;
@@ -1378,15 +1561,56 @@ static void property_free(void *p)
     }
 }
 
+// Called with clients->lock held.
+static void add_subscriber(struct mp_client_api *clients,
+                           struct observe_property *prop)
+{
+    int slot = prop->id + 1;
+    if (slot >= clients->num_subscribers) {
+        MP_TARRAY_GROW(clients, clients->subscribers, slot);
+        for (int n = clients->num_subscribers; n <= slot; n++)
+            clients->subscribers[n] = (struct property_subscribers){0};
+        clients->num_subscribers = slot + 1;
+    }
+    struct property_subscribers *subs = &clients->subscribers[slot];
+    MP_TARRAY_APPEND(clients, subs->props, subs->num_props, prop);
+}
+
+// Called with clients->lock held.
+static void remove_subscriber(struct mp_client_api *clients,
+                              struct observe_property *prop)
+{
+    int slot = prop->id + 1;
+    assert(slot < clients->num_subscribers);
+    struct property_subscribers *subs = &clients->subscribers[slot];
+    for (int n = 0; n < subs->num_props; n++) {
+        if (subs->props[n] == prop) {
+            MP_TARRAY_REMOVE_AT(subs->props, subs->num_props, n);
+            return;
+        }
+    }
+    assert(0);
+}
+
 int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
                          const char *name, mpv_format format)
+{
+    return mpv_observe_property_throttled(ctx, userdata, name, format, 0, 0);
+}
+
+int mpv_observe_property_throttled(mpv_handle *ctx, uint64_t userdata,
+                                   const char *name, mpv_format format,
+                                   double min_interval, double min_delta)
 {
     if (format != MPV_FORMAT_NONE && !get_mp_type_get(format))
         return MPV_ERROR_PROPERTY_FORMAT;
     // Explicitly disallow this, because it would require a special code path.
     if (format == MPV_FORMAT_OSD_STRING)
         return MPV_ERROR_PROPERTY_FORMAT;
+    if (!(min_interval >= 0 && min_interval < 1e6) || !(min_delta >= 0))
+        return MPV_ERROR_INVALID_PARAMETER;
 
+    pthread_mutex_lock(&ctx->clients->lock);
     pthread_mutex_lock(&ctx->lock);
     struct observe_property *prop = talloc_ptrtype(ctx, prop);
     talloc_set_destructor(prop, property_free);
@@ -1394,22 +1618,30 @@ int mpv_observe_property(mpv_handle *ctx, uint64_t userdata,
         .client = ctx,
         .name = talloc_strdup(prop, name),
         .id = mp_get_property_id(ctx->mpctx, name),
+        .index = ctx->num_properties,
         .event_mask = mp_get_property_event_mask(name),
         .reply_id = userdata,
         .format = format,
+        .min_interval = min_interval * 1e6,
+        .min_delta = min_delta,
         .changed = true,
         .need_new_value = true,
     };
     MP_TARRAY_APPEND(ctx, ctx->properties, ctx->num_properties, prop);
+    add_subscriber(ctx->clients, prop);
+    if (prop->min_interval)
+        ctx->clients->num_throttled++;
     ctx->property_event_masks |= prop->event_mask;
     ctx->lowest_changed = 0;
     pthread_mutex_unlock(&ctx->lock);
+    pthread_mutex_unlock(&ctx->clients->lock);
     invalidate_global_event_mask(ctx);
     return 0;
 }
 
 int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
 {
+    pthread_mutex_lock(&ctx->clients->lock);
     pthread_mutex_lock(&ctx->lock);
     ctx->property_event_masks = 0;
     int count = 0;
@@ -1425,7 +1657,12 @@ int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
                 // with the value update mechanism.
                 talloc_steal(ctx->cur_event, prop);
             }
+            remove_subscriber(ctx->clients, prop);
+            if (prop->min_interval)
+                ctx->clients->num_throttled--;
             MP_TARRAY_REMOVE_AT(ctx->properties, ctx->num_properties, n);
+            for (int i = n; i < ctx->num_properties; i++)
+                ctx->properties[i]->index = i;
             count++;
         }
         if (!prop->dead)
@@ -1433,36 +1670,71 @@ int mpv_unobserve_property(mpv_handle *ctx, uint64_t userdata)
     }
     ctx->lowest_changed = 0;
     pthread_mutex_unlock(&ctx->lock);
+    pthread_mutex_unlock(&ctx->clients->lock);
     invalidate_global_event_mask(ctx);
     return count;
 }
 
-static void mark_property_changed(struct mpv_handle *client, int index)
+static void mark_property_changed(struct mpv_handle *client,
+                                  struct observe_property *prop)
 {
-    struct observe_property *prop = client->properties[index];
     prop->changed = true;
     prop->need_new_value = prop->format != 0;
-    client->lowest_changed = MPMIN(client->lowest_changed, index);
+    client->lowest_changed = MPMIN(client->lowest_changed, prop->index);
 }
 
 // Broadcast that a property has changed.
 void mp_client_property_change(struct MPContext *mpctx, const char *name)
 {
     struct mp_client_api *clients = mpctx->clients;
-    int id = mp_get_property_id(mpctx, name);
+    int slot = mp_get_property_id(mpctx, name) + 1;
 
     pthread_mutex_lock(&clients->lock);
 
-    for (int n = 0; n < clients->num_clients; n++) {
-        struct mpv_handle *client = clients->clients[n];
-        pthread_mutex_lock(&client->lock);
-        for (int i = 0; i < client->num_properties; i++) {
-            if (client->properties[i]->id == id)
-                mark_property_changed(client, i);
+    // Only touch clients which actually observe the property.
+    if (slot < clients->num_subscribers) {
+        struct property_subscribers *subs = &clients->subscribers[slot];
+        for (int n = 0; n < subs->num_props; n++) {
+            struct observe_property *prop = subs->props[n];
+            struct mpv_handle *client = prop->client;
+            pthread_mutex_lock(&client->lock);
+            // A pending throttled change is delivered by
+            // mp_client_update_throttled() when due; no need to wake up.
+            bool pending = prop->min_interval && prop->changed;
+            mark_property_changed(client, prop);
+            if (!pending)
+                notify_client(client);
+            pthread_mutex_unlock(&client->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&clients->lock);
+}
+
+// Wake up clients whose delayed (throttled) property changes are due, and
+// make the playloop wake up for the next one. Called by the playloop.
+void mp_client_update_throttled(struct MPContext *mpctx)
+{
+    struct mp_client_api *clients = mpctx->clients;
+
+    pthread_mutex_lock(&clients->lock);
+
+    if (clients->num_throttled) {
+        int64_t now = mp_time_us();
+        for (int n = 0; n < clients->num_clients; n++) {
+            struct mpv_handle *client = clients->clients[n];
+            pthread_mutex_lock(&client->lock);
+            if (client->throttle_deadline) {
+                if (client->throttle_deadline <= now) {
+                    client->throttle_deadline = 0;
+                    notify_client(client);
+                } else {
+                    mp_set_timeout(mpctx,
+                        (client->throttle_deadline - now) / 1e6);
+                }
+            }
+            pthread_mutex_unlock(&client->lock);
         }
-        if (client->lowest_changed < client->num_properties)
-            wakeup_client(client);
-        pthread_mutex_unlock(&client->lock);
     }
 
     pthread_mutex_unlock(&clients->lock);
@@ -1474,10 +1746,10 @@ static void notify_property_events(struct mpv_handle *ctx, uint64_t event_mask)
 {
     for (int i = 0; i < ctx->num_properties; i++) {
         if (ctx->properties[i]->event_mask & event_mask)
-            mark_property_changed(ctx, i);
+            mark_property_changed(ctx, ctx->properties[i]);
     }
     if (ctx->lowest_changed < ctx->num_properties)
-        wakeup_client(ctx);
+        notify_client(ctx);
 }
 
 static void update_prop(void *p)
@@ -1507,7 +1779,10 @@ static void update_prop(void *p)
     if (prop->user_value_valid != prop->new_value_valid) {
         prop->changed = true;
     } else if (prop->user_value_valid && prop->new_value_valid) {
-        if (!compare_value(&prop->user_value, &prop->new_value, prop->format))
+        if (!compare_value(&prop->user_value, &prop->new_value, prop->format) &&
+            !(prop->min_delta && within_delta(&prop->user_value,
+                                              &prop->new_value, prop->format,
+                                              prop->min_delta)))
             prop->changed = true;
     }
     if (prop->dead)
@@ -1528,6 +1803,20 @@ static bool gen_property_change_event(struct mpv_handle *ctx)
         struct observe_property *prop = ctx->properties[n];
         if ((prop->changed || prop->updating) && n < ctx->lowest_changed)
             ctx->lowest_changed = n;
+        if (prop->changed && prop->min_interval) {
+            // Coalesce changes until the interval has passed; the value is
+            // retrieved only then, so the event carries the latest value.
+            int64_t now = mp_time_us();
+            if (now < prop->next_event) {
+                if (!ctx->throttle_deadline ||
+                    prop->next_event < ctx->throttle_deadline)
+                {
+                    ctx->throttle_deadline = prop->next_event;
+                    mp_wakeup_core(ctx->mpctx);
+                }
+                continue;
+            }
+        }
         if (prop->changed) {
             bool get_value = prop->need_new_value;
             prop->need_new_value = false;
@@ -1547,6 +1836,8 @@ static bool gen_property_change_event(struct mpv_handle *ctx)
                 };
                 if (prop->user_value_valid)
                     ctx->cur_property_event.data = &prop->user_value;
+                if (prop->min_interval)
+                    prop->next_event = mp_time_us() + prop->min_interval;
                 *ctx->cur_event = (struct mpv_event){
                     .event_id = MPV_EVENT_PROPERTY_CHANGE,
                     .reply_userdata = prop->reply_id,
@@ -40,6 +40,7 @@
 #include "command.h"
 #include "osdep/timer.h"
 #include "common/common.h"
+#include "common/metrics.h"
 #include "input/input.h"
 #include "input/keycodes.h"
 #include "stream/stream.h"
@@ -74,6 +75,8 @@
 struct command_ctx {
     // All properties, terminated with a {0} item.
     struct m_property *properties;
+    // Name lookup for the properties list.
+    struct m_property_index *property_index;
 
     bool is_idle;
 
@@ -381,7 +384,8 @@ int mp_on_set_option(void *ctx, struct m_config_option *co, void *data, int flag
     // property implementation is trivial, and can break some obscure features
     // like --profile and --include if non-trivial flags are involved (which
     // the bridge would drop).
-    struct m_property *prop = m_property_list_find(cmd->properties, name);
+    struct m_property *prop = m_property_index_find(cmd->property_index,
+                                                    bstr0(name));
     if (prop && prop->is_option)
         goto direct_option;
 
@@ -3314,30 +3318,11 @@ static int mp_property_playlist_pos_1(void *ctx, struct m_property *prop,
     return mp_property_playlist_pos_x(ctx, prop, action, arg, 1);
 }
 
-struct get_playlist_ctx {
-    struct MPContext *mpctx;
-    int last_index;
-    struct playlist_entry *last_entry;
-};
-
 static int get_playlist_entry(int item, int action, void *arg, void *ctx)
 {
-    struct get_playlist_ctx *p = ctx;
-    struct MPContext *mpctx = p->mpctx;
-
-    struct playlist_entry *e;
-    // This is an optimization that prevents O(n^2) behaviour when the entire
-    // playlist is requested. If a request is made for the last requested entry
-    // or the entry immediately following it, it can be found without a full
-    // traversal of the linked list.
-    if (p->last_entry && item == p->last_index)
-        e = p->last_entry;
-    else if (p->last_entry && item == p->last_index + 1)
-        e = p->last_entry->next;
-    else
-        e = playlist_entry_from_index(mpctx->playlist, item);
-    p->last_index = item;
-    p->last_entry = e;
+    struct MPContext *mpctx = ctx;
+
+    struct playlist_entry *e = playlist_entry_from_index(mpctx->playlist, item);
     if (!e)
         return M_PROPERTY_ERROR;
 
@@ -3371,7 +3356,7 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
                     p = s;
             }
             const char *m = pl->current == e ? list_current : list_normal;
-            res = talloc_asprintf_append(res, "%s%s\n", m, p);
+            res = talloc_asprintf_append_buffer(res, "%s%s\n", m, p);
         }
 
         *(char **)arg =
@@ -3379,9 +3364,15 @@ static int mp_property_playlist(void *ctx, struct m_property *prop,
         return M_PROPERTY_OK;
     }
 
-    struct get_playlist_ctx p = {.mpctx = mpctx};
     return m_property_read_list(action, arg, playlist_entry_count(mpctx->playlist),
-                                get_playlist_entry, &p);
+                                get_playlist_entry, mpctx);
+}
+
+static int mp_property_playlist_loading(void *ctx, struct m_property *prop,
+                                        int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    return m_property_flag_ro(action, arg, !!mpctx->playlist_loader);
 }
 
 static char *print_obj_osd_list(struct m_obj_settings *list)
@@ -3821,6 +3812,38 @@ static int mp_profile_list(void *ctx, struct m_property *prop,
     return M_PROPERTY_NOT_IMPLEMENTED;
 }
 
+static int mp_property_metrics(void *ctx, struct m_property *prop,
+                               int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET:
+        mp_metrics_get_node(mpctx->global->metrics, arg);
+        return M_PROPERTY_OK;
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
+static int mp_property_filter_graph_stats(void *ctx, struct m_property *prop,
+                                          int action, void *arg)
+{
+    MPContext *mpctx = ctx;
+    if (!mpctx->filter_root)
+        return M_PROPERTY_UNAVAILABLE;
+    switch (action) {
+    case M_PROPERTY_GET_TYPE:
+        *(struct m_option *)arg = (struct m_option){.type = CONF_TYPE_NODE};
+        return M_PROPERTY_OK;
+    case M_PROPERTY_GET:
+        mp_filter_get_stats(mpctx->filter_root, arg);
+        return M_PROPERTY_OK;
+    }
+    return M_PROPERTY_NOT_IMPLEMENTED;
+}
+
 // Redirect a property name to another
 #define M_PROPERTY_ALIAS(name, real_property) \
     {(name), mp_property_alias, .priv = (real_property)}
@@ -3905,6 +3928,7 @@ static const struct m_property mp_properties_base[] = {
     {"playlist-pos", mp_property_playlist_pos},
     {"playlist-pos-1", mp_property_playlist_pos_1},
     M_PROPERTY_ALIAS("playlist-count", "playlist/count"),
+    {"playlist-loading", mp_property_playlist_loading},
 
     // Audio
     {"mixer-active", mp_property_mixer_active},
@@ -4024,6 +4048,8 @@ static const struct m_property mp_properties_base[] = {
     {"option-info", mp_property_option_info},
     {"property-list", mp_property_list},
     {"profile-list", mp_profile_list},
+    {"metrics", mp_property_metrics},
+    {"filter-graph-stats", mp_property_filter_graph_stats},
 
     M_PROPERTY_ALIAS("video", "vid"),
     M_PROPERTY_ALIAS("audio", "aid"),
@@ -4129,11 +4155,13 @@ uint64_t mp_get_property_event_mask(const char *name)
 int mp_get_property_id(struct MPContext *mpctx, const char *name)
 {
     struct command_ctx *ctx = mpctx->command_ctx;
-    for (int n = 0; ctx->properties[n].name; n++) {
-        if (match_property(ctx->properties[n].name, name))
-            return n;
-    }
-    return -1;
+    // Give options and properties the same ID each, so change notifications
+    // work both way. Sub-properties map to the ID of the base property.
+    if (strncmp(name, "options/", 8) == 0)
+        name += 8;
+    const char *sep = strchr(name, '/');
+    bstr base = sep ? (bstr){(unsigned char *)name, sep - name} : bstr0(name);
+    return m_property_index_get_pos(ctx->property_index, base);
 }
 
 static bool is_property_set(int action, void *val)
@@ -4158,7 +4186,8 @@ static int mp_property_do_silent(const char *name, int action, void *val,
 {
     struct command_ctx *cmd = ctx->command_ctx;
     cmd->silence_option_deprecations += 1;
-    int r = m_property_do(ctx->log, cmd->properties, name, action, val, ctx);
+    int r = m_property_do(ctx->log, cmd->property_index, name, action, val,
+                          ctx);
     cmd->silence_option_deprecations -= 1;
     if (r == M_PROPERTY_OK && is_property_set(action, val))
         mp_notify_property(ctx, (char *)name);
@@ -4192,7 +4221,7 @@ int mp_property_do(const char *name, int action, void *val,
 char *mp_property_expand_string(struct MPContext *mpctx, const char *str)
 {
     struct command_ctx *ctx = mpctx->command_ctx;
-    return m_properties_expand_string(ctx->properties, str, mpctx);
+    return m_properties_expand_string(ctx->property_index, str, mpctx);
 }
 
 // Before expanding properties, parse C-style escapes like "\n"
@@ -5084,8 +5113,10 @@ int run_command(struct MPContext *mpctx, struct mp_cmd *cmd, struct mpv_node *re
         char *filename = cmd->args[0].v.s;
         int append = cmd->args[1].v.i;
 
-        if (!append)
+        if (!append) {
+            mp_stop_playlist_loader(mpctx);
             playlist_clear(mpctx->playlist);
+        }
 
         struct playlist_entry *entry = playlist_entry_new(filename);
         if (cmd->args[2].v.str_list) {
@@ -5114,8 +5145,10 @@ int run_command(struct MPContext *mpctx, struct mp_cmd *cmd, struct mpv_node *re
         if (pl) {
             prepare_playlist(mpctx, pl);
             struct playlist_entry *new = pl->current;
-            if (!append)
+            if (!append) {
+                mp_stop_playlist_loader(mpctx);
                 playlist_clear(mpctx->playlist);
+            }
             playlist_append_entries(mpctx->playlist, pl);
             talloc_free(pl);
 
@@ -5135,15 +5168,8 @@ int run_command(struct MPContext *mpctx, struct mp_cmd *cmd, struct mpv_node *re
         // Supposed to clear the playlist, except the currently played item.
         if (mpctx->playlist->current_was_replaced)
             mpctx->playlist->current = NULL;
-        while (mpctx->playlist->first) {
-            struct playlist_entry *e = mpctx->playlist->first;
-            if (e == mpctx->playlist->current) {
-                e = e->next;
-                if (!e)
-                    break;
-            }
-            playlist_remove(mpctx->playlist, e);
-        }
+        mp_stop_playlist_loader(mpctx);
+        playlist_clear_except_current(mpctx->playlist);
         mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
         mp_wakeup_core(mpctx);
         break;
@@ -5184,6 +5210,7 @@ int run_command(struct MPContext *mpctx, struct mp_cmd *cmd, struct mpv_node *re
     }
 
     case MP_CMD_STOP:
+        mp_stop_playlist_loader(mpctx);
         playlist_clear(mpctx->playlist);
         if (mpctx->stop_play != PT_QUIT)
             mpctx->stop_play = PT_STOP;
@@ -5610,6 +5637,12 @@ void command_init(struct MPContext *mpctx)
         talloc_zero_array(ctx, struct m_property, num_base + num_opts + 1);
     memcpy(ctx->properties, mp_properties_base, sizeof(mp_properties_base));
 
+    // Only used to look up manual properties while adding the options. The
+    // index covers the entries up to the first {0} item, which are exactly
+    // the manual ones at this point.
+    struct m_property_index *base_index =
+        m_property_index_create(NULL, ctx->properties);
+
     int count = num_base;
     for (int n = 0; n < num_opts; n++) {
         struct m_config_option *co = m_config_get_co_index(mpctx->mconfig, n);
@@ -5639,12 +5672,15 @@ void command_init(struct MPContext *mpctx)
 
         if (prop.name) {
             // The option might be covered by a manual property already.
-            if (m_property_list_find(ctx->properties, prop.name))
+            if (m_property_index_find(base_index, bstr0(prop.name)))
                 continue;
 
             ctx->properties[count++] = prop;
         }
     }
+
+    talloc_free(base_index);
+    ctx->property_index = m_property_index_create(ctx, ctx->properties);
 }
 
 static void command_event(struct MPContext *mpctx, int event, void *arg)
@@ -5674,6 +5710,8 @@ void handle_command_updates(struct MPContext *mpctx)
     // to recheck the state. Then the client(s) will read the property.
     if (ctx->hotplug && ao_hotplug_check_update(ctx->hotplug))
         mp_notify_property(mpctx, "audio-device-list");
+
+    mp_client_update_throttled(mpctx);
 }
 
 void mp_notify(struct MPContext *mpctx, int event, void *arg)
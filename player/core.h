@@ -265,6 +265,12 @@ typedef struct MPContext {
 
     struct playlist *playlist;
     struct playlist_entry *playing; // currently playing file
+    // Reads the rest of a playlist file in the background (or NULL). New
+    // entries are inserted after playlist_loader_last (reserved).
+    struct demux_playlist_loader *playlist_loader;
+    struct playlist_entry *playlist_loader_last;
+    char *playlist_loader_redirect;
+    int playlist_loader_stream_flags;
     char *filename; // immutable copy of playing->filename (or NULL)
     char *stream_open_filename;
     enum stop_play_reason stop_play;
@@ -500,6 +506,8 @@ struct playlist_entry *mp_next_file(struct MPContext *mpctx, int direction,
                                     bool force, bool mutate);
 void mp_set_playlist_entry(struct MPContext *mpctx, struct playlist_entry *e);
 void mp_play_files(struct MPContext *mpctx);
+void mp_update_playlist_loader(struct MPContext *mpctx);
+void mp_stop_playlist_loader(struct MPContext *mpctx);
 void update_demuxer_properties(struct MPContext *mpctx);
 void print_track_list(struct MPContext *mpctx, const char *msg);
 void reselect_demux_stream(struct MPContext *mpctx, struct track *track);
@@ -737,8 +737,16 @@ static void transfer_playlist(struct MPContext *mpctx, struct playlist *pl)
     if (pl->first) {
         prepare_playlist(mpctx, pl);
         struct playlist_entry *new = pl->current;
-        if (mpctx->playlist->current)
-            playlist_add_redirect(pl, mpctx->playlist->current->filename);
+        struct playlist_entry *cur = mpctx->playlist->current;
+        if (cur)
+            playlist_add_redirect(pl, cur->filename);
+        // If the replaced entry is where the playlist loader inserts, insert
+        // after the replacement entries instead.
+        if (cur && cur == mpctx->playlist_loader_last) {
+            playlist_entry_unref(mpctx->playlist_loader_last);
+            mpctx->playlist_loader_last = pl->last;
+            pl->last->reserved += 1;
+        }
         playlist_transfer_entries(mpctx->playlist, pl);
         // current entry is replaced
         if (mpctx->playlist->current)
@@ -750,6 +758,85 @@ static void transfer_playlist(struct MPContext *mpctx, struct playlist *pl)
     }
 }
 
+// Keep reading the rest of the playlist file in the background. The entries
+// are inserted after "last" as they arrive (see mp_update_playlist_loader()).
+static void start_playlist_loader(struct MPContext *mpctx,
+                                  struct playlist_entry *last, int stream_flags)
+{
+    assert(!mpctx->playlist_loader);
+
+    struct demux_playlist_loader *loader =
+        demux_steal_playlist_loader(mpctx->demuxer, NULL);
+    mpctx->playlist_loader = loader;
+    mpctx->playlist_loader_last = last;
+    last->reserved += 1;
+    struct playlist_entry *cur = mpctx->playlist->current;
+    mpctx->playlist_loader_redirect = cur ? talloc_strdup(NULL, cur->filename)
+                                          : NULL;
+    mpctx->playlist_loader_stream_flags = stream_flags;
+    demux_playlist_loader_set_wakeup_cb(loader, mp_wakeup_core_cb, mpctx);
+    mp_notify_property(mpctx, "playlist-loading");
+}
+
+// Insert the entries the playlist loader read since the last call.
+void mp_update_playlist_loader(struct MPContext *mpctx)
+{
+    if (!mpctx->playlist_loader)
+        return;
+
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    bool more = demux_playlist_loader_read(mpctx->playlist_loader, pl);
+    if (pl->first) {
+        for (struct playlist_entry *e = pl->first; e; e = e->next)
+            e->stream_flags |= mpctx->playlist_loader_stream_flags;
+        if (mpctx->playlist_loader_redirect)
+            playlist_add_redirect(pl, mpctx->playlist_loader_redirect);
+
+        // Append to the end if the previous entry was removed.
+        struct playlist_entry *after = mpctx->playlist_loader_last;
+        if (after->pl != mpctx->playlist)
+            after = mpctx->playlist->last;
+        struct playlist_entry *last = pl->last;
+        playlist_transfer_entries_after(mpctx->playlist, after, pl);
+        playlist_entry_unref(mpctx->playlist_loader_last);
+        mpctx->playlist_loader_last = last;
+        last->reserved += 1;
+        mp_notify(mpctx, MP_EVENT_CHANGE_PLAYLIST, NULL);
+    }
+    talloc_free(pl);
+
+    if (!more)
+        mp_stop_playlist_loader(mpctx);
+}
+
+void mp_stop_playlist_loader(struct MPContext *mpctx)
+{
+    if (!mpctx->playlist_loader)
+        return;
+
+    TA_FREEP(&mpctx->playlist_loader);
+    playlist_entry_unref(mpctx->playlist_loader_last);
+    mpctx->playlist_loader_last = NULL;
+    TA_FREEP(&mpctx->playlist_loader_redirect);
+    mp_notify_property(mpctx, "playlist-loading");
+}
+
+// If playback reached the end of a playlist that is still being loaded, wait
+// for more entries. Returns true if the user selected an entry meanwhile.
+static bool wait_playlist_loader(struct MPContext *mpctx)
+{
+    struct playlist *pl = mpctx->playlist;
+    struct playlist_entry *cur = pl->current;
+    if (!cur || pl->current_was_replaced)
+        return false;
+
+    while (mpctx->playlist_loader && mpctx->stop_play != PT_QUIT &&
+           pl->current == cur && !pl->current_was_replaced && !cur->next)
+        mp_idle(mpctx);
+
+    return pl->current != cur && !pl->current_was_replaced;
+}
+
 static void process_hooks(struct MPContext *mpctx, char *name)
 {
     mp_hook_start(mpctx, name);
@@ -806,6 +893,7 @@ static void *open_demux_thread(void *ctx)
         .force_format = mpctx->open_format,
         .stream_flags = mpctx->open_url_flags,
         .initial_readahead = true,
+        .allow_playlist_loader = true,
     };
     mpctx->open_res_demuxer =
         demux_open_url(mpctx->open_url, &p, mpctx->open_cancel, mpctx->global);
@@ -1233,6 +1321,20 @@ reopen_file:
 
     if (mpctx->demuxer->playlist) {
         struct playlist *pl = mpctx->demuxer->playlist;
+        struct demux_playlist_loader *loader = mpctx->demuxer->playlist_loader;
+        if (loader && (opts->shuffle || opts->merge_files ||
+                       opts->playlist_pos >= 0 || mpctx->playlist_loader))
+        {
+            // These need the complete playlist. A playlist nested in one that
+            // is still being loaded is read completely too, so the outer
+            // loader can keep running.
+            demux_playlist_loader_set_wakeup_cb(loader, mp_wakeup_core_cb, mpctx);
+            while (demux_playlist_loader_read(loader, pl) && !mpctx->stop_play)
+                mp_idle(mpctx);
+            if (mpctx->stop_play)
+                goto terminate_playback;
+            loader = NULL;
+        }
         int entry_stream_flags = 0;
         if (!pl->disable_safety) {
             entry_stream_flags = STREAM_SAFE_ONLY;
@@ -1241,6 +1343,8 @@ reopen_file:
         }
         for (struct playlist_entry *e = pl->first; e; e = e->next)
             e->stream_flags |= entry_stream_flags;
+        if (loader)
+            start_playlist_loader(mpctx, pl->last, entry_stream_flags);
         transfer_playlist(mpctx, pl);
         mp_notify_property(mpctx, "playlist");
         mpctx->error_playing = 2;
@@ -1534,7 +1638,13 @@ void mp_play_files(struct MPContext *mpctx)
         if (mpctx->stop_play == PT_NEXT_ENTRY || mpctx->stop_play == PT_ERROR ||
             mpctx->stop_play == AT_END_OF_FILE || !mpctx->stop_play)
         {
-            new_entry = mp_next_file(mpctx, +1, false, true);
+            if (wait_playlist_loader(mpctx)) {
+                new_entry = mpctx->playlist->current;
+            } else {
+                new_entry = mp_next_file(mpctx, +1, false, true);
+            }
+            if (mpctx->stop_play == PT_QUIT)
+                break;
         }
 
         mpctx->playlist->current = new_entry;
@@ -1546,6 +1656,7 @@ void mp_play_files(struct MPContext *mpctx)
     }
 
     cancel_open(mpctx);
+    mp_stop_playlist_loader(mpctx);
 }
 
 // Abort current playback and set the given entry to play next.
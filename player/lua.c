@@ -1289,7 +1289,7 @@ static int script_parse_json(lua_State *L)
     bool trail = lua_toboolean(L, 2);
     bool ok = false;
     struct mpv_node node;
-    if (json_parse(tmp, &node, &text, 32) >= 0) {
+    if (json_parse(talloc_new_arena(tmp), &node, &text, 32) >= 0) {
         json_skip_whitespace(&text);
         ok = !text[0] || trail;
     }
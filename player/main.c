@@ -43,6 +43,7 @@
 #include "common/msg.h"
 #include "common/msg_control.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "filters/f_decoder_wrapper.h"
 #include "options/parse_configfile.h"
 #include "options/parse_commandline.h"
@@ -295,6 +296,8 @@ struct MPContext *mp_create(void)
     mpctx->log = mp_log_new(mpctx, mpctx->global->log, "!cplayer");
     mpctx->statusline = mp_log_new(mpctx, mpctx->log, "!statusline");
 
+    mpctx->global->metrics = mp_metrics_create(mpctx->global);
+
     // Create the config context and register the options
     mpctx->mconfig = m_config_new(mpctx, mpctx->log, sizeof(struct MPOpts),
                                   &mp_default_opts, mp_opts);
@@ -156,14 +156,16 @@ static bool is_busy(struct MPContext *mpctx)
     return !mpctx->restart_complete && mp_time_sec() - mpctx->start_timestamp > 0.3;
 }
 
-static char *get_term_status_msg(struct MPContext *mpctx)
+static char *get_term_status_msg(struct MPContext *mpctx, void *ta_ctx)
 {
     struct MPOpts *opts = mpctx->opts;
 
-    if (opts->status_msg)
-        return mp_property_expand_escaped_string(mpctx, opts->status_msg);
+    if (opts->status_msg) {
+        return talloc_steal(ta_ctx,
+                    mp_property_expand_escaped_string(mpctx, opts->status_msg));
+    }
 
-    char *line = NULL;
+    char *line = talloc_strdup(ta_ctx, "");
 
     // Playback status
     if (is_busy(mpctx)) {
@@ -276,7 +278,10 @@ static void term_osd_print_status_lazy(struct MPContext *mpctx)
         return;
     }
 
-    char *line = get_term_status_msg(mpctx);
+    // This runs on every playloop iteration. The line is built with many small
+    // appends, which grow it in place if it's the last allocation of an arena.
+    void *tmp = talloc_new_arena(NULL);
+    char *line = get_term_status_msg(mpctx, tmp);
 
     if (opts->term_osd_bar) {
         saddf(&line, "\n");
@@ -286,7 +291,7 @@ static void term_osd_print_status_lazy(struct MPContext *mpctx)
     }
 
     term_osd_set_status_lazy(mpctx, line);
-    talloc_free(line);
+    talloc_free(tmp);
 }
 
 static bool set_osd_msg_va(struct MPContext *mpctx, int level, int time,
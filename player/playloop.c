@@ -57,11 +57,17 @@ void mp_wait_events(struct MPContext *mpctx)
     if (sleeping)
         MP_STATS(mpctx, "start sleep");
 
+    // Deliver the events of this playloop iteration with one wakeup per
+    // client. Requests processed while waiting reply immediately.
+    mp_client_defer_wakeups(mpctx, false);
+
     mpctx->in_dispatch = true;
 
     mp_dispatch_queue_process(mpctx->dispatch, mpctx->sleeptime);
 
     mpctx->in_dispatch = false;
+
+    mp_client_defer_wakeups(mpctx, true);
     mpctx->sleeptime = INFINITY;
 
     if (sleeping)
@@ -1077,17 +1083,25 @@ void run_playloop(struct MPContext *mpctx)
     }
 #endif
 
+    MP_STATS(mpctx, "start playloop");
+
     update_demuxer_properties(mpctx);
 
     handle_cursor_autohide(mpctx);
     handle_vo_events(mpctx);
     handle_command_updates(mpctx);
+    mp_update_playlist_loader(mpctx);
 
     if (mpctx->lavfi && mp_filter_has_failed(mpctx->lavfi))
         mpctx->stop_play = AT_END_OF_FILE;
 
+    MP_STATS(mpctx, "start fill-audio");
     fill_audio_out_buffers(mpctx);
+    MP_STATS(mpctx, "end fill-audio");
+
+    MP_STATS(mpctx, "start write-video");
     write_video(mpctx);
+    MP_STATS(mpctx, "end write-video");
 
     handle_delayed_audio_seek(mpctx);
 
@@ -1111,13 +1125,18 @@ void run_playloop(struct MPContext *mpctx)
 
     update_core_idle_state(mpctx);
 
-    if (mpctx->stop_play)
+    if (mpctx->stop_play) {
+        MP_STATS(mpctx, "end playloop");
         return;
+    }
 
     handle_osd_redraw(mpctx);
 
     if (mp_filter_run(mpctx->filter_root))
         mp_wakeup_core(mpctx);
+
+    MP_STATS(mpctx, "end playloop");
+
     mp_wait_events(mpctx);
 
     handle_pause_on_low_cache(mpctx);
@@ -1137,6 +1156,7 @@ void mp_idle(struct MPContext *mpctx)
     mp_wait_events(mpctx);
     mp_process_input(mpctx);
     handle_command_updates(mpctx);
+    mp_update_playlist_loader(mpctx);
     handle_cursor_autohide(mpctx);
     handle_vo_events(mpctx);
     update_osd_msg(mpctx);
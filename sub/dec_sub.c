@@ -401,8 +401,16 @@ int sub_control(struct dec_sub *sub, enum sd_ctrl cmd, void *arg)
 void sub_update_opts(struct dec_sub *sub)
 {
     pthread_mutex_lock(&sub->lock);
-    if (m_config_cache_update(sub->opts_cache))
-        update_subtitle_speed(sub);
+    if (m_config_cache_update(sub->opts_cache)) {
+        bool speed_changed = false;
+        void *opt;
+        while (m_config_cache_get_next_changed(sub->opts_cache, &opt)) {
+            if (opt == &sub->opts->sub_speed || opt == &sub->opts->sub_fps)
+                speed_changed = true;
+        }
+        if (speed_changed)
+            update_subtitle_speed(sub);
+    }
     pthread_mutex_unlock(&sub->lock);
 }
 
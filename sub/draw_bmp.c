@@ -39,6 +39,9 @@ const bool mp_draw_sub_formats[SUBBITMAP_COUNT] = {
 
 struct sub_cache {
     struct mp_image *i, *a;
+    // SUBBITMAP_LIBASS: color converted to the target colorspace
+    bool color_valid;
+    int color[3];
 };
 
 struct part {
@@ -46,8 +49,13 @@ struct part {
     int imgfmt;
     enum mp_csp colorspace;
     enum mp_csp_levels levels;
+    int w, h;
     int num_imgs;
     struct sub_cache *imgs;
+    // Disjoint, swscale-aligned rectangles covering all sub-bitmaps. Only
+    // these areas are converted to 444 and blended.
+    struct mp_rect rcs[MP_SUB_BB_LIST_MAX];
+    int num_rcs;
 };
 
 struct mp_draw_sub_cache
@@ -58,8 +66,6 @@ struct mp_draw_sub_cache
 };
 
 
-static struct part *get_cache(struct mp_draw_sub_cache *cache,
-                              struct sub_bitmaps *sbs, struct mp_image *format);
 static bool get_sub_area(struct mp_rect bb, struct mp_image *temp,
                          struct sub_bitmap *sb, struct mp_image *out_area,
                          int *out_src_x, int *out_src_y);
@@ -202,13 +208,10 @@ static void scale_sb_rgba(struct sub_bitmap *sb, struct mp_image *dst_format,
     *out_sba = sba;
 }
 
-static void draw_rgba(struct mp_draw_sub_cache *cache, struct mp_rect bb,
+static void draw_rgba(struct part *part, struct mp_rect bb,
                       struct mp_image *temp, int bits,
                       struct sub_bitmaps *sbs)
 {
-    struct part *part = get_cache(cache, sbs, temp);
-    assert(part);
-
     for (int i = 0; i < sbs->num_parts; ++i) {
         struct sub_bitmap *sb = &sbs->parts[i];
 
@@ -246,9 +249,14 @@ static void draw_rgba(struct mp_draw_sub_cache *cache, struct mp_rect bb,
     }
 }
 
-static void draw_ass(struct mp_draw_sub_cache *cache, struct mp_rect bb,
-                     struct mp_image *temp, int bits, struct sub_bitmaps *sbs)
+// Convert the libass colors of all sub-bitmaps to the colorspace of temp.
+// The result is cached in the part until the subtitle content changes.
+static void convert_ass_colors(struct part *part, struct mp_image *temp,
+                               int bits, struct sub_bitmaps *sbs)
 {
+    if (part->num_imgs && part->imgs[0].color_valid)
+        return;
+
     struct mp_csp_params cspar = MP_CSP_PARAMS_DEFAULTS;
     mp_csp_set_image_params(&cspar, &temp->params);
     cspar.levels_out = MP_CSP_LEVELS_PC; // RGB (libass.color)
@@ -264,25 +272,38 @@ static void draw_ass(struct mp_draw_sub_cache *cache, struct mp_rect bb,
 
     for (int i = 0; i < sbs->num_parts; ++i) {
         struct sub_bitmap *sb = &sbs->parts[i];
-
-        struct mp_image dst;
-        int src_x, src_y;
-        if (!get_sub_area(bb, temp, sb, &dst, &src_x, &src_y))
-            continue;
+        struct sub_cache *c = &part->imgs[i];
 
         int r = (sb->libass.color >> 24) & 0xFF;
         int g = (sb->libass.color >> 16) & 0xFF;
         int b = (sb->libass.color >> 8) & 0xFF;
-        int a = 255 - (sb->libass.color & 0xFF);
-        int color_yuv[3];
         if (need_conv) {
             int rgb[3] = {r, g, b};
-            mp_map_fixp_color(&rgb2yuv, 8, rgb, cspar.texture_bits, color_yuv);
+            mp_map_fixp_color(&rgb2yuv, 8, rgb, cspar.texture_bits, c->color);
         } else {
-            color_yuv[0] = g;
-            color_yuv[1] = b;
-            color_yuv[2] = r;
+            c->color[0] = g;
+            c->color[1] = b;
+            c->color[2] = r;
         }
+        c->color_valid = true;
+    }
+}
+
+static void draw_ass(struct part *part, struct mp_rect bb,
+                     struct mp_image *temp, int bits, struct sub_bitmaps *sbs)
+{
+    convert_ass_colors(part, temp, bits, sbs);
+
+    for (int i = 0; i < sbs->num_parts; ++i) {
+        struct sub_bitmap *sb = &sbs->parts[i];
+
+        struct mp_image dst;
+        int src_x, src_y;
+        if (!get_sub_area(bb, temp, sb, &dst, &src_x, &src_y))
+            continue;
+
+        int a = 255 - (sb->libass.color & 0xFF);
+        int *color_yuv = part->imgs[i].color;
 
         int bytes = (bits + 7) / 8;
         uint8_t *alpha_p = (uint8_t *)sb->bitmap + src_y * sb->stride + src_x;
@@ -322,17 +343,47 @@ static void align_bbox(int xstep, int ystep, struct mp_rect *rc)
     rc->y1 = FFALIGN(rc->y1, ystep);
 }
 
-// Post condition, if true returned: rc is inside img
-static bool align_bbox_for_swscale(struct mp_image *img, struct mp_rect *rc)
+static bool rects_overlap(struct mp_rect *a, struct mp_rect *b)
+{
+    return a->x0 < b->x1 && a->x1 > b->x0 && a->y0 < b->y1 && a->y1 > b->y0;
+}
+
+// Compute a list of disjoint rectangles covering every sub-bitmap, each aligned
+// for swscale and clipped to img. Unlike mp_get_sub_bb_list(), bitmaps are
+// only merged if their aligned rectangles actually overlap, so the gaps
+// between separate bitmaps are neither converted nor blended.
+static int get_draw_rects(struct mp_image *img, struct sub_bitmaps *sbs,
+                          struct mp_rect *out_rcs, int max_rcs)
 {
     struct mp_rect img_rect = {0, 0, img->w, img->h};
-    // Get rid of negative coordinates
-    if (!mp_rect_intersection(rc, &img_rect))
-        return false;
     int xstep, ystep;
     get_swscale_alignment(img, &xstep, &ystep);
-    align_bbox(xstep, ystep, rc);
-    return mp_rect_intersection(rc, &img_rect);
+
+    int num_rcs = 0;
+    for (int n = 0; n < sbs->num_parts; n++) {
+        struct sub_bitmap *sb = &sbs->parts[n];
+        struct mp_rect rc = {sb->x, sb->y, sb->x + sb->dw, sb->y + sb->dh};
+        // Get rid of negative coordinates
+        if (!mp_rect_intersection(&rc, &img_rect))
+            continue;
+        align_bbox(xstep, ystep, &rc);
+        if (!mp_rect_intersection(&rc, &img_rect))
+            continue;
+
+        // Merge with everything it touches; merging can make the union overlap
+        // further rectangles, so repeat until the list is disjoint again.
+        if (num_rcs == max_rcs)
+            mp_rect_union(&rc, &out_rcs[--num_rcs]);
+        for (int r = 0; r < num_rcs; r++) {
+            if (rects_overlap(&rc, &out_rcs[r])) {
+                mp_rect_union(&rc, &out_rcs[r]);
+                MP_TARRAY_REMOVE_AT(out_rcs, num_rcs, r);
+                r = -1;
+            }
+        }
+        out_rcs[num_rcs++] = rc;
+    }
+    return num_rcs;
 }
 
 // Try to find best/closest YUV 444 format (or similar) for imgfmt
@@ -355,39 +406,42 @@ static void get_closest_y444_format(int imgfmt, int *out_format, int *out_bits)
     *out_bits = mp_imgfmt_get_desc(*out_format).component_bits;
 }
 
+// Return the cached state for sbs, or a new one if the subtitle content or the
+// target format changed since the last call.
 static struct part *get_cache(struct mp_draw_sub_cache *cache,
                               struct sub_bitmaps *sbs, struct mp_image *format)
 {
-    struct part *part = NULL;
-
-    bool use_cache = sbs->format == SUBBITMAP_RGBA;
-    if (use_cache) {
-        part = cache->parts[sbs->render_index];
-        if (part) {
-            if (part->change_id != sbs->change_id
-                || part->imgfmt != format->imgfmt
-                || part->colorspace != format->params.color.space
-                || part->levels != format->params.color.levels)
-            {
-                talloc_free(part);
-                part = NULL;
-            }
-        }
-        if (!part) {
-            part = talloc(cache, struct part);
-            *part = (struct part) {
-                .change_id = sbs->change_id,
-                .num_imgs = sbs->num_parts,
-                .imgfmt = format->imgfmt,
-                .levels = format->params.color.levels,
-                .colorspace = format->params.color.space,
-            };
-            part->imgs = talloc_zero_array(part, struct sub_cache,
-                                           part->num_imgs);
+    struct part *part = cache->parts[sbs->render_index];
+    if (part) {
+        if (part->change_id != sbs->change_id
+            || part->imgfmt != format->imgfmt
+            || part->colorspace != format->params.color.space
+            || part->levels != format->params.color.levels
+            || part->w != format->w
+            || part->h != format->h)
+        {
+            talloc_free(part);
+            part = NULL;
         }
-        assert(part->num_imgs == sbs->num_parts);
-        cache->parts[sbs->render_index] = part;
     }
+    if (!part) {
+        part = talloc(cache, struct part);
+        *part = (struct part) {
+            .change_id = sbs->change_id,
+            .num_imgs = sbs->num_parts,
+            .imgfmt = format->imgfmt,
+            .levels = format->params.color.levels,
+            .colorspace = format->params.color.space,
+            .w = format->w,
+            .h = format->h,
+        };
+        part->imgs = talloc_zero_array(part, struct sub_cache,
+                                       part->num_imgs);
+        part->num_rcs = get_draw_rects(format, sbs, part->rcs,
+                                       MP_SUB_BB_LIST_MAX);
+    }
+    assert(part->num_imgs == sbs->num_parts);
+    cache->parts[sbs->render_index] = part;
 
     return part;
 }
@@ -507,14 +561,12 @@ void mp_draw_sub_bitmaps(struct mp_draw_sub_cache **cache, struct mp_image *dst,
     int format, bits;
     get_closest_y444_format(dst->imgfmt, &format, &bits);
 
-    struct mp_rect rc_list[MP_SUB_BB_LIST_MAX];
-    int num_rc = mp_get_sub_bb_list(sbs, rc_list, MP_SUB_BB_LIST_MAX);
-
-    for (int r = 0; r < num_rc; r++) {
-        struct mp_rect bb = rc_list[r];
+    // Bitmap conversion and the list of areas to draw only depend on the
+    // subtitle content, so they are reused as long as change_id is the same.
+    struct part *part = get_cache(cache_, sbs, dst);
 
-        if (!align_bbox_for_swscale(dst, &bb))
-            return;
+    for (int r = 0; r < part->num_rcs; r++) {
+        struct mp_rect bb = part->rcs[r];
 
         struct mp_image dst_region = *dst;
         mp_image_crop_rc(&dst_region, bb);
@@ -523,9 +575,9 @@ void mp_draw_sub_bitmaps(struct mp_draw_sub_cache **cache, struct mp_image *dst,
             continue; // on OOM, skip region
 
         if (sbs->format == SUBBITMAP_RGBA) {
-            draw_rgba(cache_, bb, temp, bits, sbs);
+            draw_rgba(part, bb, temp, bits, sbs);
         } else if (sbs->format == SUBBITMAP_LIBASS) {
-            draw_ass(cache_, bb, temp, bits, sbs);
+            draw_ass(part, bb, temp, bits, sbs);
         }
 
         chroma_down(&dst_region, temp);
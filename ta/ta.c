@@ -64,14 +64,47 @@ struct ta_ext_header {
     struct ta_header *header;  // points back to normal header
     struct ta_header children; // list of children, with this as sentinel
     void (*destructor)(void *);
+    // Set if the allocation is an arena (see ta_new_arena()), or was allocated
+    // from one. In the latter case, ext points to ta_arena.members.
+    struct ta_arena *arena;
 };
 
 // ta_ext_header.children.size is set to this
 #define CHILDREN_SENTINEL ((size_t)-1)
 
+// Arena allocations are carved from blocks of this size (or larger ones for
+// big allocations).
+#define ARENA_BLOCK_SIZE (16 * 1024)
+
+struct ta_arena_block {
+    struct ta_arena_block *next;
+    size_t size;
+    union aligned_header data[]; // (only for alignment)
+};
+
+struct ta_arena_dtor {
+    struct ta_arena_dtor *next;
+    void *ptr;
+    void (*destructor)(void *);
+};
+
+// The user data of an arena allocation.
+struct ta_arena {
+    // Shared extended header of all allocations from this arena. Their parent
+    // and children are not tracked; they all live until the arena is reset.
+    struct ta_ext_header members;
+    struct ta_arena_block *blocks;  // current block first
+    char *pos;                      // free space in blocks
+    size_t left;
+    struct ta_header *last;         // most recent allocation (for realloc)
+    struct ta_arena_dtor *dtors;    // destructors of members, newest first
+};
+
 static void ta_dbg_add(struct ta_header *h);
+static void ta_dbg_add_arena(struct ta_header *h);
 static void ta_dbg_check_header(struct ta_header *h);
 static void ta_dbg_remove(struct ta_header *h);
+static void ta_dbg_clear_arena(void *ptr, size_t size);
 
 static struct ta_header *get_header(void *ptr)
 {
@@ -80,6 +113,20 @@ static struct ta_header *get_header(void *ptr)
     return h;
 }
 
+// Return the arena ptr was allocated from, or NULL.
+static struct ta_arena *get_member_arena(struct ta_header *h)
+{
+    struct ta_ext_header *eh = h ? h->ext : NULL;
+    return eh && eh->arena && eh == &eh->arena->members ? eh->arena : NULL;
+}
+
+// Return the arena new children of ptr are allocated from, or NULL.
+static struct ta_arena *get_arena(void *ptr)
+{
+    struct ta_header *h = get_header(ptr);
+    return h && h->ext ? h->ext->arena : NULL;
+}
+
 static struct ta_ext_header *get_or_alloc_ext_header(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
@@ -117,6 +164,17 @@ bool ta_set_parent(void *ptr, void *ta_parent)
     struct ta_header *ch = get_header(ptr);
     if (!ch)
         return true;
+    struct ta_arena *arena = get_arena(ta_parent);
+    struct ta_arena *ch_arena = get_member_arena(ch);
+    if (ch_arena) {
+        // Arena memory can't be moved out of the arena.
+        assert(arena == ch_arena);
+        return arena == ch_arena;
+    }
+    // Other allocations can be added to arenas, but they're always attached to
+    // the arena itself, and freed when it's reset.
+    if (arena)
+        ta_parent = arena;
     struct ta_ext_header *parent_eh = get_or_alloc_ext_header(ta_parent);
     if (ta_parent && !parent_eh) // do nothing on OOM
         return false;
@@ -137,6 +195,138 @@ bool ta_set_parent(void *ptr, void *ta_parent)
     return true;
 }
 
+static size_t arena_alloc_size(size_t size)
+{
+    return sizeof(union aligned_header) + ((size + MIN_ALIGN - 1) & ~(MIN_ALIGN - 1));
+}
+
+static void *arena_alloc(struct ta_arena *arena, size_t size)
+{
+    size_t total = arena_alloc_size(size);
+    if (total < size || total >= MAX_ALLOC)
+        return NULL;
+    struct ta_header *h;
+    if (total > arena->left) {
+        bool dedicated = total > ARENA_BLOCK_SIZE / 4;
+        size_t block_size = dedicated ? total : ARENA_BLOCK_SIZE;
+        struct ta_arena_block *block =
+            malloc(sizeof(struct ta_arena_block) + block_size);
+        if (!block)
+            return NULL;
+        block->size = block_size;
+        if (dedicated && arena->blocks) {
+            // Keep allocating small things from the current block.
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+            h = (void *)block->data;
+            goto done;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->pos = (char *)block->data;
+        arena->left = block_size;
+    }
+    h = (void *)arena->pos;
+    arena->pos += total;
+    arena->left -= total;
+    arena->last = h;
+done:
+    *h = (struct ta_header) {.size = size, .ext = &arena->members};
+    ta_dbg_add_arena(h);
+    return PTR_FROM_HEADER(h);
+}
+
+static void *arena_realloc(struct ta_arena *arena, void *ptr, size_t size)
+{
+    struct ta_header *h = get_header(ptr);
+    if (h == arena->last) {
+        // Most recent allocation: resize in place if possible.
+        size_t old_total = arena_alloc_size(h->size);
+        size_t new_total = arena_alloc_size(size);
+        if (new_total >= size && new_total <= old_total + arena->left) {
+            arena->left = old_total + arena->left - new_total;
+            arena->pos = (char *)h + new_total;
+            h->size = size;
+            return ptr;
+        }
+    } else if (size <= h->size) {
+        h->size = size;
+        return ptr;
+    }
+    void *new = arena_alloc(arena, size);
+    if (!new)
+        return NULL;
+    memcpy(new, ptr, h->size < size ? h->size : size);
+    return new;
+}
+
+static void arena_run_destructors(struct ta_arena *arena)
+{
+    while (arena->dtors) {
+        struct ta_arena_dtor *dtor = arena->dtors;
+        arena->dtors = dtor->next;
+        dtor->destructor(dtor->ptr);
+    }
+}
+
+// Free all arena memory, except the current block, which is reused.
+static void arena_reset(struct ta_arena *arena)
+{
+    struct ta_arena_block *block = arena->blocks;
+    if (block) {
+        while (block->next) {
+            struct ta_arena_block *next = block->next;
+            block->next = next->next;
+            free(next);
+        }
+        ta_dbg_clear_arena(block->data, block->size - arena->left);
+        arena->pos = (char *)block->data;
+        arena->left = block->size;
+    }
+    arena->last = NULL;
+}
+
+/* Create an empty allocation (like ta_new_context()), which acts as arena for
+ * all allocations that have it (or any allocation made from it) as parent.
+ * Allocating from an arena is cheap, and all allocations are released at once
+ * when the arena is reset with ta_free_children(), or freed with ta_free().
+ *
+ * Allocations from an arena behave like normal allocations, except:
+ * - ta_free() and ta_free_children() on them do nothing. Their memory is only
+ *   released with the arena.
+ * - Destructors run when the arena is reset or freed (newest first), not when
+ *   ta_free() is called on the allocation.
+ * - They can't be moved out of the arena with ta_set_parent().
+ * - Non-arena allocations moved into the arena with ta_set_parent() are
+ *   attached to the arena itself, and freed when it is reset or freed.
+ * - ta_find_parent() returns the arena.
+ * This makes arenas suitable for temporary data that is created and discarded
+ * as a whole, e.g. per command or event.
+ *
+ * Returns NULL on OOM.
+ */
+void *ta_new_arena(void *ta_parent)
+{
+    // (Not allocated from ta_parent directly, in case it's an arena itself.)
+    struct ta_arena *arena = ta_zalloc_size(NULL, sizeof(*arena));
+    struct ta_ext_header *eh = get_or_alloc_ext_header(arena);
+    if (!eh || !ta_set_parent(arena, ta_parent)) {
+        ta_free(arena);
+        return NULL;
+    }
+    eh->arena = arena;
+    arena->members = (struct ta_ext_header) {
+        .children = {
+            .next = &arena->members.children,
+            .prev = &arena->members.children,
+            .size = CHILDREN_SENTINEL,
+            .ext = &arena->members,
+        },
+        .arena = arena,
+    };
+    return arena;
+}
+
 /* Allocate size bytes of memory. If ta_parent is not NULL, this is used as
  * parent allocation (if ta_parent is freed, this allocation is automatically
  * freed as well). size==0 allocates a block of size 0 (i.e. returns non-NULL).
@@ -146,6 +336,9 @@ void *ta_alloc_size(void *ta_parent, size_t size)
 {
     if (size >= MAX_ALLOC)
         return NULL;
+    struct ta_arena *arena = get_arena(ta_parent);
+    if (arena)
+        return arena_alloc(arena, size);
     struct ta_header *h = malloc(sizeof(union aligned_header) + size);
     if (!h)
         return NULL;
@@ -166,6 +359,13 @@ void *ta_zalloc_size(void *ta_parent, size_t size)
 {
     if (size >= MAX_ALLOC)
         return NULL;
+    struct ta_arena *arena = get_arena(ta_parent);
+    if (arena) {
+        void *ptr = arena_alloc(arena, size);
+        if (ptr)
+            memset(ptr, 0, size);
+        return ptr;
+    }
     struct ta_header *h = calloc(1, sizeof(union aligned_header) + size);
     if (!h)
         return NULL;
@@ -202,6 +402,9 @@ void *ta_realloc_size(void *ta_parent, void *ptr, size_t size)
     if (!ptr)
         return ta_alloc_size(ta_parent, size);
     struct ta_header *h = get_header(ptr);
+    struct ta_arena *arena = get_member_arena(h);
+    if (arena)
+        return arena_realloc(arena, ptr, size);
     struct ta_header *old_h = h;
     if (h->size == size)
         return ptr;
@@ -238,7 +441,7 @@ size_t ta_get_size(void *ptr)
 }
 
 /* Free all allocations that (recursively) have ptr as parent allocation, but
- * do not free ptr itself.
+ * do not free ptr itself. If ptr is an arena, this resets it.
  */
 void ta_free_children(void *ptr)
 {
@@ -246,8 +449,16 @@ void ta_free_children(void *ptr)
     struct ta_ext_header *eh = h ? h->ext : NULL;
     if (!eh)
         return;
+    struct ta_arena *arena = eh->arena;
+    if (arena) {
+        if (eh == &arena->members)
+            return;
+        arena_run_destructors(arena);
+    }
     while (eh->children.next != &eh->children)
         ta_free(PTR_FROM_HEADER(eh->children.next));
+    if (arena)
+        arena_reset(arena);
 }
 
 /* Free the given allocation, and all of its direct and indirect children.
@@ -255,11 +466,19 @@ void ta_free_children(void *ptr)
 void ta_free(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
-    if (!h)
+    if (!h || get_member_arena(h))
         return;
     if (h->ext && h->ext->destructor)
         h->ext->destructor(ptr);
     ta_free_children(ptr);
+    if (h->ext && h->ext->arena) {
+        struct ta_arena *arena = h->ext->arena;
+        while (arena->blocks) {
+            struct ta_arena_block *next = arena->blocks->next;
+            free(arena->blocks);
+            arena->blocks = next;
+        }
+    }
     if (h->next) {
         // Unlink from sibling list
         h->next->prev = h->prev;
@@ -284,6 +503,21 @@ void ta_free(void *ptr)
  */
 bool ta_set_destructor(void *ptr, void (*destructor)(void *))
 {
+    struct ta_arena *arena = get_member_arena(get_header(ptr));
+    if (arena) {
+        for (struct ta_arena_dtor *d = arena->dtors; d; d = d->next) {
+            if (d->ptr == ptr) {
+                d->destructor = destructor;
+                return true;
+            }
+        }
+        struct ta_arena_dtor *d = arena_alloc(arena, sizeof(*d));
+        if (!d)
+            return false;
+        *d = (struct ta_arena_dtor){arena->dtors, ptr, destructor};
+        arena->dtors = d;
+        return true;
+    }
     struct ta_ext_header *eh = get_or_alloc_ext_header(ptr);
     if (!eh)
         return false;
@@ -298,6 +532,9 @@ bool ta_set_destructor(void *ptr, void (*destructor)(void *))
 void *ta_find_parent(void *ptr)
 {
     struct ta_header *h = get_header(ptr);
+    struct ta_arena *arena = get_member_arena(h);
+    if (arena)
+        return arena;
     if (!h || !h->next)
         return NULL;
     for (struct ta_header *cur = h->next; cur != h; cur = cur->next) {
@@ -329,12 +566,23 @@ static void ta_dbg_add(struct ta_header *h)
     }
 }
 
+static void ta_dbg_add_arena(struct ta_header *h)
+{
+    h->canary = CANARY;
+}
+
 static void ta_dbg_check_header(struct ta_header *h)
 {
     if (h)
         assert(h->canary == CANARY);
 }
 
+// Make use of arena memory after reset more likely to crash.
+static void ta_dbg_clear_arena(void *ptr, size_t size)
+{
+    memset(ptr, 0xCD, size);
+}
+
 static void ta_dbg_remove(struct ta_header *h)
 {
     ta_dbg_check_header(h);
@@ -436,8 +684,10 @@ void *ta_dbg_mark_as_string(void *ptr)
 #else
 
 static void ta_dbg_add(struct ta_header *h){}
+static void ta_dbg_add_arena(struct ta_header *h){}
 static void ta_dbg_check_header(struct ta_header *h){}
 static void ta_dbg_remove(struct ta_header *h){}
+static void ta_dbg_clear_arena(void *ptr, size_t size){}
 
 void ta_enable_leak_report(void){}
 void *ta_dbg_set_loc(void *ptr, const char *loc){return ptr;}
@@ -136,12 +136,14 @@ char *ta_strndup(void *ta_parent, const char *str, size_t n)
 {
     if (!str)
         return NULL;
-    char *new = NULL;
-    strndup_append_at(&new, 0, str, n);
-    if (!ta_set_parent(new, ta_parent)) {
-        ta_free(new);
-        new = NULL;
-    }
+    // (Allocate from ta_parent directly, so this works with arenas.)
+    size_t len = strnlen(str, n);
+    char *new = ta_alloc_size(ta_parent, len + 1);
+    if (!new)
+        return NULL;
+    memcpy(new, str, len);
+    new[len] = '\0';
+    ta_dbg_mark_as_string(new);
     return new;
 }
 
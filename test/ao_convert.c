@@ -0,0 +1,118 @@
+#include <string.h>
+
+#include "test_helpers.h"
+#include "audio/format.h"
+#include "audio/out/internal.h"
+#include "common/common.h"
+#include "osdep/endian.h"
+
+#if BYTE_ORDER == BIG_ENDIAN
+#define SHIFT24(x) ((3-(x))*8)
+#else
+#define SHIFT24(x) (((x)+1)*8)
+#endif
+
+// Per-sample conversion as ao_convert_inplace() originally implemented it.
+static void reference_convert(struct ao_convert_fmt *fmt, uint8_t *dst,
+                              const uint8_t *src, int num_samples)
+{
+    int src_bytes = af_fmt_to_bytes(fmt->src_fmt);
+    if (src_bytes * 8 == fmt->dst_bits && !fmt->pad_msb) {
+        memcpy(dst, src, num_samples * src_bytes);
+        return;
+    }
+    int bytes = fmt->dst_bits / 8;
+    for (int s = 0; s < num_samples; s++) {
+        uint32_t val;
+        memcpy(&val, src + s * 4, 4);
+        uint8_t *ptr = dst + s * bytes;
+        ptr[0] = val >> SHIFT24(0);
+        ptr[1] = val >> SHIFT24(1);
+        ptr[2] = val >> SHIFT24(2);
+        if (bytes == 4)
+            ptr[3] = 0;
+    }
+}
+
+// Check all supported conversions for a given format, with all sample counts
+// up to a size that covers both the vectorized part and the remainder, in
+// place and out of place.
+static void check_format(int src_fmt, int channels, int dst_bits, int pad_msb)
+{
+    struct ao_convert_fmt fmt = {
+        .src_fmt = src_fmt,
+        .channels = channels,
+        .dst_bits = dst_bits,
+        .pad_msb = pad_msb,
+    };
+    if (!ao_can_convert_inplace(&fmt))
+        return;
+
+    bool planar = af_fmt_is_planar(src_fmt);
+    int planes = planar ? channels : 1;
+    int src_bytes = af_fmt_to_bytes(src_fmt);
+
+    for (int samples = 0; samples < 35; samples++) {
+        int plane_samples = samples * (planar ? 1 : channels);
+        int plane_size = plane_samples * src_bytes;
+        static uint8_t src[MP_NUM_CHANNELS][35 * MP_NUM_CHANNELS * 8];
+        static uint8_t inplace[MP_NUM_CHANNELS][35 * MP_NUM_CHANNELS * 8];
+        static uint8_t outofplace[MP_NUM_CHANNELS][35 * MP_NUM_CHANNELS * 8];
+        static uint8_t expect[MP_NUM_CHANNELS][35 * MP_NUM_CHANNELS * 8];
+        void *src_p[MP_NUM_CHANNELS], *inplace_p[MP_NUM_CHANNELS],
+             *outofplace_p[MP_NUM_CHANNELS];
+        for (int p = 0; p < planes; p++) {
+            for (int i = 0; i < plane_size; i++)
+                src[p][i] = (i * 37 + p * 11 + samples) & 0xFF;
+            memcpy(inplace[p], src[p], plane_size);
+            reference_convert(&fmt, expect[p], src[p], plane_samples);
+            src_p[p] = src[p];
+            inplace_p[p] = inplace[p];
+            outofplace_p[p] = outofplace[p];
+        }
+
+        ao_convert_inplace(&fmt, inplace_p, samples);
+        ao_convert(&fmt, outofplace_p, src_p, samples);
+
+        int dst_size = plane_samples * dst_bits / 8;
+        for (int p = 0; p < planes; p++) {
+            assert_memory_equal(inplace[p], expect[p], dst_size);
+            assert_memory_equal(outofplace[p], expect[p], dst_size);
+        }
+    }
+}
+
+static void test_convert_matrix(void **state) {
+    static const int dst_bits[] = {8, 16, 24, 32, 64};
+    for (int f = 1; f < AF_FORMAT_COUNT; f++) {
+        if (af_fmt_is_spdif(f))
+            continue;
+        for (int c = 1; c <= MP_NUM_CHANNELS; c++) {
+            for (int b = 0; b < MP_ARRAY_SIZE(dst_bits); b++) {
+                check_format(f, c, dst_bits[b], 0);
+                check_format(f, c, dst_bits[b], 8);
+            }
+        }
+    }
+}
+
+static void test_supported(void **state) {
+    struct ao_convert_fmt fmt = {AF_FORMAT_S32, 2, 24, 0};
+    assert_true(ao_can_convert_inplace(&fmt));
+    assert_true(ao_need_conversion(&fmt));
+    fmt = (struct ao_convert_fmt){AF_FORMAT_S32, 2, 32, 8};
+    assert_true(ao_can_convert_inplace(&fmt));
+    fmt = (struct ao_convert_fmt){AF_FORMAT_FLOAT, 2, 32, 0};
+    assert_true(ao_can_convert_inplace(&fmt));
+    assert_false(ao_need_conversion(&fmt));
+    fmt = (struct ao_convert_fmt){AF_FORMAT_FLOAT, 2, 16, 0};
+    assert_false(ao_can_convert_inplace(&fmt));
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_supported),
+        cmocka_unit_test(test_convert_matrix),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
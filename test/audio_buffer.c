@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "audio/audio_buffer.h"
+#include "audio/chmap.h"
+#include "audio/format.h"
+
+// Reads all data through mp_audio_buffer_peek()/mp_audio_buffer_skip(), and
+// compares it to the expected S16 interleaved stereo data.
+static void check_contents(struct mp_audio_buffer *ab, int16_t *expect,
+                           int num)
+{
+    assert_int_equal(mp_audio_buffer_samples(ab), num);
+    int pos = 0;
+    while (mp_audio_buffer_samples(ab)) {
+        uint8_t **planes;
+        int samples;
+        mp_audio_buffer_peek(ab, &planes, &samples);
+        assert_true(samples > 0);
+        assert_memory_equal(planes[0], expect + pos * 2, samples * 4);
+        mp_audio_buffer_skip(ab, samples);
+        pos += samples;
+    }
+    assert_int_equal(pos, num);
+}
+
+// Run random operations on the ring buffer, and mirror them on a plain array.
+static void test_random_ops(void **state) {
+    struct mp_audio_buffer *ab = mp_audio_buffer_create(NULL);
+    mp_audio_buffer_reinit_fmt(ab, AF_FORMAT_S16,
+                               &(struct mp_chmap)MP_CHMAP_INIT_STEREO, 48000);
+    mp_audio_buffer_preallocate_min(ab, 100);
+
+    int16_t model[4000 * 2];
+    int num = 0;
+    int16_t counter = 0;
+
+    for (int iter = 0; iter < 20000; iter++) {
+        int op = rand() % 6;
+        int n = rand() % 50;
+        if (op == 0 || op == 1) {
+            if (num + n > 4000)
+                continue;
+            int16_t in[50 * 2];
+            for (int i = 0; i < n * 2; i++)
+                in[i] = counter++;
+            mp_audio_buffer_append(ab, (void *[]){in}, n);
+            memcpy(model + num * 2, in, n * 4);
+            num += n;
+        } else if (op == 2) {
+            n = MPMIN(n, num);
+            mp_audio_buffer_skip(ab, n);
+            memmove(model, model + n * 2, (num - n) * 4);
+            num -= n;
+        } else if (op == 3) {
+            if (num + n > 4000)
+                continue;
+            mp_audio_buffer_prepend_silence(ab, n);
+            memmove(model + n * 2, model, num * 4);
+            memset(model, 0, n * 4);
+            num += n;
+        } else if (op == 4) {
+            n = MPMIN(n, num);
+            if (num + n > 4000)
+                continue;
+            mp_audio_buffer_duplicate(ab, n);
+            memcpy(model + num * 2, model + (num - n) * 2, n * 4);
+            num += n;
+        } else {
+            mp_audio_buffer_linearize(ab);
+            uint8_t **planes;
+            int samples;
+            mp_audio_buffer_peek(ab, &planes, &samples);
+            assert_int_equal(samples, num);
+            assert_memory_equal(planes[0], model, num * 4);
+        }
+        assert_int_equal(mp_audio_buffer_samples(ab), num);
+    }
+
+    check_contents(ab, model, num);
+    talloc_free(ab);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_random_ops),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,78 @@
+#include "bench.h"
+#include "audio/format.h"
+#include "audio/out/internal.h"
+#include "common/common.h"
+
+// Sample conversion done by AOs on the audio thread (e.g. ao_alsa with 24 bit
+// devices), 10 ms at 48 kHz per iteration.
+#define SAMPLES 480
+
+struct convert_ctx {
+    struct ao_convert_fmt fmt;
+    bool inplace;
+    void *src[MP_NUM_CHANNELS];
+    void *dst[MP_NUM_CHANNELS];
+};
+
+static void run_convert(void *p)
+{
+    struct convert_ctx *ctx = p;
+    if (ctx->inplace) {
+        ao_convert_inplace(&ctx->fmt, ctx->dst, SAMPLES);
+    } else {
+        ao_convert(&ctx->fmt, ctx->dst, ctx->src, SAMPLES);
+    }
+}
+
+static void bench_convert(int src_fmt, int channels, int dst_bits, int pad_msb)
+{
+    struct convert_ctx ctx = {
+        .fmt = {
+            .src_fmt = src_fmt,
+            .channels = channels,
+            .dst_bits = dst_bits,
+            .pad_msb = pad_msb,
+        },
+    };
+    bool planar = af_fmt_is_planar(src_fmt);
+    int planes = planar ? channels : 1;
+    int plane_size = SAMPLES * (planar ? 1 : channels) * af_fmt_to_bytes(src_fmt);
+
+    void *tmp = talloc_new(NULL);
+    for (int n = 0; n < planes; n++) {
+        uint8_t *src = talloc_size(tmp, plane_size);
+        for (int i = 0; i < plane_size; i++)
+            src[i] = i * 37;
+        ctx.src[n] = src;
+        ctx.dst[n] = talloc_size(tmp, plane_size);
+    }
+
+    for (int inplace = 0; inplace < 2; inplace++) {
+        char name[80];
+        snprintf(name, sizeof(name), "ao_convert %s %dch -> %d bits%s%s",
+                 af_fmt_to_str(src_fmt), channels, dst_bits,
+                 pad_msb ? " (pad msb)" : "", inplace ? " inplace" : "");
+        ctx.inplace = inplace;
+        // The in-place run converts the same buffer over and over, which is
+        // fine for timing purposes.
+        if (inplace) {
+            for (int n = 0; n < planes; n++)
+                memcpy(ctx.dst[n], ctx.src[n], plane_size);
+        }
+        bench_run(name, run_convert, &ctx, 1000);
+    }
+
+    talloc_free(tmp);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    bench_convert(AF_FORMAT_S32, 2, 24, 0);
+    bench_convert(AF_FORMAT_S32, 8, 24, 0);
+    bench_convert(AF_FORMAT_S32, 2, 32, 8);
+    // Passthrough (memcpy), for comparison.
+    bench_convert(AF_FORMAT_S32, 2, 32, 0);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#ifndef MP_BENCH_H
+#define MP_BENCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/global.h"
+#include "common/msg.h"
+#include "common/msg_control.h"
+#include "options/m_config.h"
+#include "options/options.h"
+#include "osdep/timer.h"
+
+// Command line options common to all benchmark programs:
+//  --json          print one JSON object per benchmark instead of text
+//  --filter=TEXT   run only benchmarks whose name contains TEXT
+//  --rounds=N      number of timed rounds (default: 9)
+//  --min-time=MS   minimum duration of a round in ms (default: 20)
+struct bench_opts {
+    bool json;
+    const char *filter;
+    int rounds;
+    int64_t min_round_us;
+};
+
+static struct bench_opts bench_opts = {
+    .rounds = 9,
+    .min_round_us = 20000,
+};
+
+static inline void bench_init(int argc, char **argv)
+{
+    for (int n = 1; n < argc; n++) {
+        const char *arg = argv[n];
+        if (strcmp(arg, "--json") == 0) {
+            bench_opts.json = true;
+        } else if (strncmp(arg, "--filter=", 9) == 0) {
+            bench_opts.filter = arg + 9;
+        } else if (strncmp(arg, "--rounds=", 9) == 0) {
+            bench_opts.rounds = atoi(arg + 9);
+        } else if (strncmp(arg, "--min-time=", 11) == 0) {
+            bench_opts.min_round_us = atoi(arg + 11) * INT64_C(1000);
+        } else {
+            fprintf(stderr, "Usage: %s [--json] [--filter=TEXT] [--rounds=N] "
+                    "[--min-time=MS]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (bench_opts.rounds < 1)
+        bench_opts.rounds = 1;
+}
+
+// Whether a benchmark with this name should run. Can be used to skip expensive
+// setup; bench_run() checks it too.
+static inline bool bench_enabled(const char *name)
+{
+    return !bench_opts.filter || strstr(name, bench_opts.filter);
+}
+
+static inline uint64_t bench_round(void (*fn)(void *ctx), void *ctx, int iters)
+{
+    uint64_t t = mp_raw_time_us();
+    for (int n = 0; n < iters; n++)
+        fn(ctx);
+    return mp_raw_time_us() - t;
+}
+
+static inline int bench_cmp_u64(const void *a, const void *b)
+{
+    uint64_t va = *(const uint64_t *)a, vb = *(const uint64_t *)b;
+    return va < vb ? -1 : va > vb;
+}
+
+// Run fn(ctx) at least iters times per round, and report the fastest round
+// (which is the least disturbed by other system activity) and the median. A
+// warmup round is run first; if it was shorter than --min-time, iters is
+// raised, so that timer resolution and per-round noise don't dominate.
+static inline void bench_run(const char *name, void (*fn)(void *ctx),
+                             void *ctx, int iters)
+{
+    if (!bench_enabled(name))
+        return;
+
+    iters = iters > 0 ? iters : 1;
+    uint64_t t = bench_round(fn, ctx, iters);
+    while (t < bench_opts.min_round_us && iters < (1 << 28)) {
+        int64_t want = t ? bench_opts.min_round_us * iters / t : iters * 10LL;
+        want = want + want / 8 + 1;
+        if (want > iters * 10LL)
+            want = iters * 10LL;
+        iters = want < (1 << 28) ? want : (1 << 28);
+        t = bench_round(fn, ctx, iters);
+    }
+
+    uint64_t times[256];
+    int rounds = bench_opts.rounds < 256 ? bench_opts.rounds : 256;
+    for (int r = 0; r < rounds; r++)
+        times[r] = bench_round(fn, ctx, iters);
+    qsort(times, rounds, sizeof(times[0]), bench_cmp_u64);
+    double best = times[0] / (double)iters;
+    double median = times[rounds / 2] / (double)iters;
+
+    if (bench_opts.json) {
+        printf("{\"name\":\"");
+        for (const char *s = name; *s; s++) {
+            if (*s == '"' || *s == '\\')
+                putchar('\\');
+            putchar(*s);
+        }
+        printf("\",\"iters\":%d,\"rounds\":%d,\"min_us\":%.6f,"
+               "\"median_us\":%.6f}\n", iters, rounds, best, median);
+    } else {
+        printf("%-48s %12.3f us/iter (median %.3f)\n", name, best, median);
+    }
+    fflush(stdout);
+}
+
+// Create a mpv_global with logging and the player's option tree with default
+// values, for benchmarking code which reads options. Free with
+// bench_destroy_config().
+static inline struct m_config *bench_create_config(void)
+{
+    struct mpv_global *global = talloc_zero(NULL, struct mpv_global);
+    mp_msg_init(global);
+    struct mp_log *log = mp_log_new(global, global->log, "bench");
+    struct m_config *config = m_config_new(global, log, sizeof(struct MPOpts),
+                                           &mp_default_opts, mp_opts);
+    config->global = global;
+    m_config_create_shadow(config);
+    global->opts = config->optstruct;
+    return config;
+}
+
+static inline void bench_destroy_config(struct m_config *config)
+{
+    struct mpv_global *global = config->global;
+    talloc_free(config);
+    mp_msg_uninit(global);
+    talloc_free(global);
+}
+
+#endif
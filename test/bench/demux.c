@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "common/common.h"
+#include "demux/demux.h"
+#include "demux/packet.h"
+#include "misc/bstr.h"
+
+// Packet reading through the demuxer packet cache, from a generated Matroska
+// file with a VP9 video track (25 fps, keyframe every second) and an AC3 audio
+// track (32 ms frames). Packet contents are garbage; no decoding happens.
+
+#define DURATION 60
+#define MAX_BLOCK 30000
+
+// Matroska element IDs (see TOOLS/matroska.py).
+#define ID_EBML                 0x1A45DFA3
+#define ID_EBMLVERSION          0x4286
+#define ID_EBMLREADVERSION      0x42F7
+#define ID_EBMLMAXIDLENGTH      0x42F2
+#define ID_EBMLMAXSIZELENGTH    0x42F3
+#define ID_DOCTYPE              0x4282
+#define ID_DOCTYPEVERSION       0x4287
+#define ID_DOCTYPEREADVERSION   0x4285
+#define ID_SEGMENT              0x18538067
+#define ID_INFO                 0x1549A966
+#define ID_TIMECODESCALE        0x2AD7B1
+#define ID_TRACKS               0x1654AE6B
+#define ID_TRACKENTRY           0xAE
+#define ID_TRACKNUMBER          0xD7
+#define ID_TRACKUID             0x73C5
+#define ID_TRACKTYPE            0x83
+#define ID_CODECID              0x86
+#define ID_VIDEO                0xE0
+#define ID_PIXELWIDTH           0xB0
+#define ID_PIXELHEIGHT          0xBA
+#define ID_AUDIO                0xE1
+#define ID_CHANNELS             0x9F
+#define ID_SAMPLINGFREQUENCY    0xB5
+#define ID_CLUSTER              0x1F43B675
+#define ID_TIMECODE             0xE7
+#define ID_SIMPLEBLOCK          0xA3
+
+static void put_be(bstr *b, uint64_t v, int bytes)
+{
+    for (int n = bytes - 1; n >= 0; n--) {
+        uint8_t c = v >> (n * 8);
+        bstr_xappend(NULL, b, (bstr){&c, 1});
+    }
+}
+
+static void put_id(bstr *b, uint32_t id)
+{
+    put_be(b, id, id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1);
+}
+
+// Always use 8 byte sizes, so they can be patched in later.
+static void put_size(bstr *b, uint64_t size)
+{
+    put_be(b, (1ULL << 56) | size, 8);
+}
+
+static size_t start_element(bstr *b, uint32_t id)
+{
+    put_id(b, id);
+    put_size(b, 0);
+    return b->len;
+}
+
+static void end_element(bstr *b, size_t start)
+{
+    bstr size = {0};
+    put_size(&size, b->len - start);
+    memcpy(b->start + start - 8, size.start, 8);
+    talloc_free(size.start);
+}
+
+static void put_uint(bstr *b, uint32_t id, uint64_t v)
+{
+    put_id(b, id);
+    put_size(b, 8);
+    put_be(b, v, 8);
+}
+
+static void put_float(bstr *b, uint32_t id, double v)
+{
+    union { double d; uint64_t i; } u = {.d = v};
+    put_uint(b, id, u.i);
+}
+
+static void put_string(bstr *b, uint32_t id, const char *s)
+{
+    put_id(b, id);
+    put_size(b, strlen(s));
+    bstr_xappend(NULL, b, bstr0(s));
+}
+
+static void put_block(bstr *b, int track, int rel_ms, bool keyframe, int size)
+{
+    put_id(b, ID_SIMPLEBLOCK);
+    put_size(b, 4 + size);
+    put_be(b, 0x80 | track, 1);
+    put_be(b, (uint16_t)rel_ms, 2);
+    put_be(b, keyframe ? 0x80 : 0, 1);
+    static uint8_t data[MAX_BLOCK];
+    for (int n = 0; n < size; n++)
+        data[n] = n * 13 + rel_ms;
+    bstr_xappend(NULL, b, (bstr){data, size});
+}
+
+static bstr make_mkv(int *num_packets)
+{
+    bstr b = {0};
+    size_t pos = start_element(&b, ID_EBML);
+    put_uint(&b, ID_EBMLVERSION, 1);
+    put_uint(&b, ID_EBMLREADVERSION, 1);
+    put_uint(&b, ID_EBMLMAXIDLENGTH, 4);
+    put_uint(&b, ID_EBMLMAXSIZELENGTH, 8);
+    put_string(&b, ID_DOCTYPE, "matroska");
+    put_uint(&b, ID_DOCTYPEVERSION, 4);
+    put_uint(&b, ID_DOCTYPEREADVERSION, 2);
+    end_element(&b, pos);
+
+    size_t segment = start_element(&b, ID_SEGMENT);
+
+    pos = start_element(&b, ID_INFO);
+    put_uint(&b, ID_TIMECODESCALE, 1000000);
+    end_element(&b, pos);
+
+    size_t tracks = start_element(&b, ID_TRACKS);
+    pos = start_element(&b, ID_TRACKENTRY);
+    put_uint(&b, ID_TRACKNUMBER, 1);
+    put_uint(&b, ID_TRACKUID, 1);
+    put_uint(&b, ID_TRACKTYPE, 1);
+    put_string(&b, ID_CODECID, "V_VP9");
+    size_t sub = start_element(&b, ID_VIDEO);
+    put_uint(&b, ID_PIXELWIDTH, 1920);
+    put_uint(&b, ID_PIXELHEIGHT, 1080);
+    end_element(&b, sub);
+    end_element(&b, pos);
+    pos = start_element(&b, ID_TRACKENTRY);
+    put_uint(&b, ID_TRACKNUMBER, 2);
+    put_uint(&b, ID_TRACKUID, 2);
+    put_uint(&b, ID_TRACKTYPE, 2);
+    put_string(&b, ID_CODECID, "A_AC3");
+    sub = start_element(&b, ID_AUDIO);
+    put_uint(&b, ID_CHANNELS, 2);
+    put_float(&b, ID_SAMPLINGFREQUENCY, 48000);
+    end_element(&b, sub);
+    end_element(&b, pos);
+    end_element(&b, tracks);
+
+    // One cluster per second.
+    *num_packets = 0;
+    int audio_ms = 0;
+    for (int sec = 0; sec < DURATION; sec++) {
+        pos = start_element(&b, ID_CLUSTER);
+        put_uint(&b, ID_TIMECODE, sec * 1000);
+        for (int frame = 0; frame < 25; frame++) {
+            int video_ms = frame * 40;
+            while (audio_ms < sec * 1000 + video_ms + 40) {
+                put_block(&b, 2, audio_ms - sec * 1000, true, 768);
+                audio_ms += 32;
+                *num_packets += 1;
+            }
+            put_block(&b, 1, video_ms, frame == 0,
+                      frame == 0 ? MAX_BLOCK : 5000);
+            *num_packets += 1;
+        }
+        end_element(&b, pos);
+    }
+
+    end_element(&b, segment);
+    return b;
+}
+
+struct demux_ctx {
+    struct m_config *config;
+    char *filename;
+    int num_packets;
+    struct demuxer *demuxer;
+};
+
+static void set_option(struct demux_ctx *ctx, const char *name, const char *val)
+{
+    if (m_config_set_option_cli(ctx->config, bstr0(name), bstr0(val), 0) < 0)
+        abort();
+}
+
+static struct demuxer *open_file(struct demux_ctx *ctx)
+{
+    struct demuxer_params params = {
+        .force_format = "mkv",
+        .disable_cache = true,
+    };
+    struct demuxer *demuxer =
+        demux_open_url(ctx->filename, &params, NULL, ctx->config->global);
+    if (!demuxer)
+        abort();
+    for (int n = 0; n < demux_get_num_stream(demuxer); n++) {
+        struct sh_stream *sh = demux_get_stream(demuxer, n);
+        demuxer_select_track(demuxer, sh, MP_NOPTS_VALUE, true);
+    }
+    return demuxer;
+}
+
+static int read_all(struct demuxer *demuxer)
+{
+    int num = 0;
+    struct demux_packet *pkt;
+    while ((pkt = demux_read_any_packet(demuxer))) {
+        talloc_free(pkt);
+        num++;
+    }
+    return num;
+}
+
+static void run_read(void *p)
+{
+    struct demux_ctx *ctx = p;
+    struct demuxer *demuxer = open_file(ctx);
+    if (read_all(demuxer) != ctx->num_packets)
+        abort();
+    free_demuxer_and_stream(demuxer);
+}
+
+static void run_seek(void *p)
+{
+    struct demux_ctx *ctx = p;
+    // (Stay away from the end, which may not be fully covered by all streams.)
+    double pts = rand() % ((DURATION - 1) * 1000) / 1000.0;
+    if (!demux_seek(ctx->demuxer, pts, SEEK_CACHED))
+        abort();
+    talloc_free(demux_read_any_packet(ctx->demuxer));
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    struct demux_ctx ctx = {
+        .config = bench_create_config(),
+    };
+
+    const char *tmpdir = getenv("TMPDIR");
+    ctx.filename = talloc_asprintf(NULL, "%s/mpv-bench-XXXXXX.mkv",
+                                   tmpdir ? tmpdir : "/tmp");
+    int fd = mkstemps(ctx.filename, 4);
+    if (fd < 0)
+        abort();
+    bstr data = make_mkv(&ctx.num_packets);
+    bool ok = write(fd, data.start, data.len) == data.len;
+    close(fd);
+    talloc_free(data.start);
+    if (!ok)
+        goto done;
+
+    set_option(&ctx, "demuxer-seekable-cache", "no");
+    bench_run("demux mkv read (no cache)", run_read, &ctx, 1);
+
+    // Keep everything: every packet is appended to the seek index.
+    set_option(&ctx, "demuxer-seekable-cache", "yes");
+    set_option(&ctx, "demuxer-max-back-bytes", "1GiB");
+    bench_run("demux mkv read (cache append)", run_read, &ctx, 1);
+
+    // Small backbuffer: old packets are pruned while reading.
+    set_option(&ctx, "demuxer-max-back-bytes", "1MiB");
+    bench_run("demux mkv read (cache append+prune)", run_read, &ctx, 1);
+
+    set_option(&ctx, "demuxer-max-back-bytes", "1GiB");
+    if (bench_enabled("demux cache seek")) {
+        ctx.demuxer = open_file(&ctx);
+        read_all(ctx.demuxer);
+        bench_run("demux cache seek", run_seek, &ctx, 1000);
+        free_demuxer_and_stream(ctx.demuxer);
+    }
+
+done:
+    unlink(ctx.filename);
+    talloc_free(ctx.filename);
+    bench_destroy_config(ctx.config);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include <pthread.h>
+
+#include "bench.h"
+#include "common/common.h"
+#include "misc/dispatch.h"
+
+// Dispatch queue throughput with many threads queuing items at once, like
+// client API and IPC threads sending requests to the core thread. The main
+// thread is the target thread. Each iteration, every producer queues ITEMS
+// asynchronous items, and the target thread runs all of them.
+#define ITEMS 1000
+
+struct dispatch_ctx {
+    struct mp_dispatch_queue *queue;
+    int num_producers;
+    int processed;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    int64_t generation;
+    bool quit;
+};
+
+static void count_item(void *p)
+{
+    struct dispatch_ctx *ctx = p;
+    ctx->processed += 1;
+}
+
+static void *producer_thread(void *p)
+{
+    struct dispatch_ctx *ctx = p;
+    int64_t generation = 0;
+    while (1) {
+        pthread_mutex_lock(&ctx->lock);
+        while (ctx->generation == generation && !ctx->quit)
+            pthread_cond_wait(&ctx->wakeup, &ctx->lock);
+        generation = ctx->generation;
+        bool quit = ctx->quit;
+        pthread_mutex_unlock(&ctx->lock);
+        if (quit)
+            break;
+        for (int n = 0; n < ITEMS; n++)
+            mp_dispatch_enqueue(ctx->queue, count_item, ctx);
+    }
+    return NULL;
+}
+
+static void run_dispatch(void *p)
+{
+    struct dispatch_ctx *ctx = p;
+    ctx->processed = 0;
+    pthread_mutex_lock(&ctx->lock);
+    ctx->generation += 1;
+    pthread_cond_broadcast(&ctx->wakeup);
+    pthread_mutex_unlock(&ctx->lock);
+    while (ctx->processed < ctx->num_producers * ITEMS)
+        mp_dispatch_queue_process(ctx->queue, 1.0);
+}
+
+static void bench_dispatch(int num_producers)
+{
+    char name[80];
+    snprintf(name, sizeof(name), "dispatch %d producers x %d items",
+             num_producers, ITEMS);
+    if (!bench_enabled(name))
+        return;
+
+    struct dispatch_ctx ctx = {
+        .queue = mp_dispatch_create(NULL),
+        .num_producers = num_producers,
+    };
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.wakeup, NULL);
+
+    pthread_t threads[64];
+    for (int n = 0; n < num_producers; n++) {
+        if (pthread_create(&threads[n], NULL, producer_thread, &ctx))
+            abort();
+    }
+
+    bench_run(name, run_dispatch, &ctx, 10);
+
+    pthread_mutex_lock(&ctx.lock);
+    ctx.quit = true;
+    pthread_cond_broadcast(&ctx.wakeup);
+    pthread_mutex_unlock(&ctx.lock);
+    for (int n = 0; n < num_producers; n++)
+        pthread_join(threads[n], NULL);
+
+    talloc_free(ctx.queue);
+    pthread_cond_destroy(&ctx.wakeup);
+    pthread_mutex_destroy(&ctx.lock);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    bench_dispatch(1);
+    bench_dispatch(4);
+    bench_dispatch(16);
+    bench_dispatch(64);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "bench.h"
+#include "common/common.h"
+#include "sub/draw_bmp.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+
+// Subtitle/OSD blending as done for screenshots with subtitles, vf_sub, and
+// VOs without OSD support: 2 lines of libass glyphs, or an RGBA OSD bar.
+
+struct draw_ctx {
+    struct mp_draw_sub_cache *cache;
+    struct mp_image *dst;
+    struct sub_bitmaps sbs;
+    bool change;
+};
+
+static void run_draw(void *p)
+{
+    struct draw_ctx *ctx = p;
+    if (ctx->change)
+        ctx->sbs.change_id += 1;
+    mp_draw_sub_bitmaps(&ctx->cache, ctx->dst, &ctx->sbs);
+}
+
+static void make_libass(void *ta_parent, struct sub_bitmaps *sbs, int w, int h)
+{
+    *sbs = (struct sub_bitmaps){.format = SUBBITMAP_LIBASS, .change_id = 1};
+    int gw = 32, gh = 44;
+    uint8_t *glyph = talloc_size(ta_parent, gw * gh);
+    for (int y = 0; y < gh; y++) {
+        for (int x = 0; x < gw; x++)
+            glyph[y * gw + x] = (x * 8 + y * 5) % 3 ? 255 : (x * y) & 0xFF;
+    }
+    for (int line = 0; line < 2; line++) {
+        for (int n = 0; n < 40; n++) {
+            struct sub_bitmap b = {
+                .bitmap = glyph,
+                .stride = gw,
+                .w = gw, .h = gh,
+                .dw = gw, .dh = gh,
+                .x = w / 2 - 40 * gw / 2 + n * gw,
+                .y = h - 150 + line * (gh + 10),
+                .libass.color = 0xFFFFFF00,
+            };
+            MP_TARRAY_APPEND(ta_parent, sbs->parts, sbs->num_parts, b);
+        }
+    }
+}
+
+static void make_rgba(void *ta_parent, struct sub_bitmaps *sbs, int w, int h)
+{
+    *sbs = (struct sub_bitmaps){.format = SUBBITMAP_RGBA, .change_id = 1};
+    int bw = w * 3 / 4, bh = 60;
+    uint32_t *bmp = talloc_array(ta_parent, uint32_t, bw * bh);
+    for (int n = 0; n < bw * bh; n++)
+        bmp[n] = n % 7 ? 0x80404040 : 0xFFFFFFFF; // premultiplied BGRA
+    struct sub_bitmap b = {
+        .bitmap = bmp,
+        .stride = bw * 4,
+        .w = bw, .h = bh,
+        .dw = bw, .dh = bh,
+        .x = (w - bw) / 2,
+        .y = h - bh - 40,
+    };
+    MP_TARRAY_APPEND(ta_parent, sbs->parts, sbs->num_parts, b);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    static const struct { const char *name; int imgfmt; } fmts[] = {
+        {"yuv420p", IMGFMT_420P},
+        {"bgra", IMGFMT_BGRA},
+    };
+    for (int f = 0; f < MP_ARRAY_SIZE(fmts); f++) {
+        for (int type = 0; type < 2; type++) {
+            void *tmp = talloc_new(NULL);
+            struct draw_ctx ctx = {
+                .dst = mp_image_alloc(fmts[f].imgfmt, 1920, 1080),
+            };
+            talloc_steal(tmp, ctx.dst);
+            mp_image_clear(ctx.dst, 0, 0, ctx.dst->w, ctx.dst->h);
+            if (type == 0) {
+                make_libass(tmp, &ctx.sbs, ctx.dst->w, ctx.dst->h);
+            } else {
+                make_rgba(tmp, &ctx.sbs, ctx.dst->w, ctx.dst->h);
+            }
+
+            for (int change = 0; change < 2; change++) {
+                char name[80];
+                snprintf(name, sizeof(name), "draw_bmp %s 1080p %s%s",
+                         type == 0 ? "libass" : "rgba", fmts[f].name,
+                         change ? " (changed)" : "");
+                ctx.change = change;
+                bench_run(name, run_draw, &ctx, 100);
+            }
+
+            talloc_free(ctx.cache);
+            talloc_free(tmp);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "common/common.h"
+#include "misc/json.h"
+
+// Typical IPC payloads: a short command, a track-list reply, and a reply with
+// a large playlist.
+struct payload {
+    const char *name;
+    char *json;
+    struct mpv_node node;
+    int iters;
+};
+
+struct json_ctx {
+    struct payload *payload;
+    bool arena;
+};
+
+static char *make_track_list(void *ta_parent)
+{
+    char *s = talloc_strdup(ta_parent, "{\"data\":[");
+    for (int n = 0; n < 30; n++) {
+        s = talloc_asprintf_append(s, "%s{\"id\":%d,\"type\":\"%s\","
+            "\"src-id\":%d,\"title\":\"Track title number %d\","
+            "\"lang\":\"eng\",\"albumart\":false,\"default\":%s,"
+            "\"forced\":false,\"codec\":\"h264\",\"external\":false,"
+            "\"demux-w\":1920,\"demux-h\":1080,\"demux-fps\":23.976024,"
+            "\"ff-index\":%d,\"selected\":%s}", n ? "," : "", n + 1,
+            n % 3 ? "audio" : "video", n, n, n == 0 ? "true" : "false",
+            n, n < 2 ? "true" : "false");
+    }
+    return talloc_strdup_append(s, "],\"request_id\":1,\"error\":\"success\"}");
+}
+
+static char *make_playlist(void *ta_parent, int num)
+{
+    char *s = talloc_strdup(ta_parent, "{\"data\":[");
+    for (int n = 0; n < num; n++) {
+        s = talloc_asprintf_append(s, "%s{\"filename\":"
+            "\"/home/user/Music/Some Artist/Some Album/%05d - Title.flac\""
+            "%s}", n ? "," : "", n, n == 0 ? ",\"current\":true" : "");
+    }
+    return talloc_strdup_append(s, "],\"request_id\":2,\"error\":\"success\"}");
+}
+
+static void run_parse(void *p)
+{
+    struct json_ctx *ctx = p;
+    void *tmp = ctx->arena ? talloc_new_arena(NULL) : talloc_new(NULL);
+    char *src = talloc_strdup(tmp, ctx->payload->json);
+    struct mpv_node node;
+    json_parse(tmp, &node, &src, 50);
+    talloc_free(tmp);
+}
+
+static void run_write(void *p)
+{
+    struct json_ctx *ctx = p;
+    char *out = talloc_strdup(NULL, "");
+    json_write(&out, &ctx->payload->node);
+    talloc_free(out);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    void *tmp = talloc_new(NULL);
+    struct payload payloads[] = {
+        {"command", talloc_strdup(tmp, "{\"command\":[\"set_property\","
+            "\"pause\",true],\"request_id\":123}"), .iters = 100000},
+        {"track-list", make_track_list(tmp), .iters = 1000},
+        {"playlist (50k)", make_playlist(tmp, 50000), .iters = 5},
+    };
+
+    for (int n = 0; n < MP_ARRAY_SIZE(payloads); n++) {
+        struct payload *pl = &payloads[n];
+        char *src = talloc_strdup(tmp, pl->json);
+        if (json_parse(tmp, &pl->node, &src, 50) < 0)
+            abort();
+
+        struct json_ctx ctx = {.payload = pl};
+        char name[80];
+        snprintf(name, sizeof(name), "json parse %s", pl->name);
+        bench_run(name, run_parse, &ctx, pl->iters);
+        ctx.arena = true;
+        snprintf(name, sizeof(name), "json parse %s (arena)", pl->name);
+        bench_run(name, run_parse, &ctx, pl->iters);
+        snprintf(name, sizeof(name), "json write %s", pl->name);
+        bench_run(name, run_write, &ctx, pl->iters);
+    }
+
+    talloc_free(tmp);
+    return 0;
+}
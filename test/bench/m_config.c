@@ -0,0 +1,76 @@
+#include "bench.h"
+#include "common/common.h"
+#include "options/m_option.h"
+
+struct cache_ctx {
+    struct m_config *config;
+    struct m_config_cache *cache;
+    struct m_config_option *co;
+    float volume;
+};
+
+static void run_update(void *p)
+{
+    struct cache_ctx *ctx = p;
+    m_config_cache_update(ctx->cache);
+}
+
+static void run_set(void *p)
+{
+    struct cache_ctx *ctx = p;
+    ctx->volume = ctx->volume == 50 ? 60 : 50;
+    m_config_set_option_raw(ctx->config, ctx->co, &ctx->volume, 0);
+}
+
+static void run_set_update(void *p)
+{
+    run_set(p);
+    run_update(p);
+}
+
+static void run_alloc(void *p)
+{
+    struct cache_ctx *ctx = p;
+    talloc_free(m_config_cache_alloc(NULL, ctx->config->global, NULL));
+}
+
+static void run_read_raw(void *p)
+{
+    struct cache_ctx *ctx = p;
+    float v;
+    mp_read_option_raw(ctx->config->global, "volume", &m_option_type_float, &v);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    struct m_config *config = bench_create_config();
+    struct cache_ctx ctx = {
+        .config = config,
+        .co = m_config_get_co(config, bstr0("volume")),
+    };
+    if (!ctx.co)
+        abort();
+
+    // Cache of all options (like the core's), and of a small group which
+    // does not contain the changed option (like most other users).
+    ctx.cache = m_config_cache_alloc(NULL, config->global, NULL);
+    bench_run("m_config_cache_update all (no change)", run_update, &ctx, 10000);
+    bench_run("m_config_cache_update all (1 change)", run_set_update, &ctx,
+              10000);
+    talloc_free(ctx.cache);
+
+    ctx.cache = m_config_cache_alloc(NULL, config->global, &vo_sub_opts);
+    bench_run("m_config_cache_update vo (no change)", run_update, &ctx, 10000);
+    bench_run("m_config_cache_update vo (1 other change)", run_set_update,
+              &ctx, 10000);
+    talloc_free(ctx.cache);
+
+    bench_run("m_config_set_option_raw", run_set, &ctx, 10000);
+    bench_run("m_config_cache_alloc all", run_alloc, &ctx, 100);
+    bench_run("mp_read_option_raw", run_read_raw, &ctx, 10000);
+
+    bench_destroy_config(config);
+    return 0;
+}
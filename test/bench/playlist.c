@@ -0,0 +1,112 @@
+#include "bench.h"
+#include "common/common.h"
+#include "common/playlist.h"
+
+// Playlist operations on a large playlist, as created by loading a directory
+// or a big .m3u file, and editing it with the playlist-* commands or the
+// playlist property from client API scripts.
+#define ENTRIES 100000
+
+static struct playlist *create_playlist(int count)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    for (int n = 0; n < count; n++)
+        playlist_add_file(pl, "file.mkv");
+    return pl;
+}
+
+static void run_build(void *p)
+{
+    struct playlist *pl = create_playlist(10000);
+    talloc_free(pl);
+}
+
+static void run_from_index(void *p)
+{
+    struct playlist *pl = p;
+    // Like reading the "playlist" property, or playlist/N/filename in a loop.
+    for (int n = 0; n < pl->num_entries; n++) {
+        if (!playlist_entry_from_index(pl, n))
+            abort();
+    }
+}
+
+static void run_to_index(void *p)
+{
+    struct playlist *pl = p;
+    for (struct playlist_entry *e = pl->first; e; e = e->next) {
+        if (playlist_entry_to_index(pl, e) < 0)
+            abort();
+    }
+}
+
+static void run_move(void *p)
+{
+    struct playlist *pl = p;
+    // playlist-move between the middle and both ends.
+    for (int n = 0; n < 10; n++) {
+        struct playlist_entry *e = playlist_entry_from_index(pl, ENTRIES / 2);
+        playlist_move(pl, e, pl->first);
+        playlist_move(pl, pl->first, playlist_entry_from_index(pl, ENTRIES / 2 + 1));
+        e = playlist_entry_from_index(pl, ENTRIES / 2);
+        playlist_move(pl, e, NULL);
+        playlist_move(pl, pl->last, playlist_entry_from_index(pl, ENTRIES / 2));
+    }
+}
+
+static void run_remove_insert(void *p)
+{
+    struct playlist *pl = p;
+    // playlist-remove in the middle, then re-adding it.
+    for (int n = 0; n < 10; n++) {
+        struct playlist_entry *e = playlist_entry_from_index(pl, ENTRIES / 2);
+        playlist_remove(pl, e);
+        e = playlist_entry_from_index(pl, ENTRIES / 2 - 1);
+        playlist_insert(pl, e, playlist_entry_new("file.mkv"));
+    }
+}
+
+static void run_shuffle(void *p)
+{
+    playlist_shuffle(p);
+}
+
+static void run_append(void *p)
+{
+    struct playlist *pl = create_playlist(ENTRIES);
+    struct playlist *src = create_playlist(10000);
+    pl->current = playlist_entry_from_index(pl, ENTRIES / 2);
+    playlist_transfer_entries(pl, src);
+    talloc_free(src);
+    talloc_free(pl);
+}
+
+static void run_clear_except_current(void *p)
+{
+    struct playlist *pl = create_playlist(ENTRIES);
+    pl->current = playlist_entry_from_index(pl, ENTRIES / 2);
+    playlist_clear_except_current(pl);
+    talloc_free(pl);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    bench_run("playlist build (10000 entries)", run_build, NULL, 20);
+
+    struct playlist *pl = create_playlist(ENTRIES);
+    bench_run("playlist from_index (100000 entries)", run_from_index, pl, 20);
+    bench_run("playlist to_index (100000 entries)", run_to_index, pl, 20);
+    bench_run("playlist move (100000 entries)", run_move, pl, 20);
+    bench_run("playlist remove+insert (100000 entries)", run_remove_insert,
+              pl, 20);
+    bench_run("playlist shuffle (100000 entries)", run_shuffle, pl, 20);
+    talloc_free(pl);
+
+    bench_run("playlist transfer 10000 into 100000 entries", run_append,
+              NULL, 5);
+    bench_run("playlist clear except current (100000 entries)",
+              run_clear_except_current, NULL, 5);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "common/common.h"
+#include "options/m_property.h"
+
+// Roughly the size of the property list built by command.c (manual properties
+// plus the option bridge).
+#define NUM_PROPS 1200
+
+struct lookup_ctx {
+    struct m_property *list;
+    struct m_property_index *index;
+    const char *names[3];
+};
+
+static int prop_int(void *ctx, struct m_property *prop, int action, void *arg)
+{
+    return m_property_int_ro(action, arg, 1);
+}
+
+static void run_list_find(void *p)
+{
+    struct lookup_ctx *ctx = p;
+    for (int n = 0; n < MP_ARRAY_SIZE(ctx->names); n++)
+        m_property_list_find(ctx->list, ctx->names[n]);
+}
+
+static void run_index_find(void *p)
+{
+    struct lookup_ctx *ctx = p;
+    for (int n = 0; n < MP_ARRAY_SIZE(ctx->names); n++)
+        m_property_index_find(ctx->index, bstr0(ctx->names[n]));
+}
+
+static void run_get(void *p)
+{
+    struct lookup_ctx *ctx = p;
+    for (int n = 0; n < MP_ARRAY_SIZE(ctx->names); n++) {
+        int val;
+        m_property_do(NULL, ctx->index, ctx->names[n], M_PROPERTY_GET, &val,
+                      NULL);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    struct lookup_ctx ctx = {
+        .list = talloc_zero_array(NULL, struct m_property, NUM_PROPS + 1),
+    };
+    for (int n = 0; n < NUM_PROPS; n++) {
+        ctx.list[n] = (struct m_property){
+            .name = talloc_asprintf(ctx.list, "some-property-%d", n),
+            .call = prop_int,
+        };
+    }
+    ctx.index = m_property_index_create(ctx.list, ctx.list);
+    // Front, middle, back.
+    ctx.names[0] = ctx.list[0].name;
+    ctx.names[1] = ctx.list[NUM_PROPS / 2].name;
+    ctx.names[2] = ctx.list[NUM_PROPS - 1].name;
+
+    bench_run("property lookup (3 names) linear", run_list_find, &ctx, 10000);
+    bench_run("property lookup (3 names) index", run_index_find, &ctx, 10000);
+    bench_run("property get (3 names)", run_get, &ctx, 10000);
+
+    talloc_free(ctx.list);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+
+#include "bench.h"
+#include "audio/xcorr.h"
+#include "common/common.h"
+
+// Overlap search as done by af_scaletempo with default options (12 ms overlap,
+// 14 ms search) at 48 kHz.
+struct search_ctx {
+    struct mp_xcorr *xcorr;
+    float *ref, *search;
+};
+
+static void run_search(void *p)
+{
+    struct search_ctx *ctx = p;
+    mp_xcorr_best_offset(ctx->xcorr, ctx->ref, ctx->search);
+}
+
+static void bench_search(int channels, double ms_search)
+{
+    int frames_overlap = 48 * 12;
+    int frames_search = 48 * ms_search;
+    int ref_len = (frames_overlap - 1) * channels;
+    int search_len = ref_len + (frames_search - 1) * channels;
+
+    struct search_ctx ctx = {
+        .ref = talloc_array(NULL, float, ref_len),
+        .search = talloc_array(NULL, float, search_len),
+    };
+    for (int i = 0; i < ref_len; i++)
+        ctx.ref[i] = rand() / (float)RAND_MAX;
+    for (int i = 0; i < search_len; i++)
+        ctx.search[i] = rand() / (float)RAND_MAX;
+
+    static const char *const names[] = {"auto", "direct", "fft"};
+    for (int mode = MP_XCORR_AUTO; mode <= MP_XCORR_FFT; mode++) {
+        ctx.xcorr = mp_xcorr_create(NULL, mode, ref_len, frames_search,
+                                    channels);
+        char name[80];
+        snprintf(name, sizeof(name), "xcorr %dch %gms %s%s", channels,
+                 ms_search, names[mode],
+                 mode == MP_XCORR_AUTO && mp_xcorr_uses_fft(ctx.xcorr)
+                    ? "(fft)" : "");
+        bench_run(name, run_search, &ctx, 50);
+        talloc_free(ctx.xcorr);
+    }
+
+    talloc_free(ctx.ref);
+    talloc_free(ctx.search);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    int channels[] = {1, 2, 6, 8};
+    for (int n = 0; n < MP_ARRAY_SIZE(channels); n++) {
+        bench_search(channels[n], 14);
+        bench_search(channels[n], 50);
+    }
+    return 0;
+}
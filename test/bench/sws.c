@@ -0,0 +1,67 @@
+#include "bench.h"
+#include "common/common.h"
+#include "video/img_format.h"
+#include "video/mp_image.h"
+#include "video/sws_utils.h"
+
+// Software conversion as done by vf_format/autoconvert, screenshots, and VOs
+// like vo_x11 (mp_sws_scale() with the default --sws-scaler).
+
+struct sws_ctx {
+    struct mp_sws_context *sws;
+    struct mp_image *src, *dst;
+};
+
+static void run_scale(void *p)
+{
+    struct sws_ctx *ctx = p;
+    mp_sws_scale(ctx->sws, ctx->dst, ctx->src);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    static const struct {
+        const char *name;
+        int src_fmt, src_w, src_h;
+        int dst_fmt, dst_w, dst_h;
+    } cases[] = {
+        {"1080p yuv420p -> bgra", IMGFMT_420P, 1920, 1080,
+                                  IMGFMT_BGRA, 1920, 1080},
+        {"1080p nv12 -> yuv420p", IMGFMT_NV12, 1920, 1080,
+                                  IMGFMT_420P, 1920, 1080},
+        {"1080p yuv420p -> 720p", IMGFMT_420P, 1920, 1080,
+                                  IMGFMT_420P, 1280, 720},
+        {"720p yuv420p -> 1080p bgra", IMGFMT_420P, 1280, 720,
+                                       IMGFMT_BGRA, 1920, 1080},
+    };
+
+    for (int n = 0; n < MP_ARRAY_SIZE(cases); n++) {
+        char name[80];
+        snprintf(name, sizeof(name), "mp_sws_scale %s", cases[n].name);
+        if (!bench_enabled(name))
+            continue;
+
+        struct sws_ctx ctx = {
+            .sws = mp_sws_alloc(NULL),
+            .src = mp_image_alloc(cases[n].src_fmt, cases[n].src_w,
+                                  cases[n].src_h),
+            .dst = mp_image_alloc(cases[n].dst_fmt, cases[n].dst_w,
+                                  cases[n].dst_h),
+        };
+        if (!ctx.src || !ctx.dst)
+            abort();
+        mp_image_clear(ctx.src, 0, 0, ctx.src->w, ctx.src->h);
+        // The first call creates the swscale context, which is reused for all
+        // following frames in normal use. Keep it out of the measurement.
+        if (mp_sws_scale(ctx.sws, ctx.dst, ctx.src) < 0)
+            abort();
+        bench_run(name, run_scale, &ctx, 10);
+
+        talloc_free(ctx.sws);
+        talloc_free(ctx.src);
+        talloc_free(ctx.dst);
+    }
+    return 0;
+}
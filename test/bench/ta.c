@@ -0,0 +1,81 @@
+#include "bench.h"
+#include "common/common.h"
+
+// Allocation patterns that are common in the player: short-lived single
+// allocations, a parent with many small children freed at once (e.g. a
+// parsed mpv_node tree), and arrays grown with MP_TARRAY_APPEND. The tree is
+// also built in an arena, both freshly created and reused.
+
+static void run_alloc_free(void *p)
+{
+    for (int n = 0; n < 100; n++) {
+        void *ptr = talloc_size(NULL, 64);
+        talloc_free(ptr);
+    }
+}
+
+static void build_tree(void *root)
+{
+    for (int n = 0; n < 100; n++) {
+        char *s = talloc_strdup(root, "some short string");
+        talloc_zero_size(s, 32);
+    }
+}
+
+static void run_tree(void *p)
+{
+    void *root = talloc_new(NULL);
+    build_tree(root);
+    talloc_free(root);
+}
+
+static void run_tree_arena(void *p)
+{
+    void *root = talloc_new_arena(NULL);
+    build_tree(root);
+    talloc_free(root);
+}
+
+static void run_tree_arena_reset(void *p)
+{
+    build_tree(p);
+    talloc_free_children(p);
+}
+
+static void run_steal(void *p)
+{
+    void *a = talloc_new(NULL);
+    void *b = talloc_new(NULL);
+    void *ptrs[100];
+    for (int n = 0; n < MP_ARRAY_SIZE(ptrs); n++)
+        ptrs[n] = talloc_size(a, 16);
+    for (int n = 0; n < MP_ARRAY_SIZE(ptrs); n++)
+        talloc_steal(b, ptrs[n]);
+    talloc_free(a);
+    talloc_free(b);
+}
+
+static void run_tarray(void *p)
+{
+    int *arr = NULL;
+    int num = 0;
+    for (int n = 0; n < 1000; n++)
+        MP_TARRAY_APPEND(NULL, arr, num, n);
+    talloc_free(arr);
+}
+
+int main(int argc, char **argv)
+{
+    bench_init(argc, argv);
+
+    bench_run("ta alloc+free (100x 64 bytes)", run_alloc_free, NULL, 1000);
+    bench_run("ta tree (200 children)", run_tree, NULL, 1000);
+    bench_run("ta tree in arena (200 children)", run_tree_arena, NULL, 1000);
+    void *arena = talloc_new_arena(NULL);
+    bench_run("ta tree in reused arena (200 children)", run_tree_arena_reset,
+              arena, 1000);
+    talloc_free(arena);
+    bench_run("ta steal (100 children)", run_steal, NULL, 1000);
+    bench_run("ta MP_TARRAY_APPEND (1000 ints)", run_tarray, NULL, 1000);
+    return 0;
+}
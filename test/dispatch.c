@@ -0,0 +1,166 @@
+#include <pthread.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "misc/dispatch.h"
+#include "osdep/atomic.h"
+
+#define NUM_PRODUCERS 8
+#define NUM_ITEMS 20000
+
+struct stress_ctx {
+    struct mp_dispatch_queue *queue;
+    bool done;
+    // --- only accessed on the target thread, or with mp_dispatch_lock()
+    int next_seq[NUM_PRODUCERS];
+    int notified[NUM_PRODUCERS];
+    int locked;
+    bool ok;
+};
+
+struct seq_item {
+    struct stress_ctx *ctx;
+    int producer;
+    int seq;
+};
+
+static void check_seq(void *p)
+{
+    struct seq_item *item = p;
+    struct stress_ctx *ctx = item->ctx;
+    // Items from the same producer must run in the order they were queued.
+    if (ctx->next_seq[item->producer] != item->seq)
+        ctx->ok = false;
+    ctx->next_seq[item->producer] += 1;
+}
+
+static void notify(void *p)
+{
+    int *notified = p;
+    *notified += 1;
+}
+
+static void set_done(void *p)
+{
+    struct stress_ctx *ctx = p;
+    ctx->done = true;
+}
+
+static void *target_thread(void *p)
+{
+    struct stress_ctx *ctx = p;
+    while (!ctx->done)
+        mp_dispatch_queue_process(ctx->queue, 1.0);
+    return NULL;
+}
+
+struct producer {
+    struct stress_ctx *ctx;
+    int index;
+};
+
+static void *producer_thread(void *p)
+{
+    struct producer *pr = p;
+    struct stress_ctx *ctx = pr->ctx;
+    for (int n = 0; n < NUM_ITEMS; n++) {
+        if (n % 1000 == 500) {
+            mp_dispatch_lock(ctx->queue);
+            ctx->locked += 1;
+            mp_dispatch_unlock(ctx->queue);
+        }
+        if (n % 50 == 25) {
+            mp_dispatch_enqueue_notify(ctx->queue, notify,
+                                       &ctx->notified[pr->index]);
+        }
+        if (n % 100 == 0) {
+            struct seq_item item = {ctx, pr->index, n};
+            mp_dispatch_run(ctx->queue, check_seq, &item);
+        } else {
+            struct seq_item *item = talloc_ptrtype(NULL, item);
+            *item = (struct seq_item){ctx, pr->index, n};
+            mp_dispatch_enqueue_autofree(ctx->queue, check_seq, item);
+        }
+    }
+    return NULL;
+}
+
+static void test_stress(void **state) {
+    struct stress_ctx ctx = {
+        .queue = mp_dispatch_create(NULL),
+        .ok = true,
+    };
+
+    pthread_t target;
+    assert_int_equal(pthread_create(&target, NULL, target_thread, &ctx), 0);
+
+    pthread_t threads[NUM_PRODUCERS];
+    struct producer producers[NUM_PRODUCERS];
+    for (int n = 0; n < NUM_PRODUCERS; n++) {
+        producers[n] = (struct producer){&ctx, n};
+        assert_int_equal(pthread_create(&threads[n], NULL, producer_thread,
+                                        &producers[n]), 0);
+    }
+    for (int n = 0; n < NUM_PRODUCERS; n++)
+        pthread_join(threads[n], NULL);
+
+    mp_dispatch_run(ctx.queue, set_done, &ctx);
+    pthread_join(target, NULL);
+
+    assert_true(ctx.ok);
+    for (int n = 0; n < NUM_PRODUCERS; n++) {
+        assert_int_equal(ctx.next_seq[n], NUM_ITEMS);
+        // Merged if still queued, so at most once per enqueue_notify call.
+        assert_true(ctx.notified[n] >= 1 && ctx.notified[n] <= NUM_ITEMS / 50);
+    }
+    assert_int_equal(ctx.locked, NUM_PRODUCERS * (NUM_ITEMS / 1000));
+
+    talloc_free(ctx.queue);
+}
+
+static void count_wakeup(void *p)
+{
+    int *wakeups = p;
+    *wakeups += 1;
+}
+
+static void test_wakeup_coalescing(void **state) {
+    struct mp_dispatch_queue *queue = mp_dispatch_create(NULL);
+    int wakeups = 0;
+    mp_dispatch_set_wakeup_fn(queue, count_wakeup, &wakeups);
+
+    int notified = 0;
+    for (int n = 0; n < 100; n++)
+        mp_dispatch_enqueue(queue, notify, &notified);
+    // Only the first item wakes up the target thread.
+    assert_int_equal(wakeups, 1);
+
+    mp_dispatch_queue_process(queue, 0);
+    assert_int_equal(notified, 100);
+
+    mp_dispatch_enqueue(queue, notify, &notified);
+    assert_int_equal(wakeups, 2);
+
+    // Canceling works on items that weren't moved to the locked list yet.
+    mp_dispatch_enqueue(queue, count_wakeup, &wakeups);
+    mp_dispatch_cancel_fn(queue, count_wakeup, &wakeups);
+    mp_dispatch_queue_process(queue, 0);
+    assert_int_equal(notified, 101);
+    assert_int_equal(wakeups, 2);
+
+    // Merging too.
+    for (int n = 0; n < 10; n++)
+        mp_dispatch_enqueue_notify(queue, notify, &notified);
+    mp_dispatch_queue_process(queue, 0);
+    assert_int_equal(notified, 102);
+
+    talloc_free(queue);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_stress),
+        cmocka_unit_test(test_wakeup_coalescing),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
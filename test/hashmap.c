@@ -0,0 +1,77 @@
+#include <stdio.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "misc/hashmap.h"
+
+static void test_set_find(void **state) {
+    struct mp_hashmap *map = mp_hashmap_create(NULL);
+    assert_int_equal(mp_hashmap_count(map), 0);
+    assert_true(!mp_hashmap_find(map, bstr0("a")));
+
+    mp_hashmap_set(map, bstr0("a"), 1);
+    mp_hashmap_set(map, bstr0(""), 2);
+    assert_int_equal(mp_hashmap_count(map), 2);
+    assert_int_equal(*mp_hashmap_find(map, bstr0("a")), 1);
+    assert_int_equal(*mp_hashmap_find(map, bstr0("")), 2);
+
+    mp_hashmap_set(map, bstr0("a"), 3);
+    assert_int_equal(mp_hashmap_count(map), 2);
+    assert_int_equal(*mp_hashmap_find(map, bstr0("a")), 3);
+
+    // Prefixes are distinct keys.
+    assert_true(!mp_hashmap_find(map, bstr0("ab")));
+    // Empty keys compare equal regardless of the pointer.
+    assert_int_equal(*mp_hashmap_find(map, bstr_splice(bstr0("a"), 0, 0)), 2);
+
+    talloc_free(map);
+}
+
+static void test_grow_remove(void **state) {
+    struct mp_hashmap *map = mp_hashmap_create(NULL);
+    char key[20];
+    for (int n = 0; n < 1000; n++) {
+        snprintf(key, sizeof(key), "key-%d", n);
+        mp_hashmap_set(map, bstr0(key), n);
+    }
+    assert_int_equal(mp_hashmap_count(map), 1000);
+
+    // Remove every other entry; the rest must stay reachable.
+    for (int n = 0; n < 1000; n += 2) {
+        snprintf(key, sizeof(key), "key-%d", n);
+        assert_true(mp_hashmap_remove(map, bstr0(key)));
+        assert_true(!mp_hashmap_remove(map, bstr0(key)));
+    }
+    assert_int_equal(mp_hashmap_count(map), 500);
+    for (int n = 0; n < 1000; n++) {
+        snprintf(key, sizeof(key), "key-%d", n);
+        int *val = mp_hashmap_find(map, bstr0(key));
+        if (n & 1) {
+            assert_true(val);
+            assert_int_equal(*val, n);
+        } else {
+            assert_true(!val);
+        }
+    }
+
+    talloc_free(map);
+}
+
+static void test_ptr_key(void **state) {
+    struct mp_hashmap *map = mp_hashmap_create(NULL);
+    int a, b;
+    mp_hashmap_set(map, MP_HASHMAP_PTR_KEY(&a), 1);
+    mp_hashmap_set(map, MP_HASHMAP_PTR_KEY(&b), 2);
+    assert_int_equal(*mp_hashmap_find(map, MP_HASHMAP_PTR_KEY(&a)), 1);
+    assert_int_equal(*mp_hashmap_find(map, MP_HASHMAP_PTR_KEY(&b)), 2);
+    talloc_free(map);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_set_find),
+        cmocka_unit_test(test_grow_remove),
+        cmocka_unit_test(test_ptr_key),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
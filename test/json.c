@@ -0,0 +1,97 @@
+#include <string.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "misc/json.h"
+
+static char *write_json(void *ta_parent, struct mpv_node *node, bool pretty)
+{
+    char *out = talloc_strdup(ta_parent, "");
+    assert_int_equal(pretty ? json_write_pretty(&out, node)
+                            : json_write(&out, node), 0);
+    return out;
+}
+
+// Parse, write again, and compare with the expected output.
+static void check_json(const char *in, const char *expect, bool arena)
+{
+    void *tmp = arena ? talloc_new_arena(NULL) : talloc_new(NULL);
+    char *src = talloc_strdup(tmp, in);
+    struct mpv_node node;
+    assert_int_equal(json_parse(tmp, &node, &src, 10), 0);
+    assert_string_equal(write_json(tmp, &node, false), expect);
+    talloc_free(tmp);
+}
+
+static const char *const roundtrip[][2] = {
+    {"null", "null"},
+    {" true ", "true"},
+    {"-12", "-12"},
+    {"0.5", "0.500000"},
+    {"\"\"", "\"\""},
+    {"\"a string that is longer than 8 bytes\"",
+     "\"a string that is longer than 8 bytes\""},
+    {"\"quote\\\" backslash\\\\ tab\\t\"",
+     "\"quote\\u0022 backslash\\u005c tab\\u0009\""},
+    {"\"0123456\\\"0123456\"", "\"0123456\\u00220123456\""},
+    {"[]", "[]"},
+    {"{}", "{}"},
+    {"[1, [2, [3, []]], {\"a\": {\"b\": [4]}}, 5]",
+     "[1,[2,[3,[]]],{\"a\":{\"b\":[4]}},5]"},
+    {"{\"k\\\"ey\": 1, \"other\": [true, false, null]}",
+     "{\"k\\u0022ey\":1,\"other\":[true,false,null]}"},
+};
+
+static void test_roundtrip(void **state) {
+    for (int n = 0; n < MP_ARRAY_SIZE(roundtrip); n++) {
+        check_json(roundtrip[n][0], roundtrip[n][1], false);
+        check_json(roundtrip[n][0], roundtrip[n][1], true);
+    }
+}
+
+static void test_invalid(void **state) {
+    static const char *const inputs[] = {
+        "", "[", "[1,", "[1 2]", "{\"a\" 1}", "{1: 2}", "\"abc", "\"abc\\",
+        "[[[[[[[[[[[[1]]]]]]]]]]]]", "nul", "x",
+    };
+    for (int n = 0; n < MP_ARRAY_SIZE(inputs); n++) {
+        for (int arena = 0; arena < 2; arena++) {
+            void *tmp = arena ? talloc_new_arena(NULL) : talloc_new(NULL);
+            char *src = talloc_strdup(tmp, inputs[n]);
+            struct mpv_node node;
+            assert_true(json_parse(tmp, &node, &src, 10) < 0);
+            talloc_free(tmp);
+        }
+    }
+}
+
+static void test_large(void **state) {
+    // Large enough to use several arena blocks.
+    void *tmp = talloc_new_arena(NULL);
+    char *in = talloc_strdup(tmp, "[");
+    for (int n = 0; n < 10000; n++)
+        in = talloc_asprintf_append(in, "%s{\"id\":%d,\"name\":\"entry %d\"}",
+                                    n ? "," : "", n, n);
+    in = talloc_strdup_append(in, "]");
+    char *expect = talloc_strdup(tmp, in);
+
+    struct mpv_node node;
+    char *src = in;
+    assert_int_equal(json_parse(tmp, &node, &src, 10), 0);
+    assert_int_equal(node.u.list->num, 10000);
+    assert_int_equal(node.u.list->values[9999].u.list->values[0].u.int64, 9999);
+    assert_string_equal(write_json(tmp, &node, false), expect);
+
+    char *pretty = write_json(tmp, &node, true);
+    assert_true(strlen(pretty) > strlen(expect));
+    talloc_free(tmp);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_roundtrip),
+        cmocka_unit_test(test_invalid),
+        cmocka_unit_test(test_large),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
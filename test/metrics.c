@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "common/global.h"
+#include "common/metrics.h"
+#include "libmpv/client.h"
+
+static struct mpv_node *get(struct mpv_node *map, const char *key)
+{
+    assert_int_equal(map->format, MPV_FORMAT_NODE_MAP);
+    for (int n = 0; n < map->u.list->num; n++) {
+        if (strcmp(map->u.list->keys[n], key) == 0)
+            return &map->u.list->values[n];
+    }
+    return NULL;
+}
+
+static int64_t get_int(struct mpv_node *map, const char *key)
+{
+    struct mpv_node *node = get(map, key);
+    assert_true(node && node->format == MPV_FORMAT_INT64);
+    return node->u.int64;
+}
+
+static void *count_thread(void *p)
+{
+    for (int n = 0; n < 100000; n++)
+        mp_metric_add(p, 1);
+    return NULL;
+}
+
+static void test_types(void **state) {
+    struct mpv_global global = {0};
+    global.metrics = mp_metrics_create(NULL);
+
+    struct mp_metric *counter = mp_metrics_get(&global, "c", MP_METRIC_COUNTER);
+    struct mp_metric *gauge = mp_metrics_get(&global, "g", MP_METRIC_GAUGE);
+    assert_true(counter && gauge);
+    assert_true(mp_metrics_get(&global, "c", MP_METRIC_COUNTER) == counter);
+    assert_true(!mp_metrics_get(&global, "c", MP_METRIC_GAUGE));
+
+    // Missing registry: everything is a no-op.
+    struct mpv_global empty = {0};
+    assert_true(!mp_metrics_get(&empty, "c", MP_METRIC_COUNTER));
+    mp_metric_add(NULL, 1);
+
+    pthread_t threads[4];
+    for (int n = 0; n < MP_ARRAY_SIZE(threads); n++)
+        pthread_create(&threads[n], NULL, count_thread, counter);
+    for (int n = 0; n < MP_ARRAY_SIZE(threads); n++)
+        pthread_join(threads[n], NULL);
+
+    mp_metric_set(gauge, 5);
+    mp_metric_set(gauge, -3);
+
+    struct mpv_node res;
+    mp_metrics_get_node(global.metrics, &res);
+    assert_int_equal(get_int(&res, "c"), 400000);
+    assert_int_equal(get_int(&res, "g"), -3);
+    talloc_free(res.u.list);
+
+    talloc_free(global.metrics);
+}
+
+static void test_histogram(void **state) {
+    struct mpv_global global = {0};
+    global.metrics = mp_metrics_create(NULL);
+
+    struct mp_metric *h = mp_metrics_get(&global, "h", MP_METRIC_HISTOGRAM);
+    for (int n = 1; n <= 1000; n++)
+        mp_metric_record(h, n);
+
+    struct mpv_node res;
+    mp_metrics_get_node(global.metrics, &res);
+    struct mpv_node *node = get(&res, "h");
+    assert_true(node);
+    assert_int_equal(get_int(node, "count"), 1000);
+    assert_int_equal(get_int(node, "sum"), 500500);
+    assert_int_equal(get_int(node, "max"), 1000);
+    // Approximate, but never below the exact value and at most 25% above.
+    static const struct { const char *name; int64_t exact; } pct[] = {
+        {"p50", 500}, {"p90", 900}, {"p99", 990},
+    };
+    for (int n = 0; n < MP_ARRAY_SIZE(pct); n++) {
+        int64_t v = get_int(node, pct[n].name);
+        assert_true(v >= pct[n].exact);
+        assert_true(v <= pct[n].exact * 5 / 4);
+    }
+    talloc_free(res.u.list);
+
+    // Small values are exact.
+    h = mp_metrics_get(&global, "small", MP_METRIC_HISTOGRAM);
+    mp_metric_record(h, 0);
+    mp_metric_record(h, 3);
+    mp_metric_record(h, -10);
+    mp_metrics_get_node(global.metrics, &res);
+    node = get(&res, "small");
+    assert_int_equal(get_int(node, "count"), 3);
+    assert_int_equal(get_int(node, "p50"), 0);
+    assert_int_equal(get_int(node, "p99"), 3);
+    talloc_free(res.u.list);
+
+    talloc_free(global.metrics);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_types),
+        cmocka_unit_test(test_histogram),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
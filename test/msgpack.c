@@ -0,0 +1,152 @@
+#include <string.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "misc/msgpack.h"
+
+static bool nodes_equal(struct mpv_node *a, struct mpv_node *b)
+{
+    if (a->format != b->format)
+        return false;
+    switch (a->format) {
+    case MPV_FORMAT_NONE:
+        return true;
+    case MPV_FORMAT_STRING:
+        return strcmp(a->u.string, b->u.string) == 0;
+    case MPV_FORMAT_FLAG:
+        return a->u.flag == b->u.flag;
+    case MPV_FORMAT_INT64:
+        return a->u.int64 == b->u.int64;
+    case MPV_FORMAT_DOUBLE:
+        return a->u.double_ == b->u.double_;
+    case MPV_FORMAT_BYTE_ARRAY:
+        return a->u.ba->size == b->u.ba->size &&
+               memcmp(a->u.ba->data, b->u.ba->data, a->u.ba->size) == 0;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP:
+        if (a->u.list->num != b->u.list->num)
+            return false;
+        for (int n = 0; n < a->u.list->num; n++) {
+            if (a->format == MPV_FORMAT_NODE_MAP &&
+                strcmp(a->u.list->keys[n], b->u.list->keys[n]) != 0)
+                return false;
+            if (!nodes_equal(&a->u.list->values[n], &b->u.list->values[n]))
+                return false;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Encode, check the encoding if expect is set, and decode again.
+static void check_roundtrip(struct mpv_node *node, const char *expect,
+                            size_t expect_len)
+{
+    void *tmp = talloc_new(NULL);
+    bstr data = {0};
+    msgpack_write(&data, node);
+    talloc_steal(tmp, data.start);
+    if (expect) {
+        assert_int_equal(data.len, expect_len);
+        assert_memory_equal(data.start, expect, expect_len);
+    }
+    bstr src = data;
+    struct mpv_node res;
+    assert_true(msgpack_parse(tmp, &res, &src, 10) >= 0);
+    assert_int_equal(src.len, 0);
+    assert_true(nodes_equal(node, &res));
+    talloc_free(tmp);
+}
+
+#define INT(v) ((struct mpv_node){.format = MPV_FORMAT_INT64, .u.int64 = (v)})
+#define CHECK(node, expect) check_roundtrip(&(node), expect, sizeof(expect) - 1)
+
+static void test_scalars(void **state) {
+    struct mpv_node n;
+
+    CHECK(INT(0), "\x00");
+    CHECK(INT(127), "\x7f");
+    CHECK(INT(-1), "\xff");
+    CHECK(INT(-32), "\xe0");
+    CHECK(INT(-33), "\xd0\xdf");
+    CHECK(INT(128), "\xd1\x00\x80");
+    CHECK(INT(-32769), "\xd2\xff\xff\x7f\xff");
+    CHECK(INT(1LL << 40), "\xd3\x00\x00\x01\x00\x00\x00\x00\x00");
+    check_roundtrip(&INT(INT64_MIN), NULL, 0);
+    check_roundtrip(&INT(INT64_MAX), NULL, 0);
+
+    n = (struct mpv_node){.format = MPV_FORMAT_DOUBLE, .u.double_ = 1.5};
+    CHECK(n, "\xcb\x3f\xf8\x00\x00\x00\x00\x00\x00");
+    n = (struct mpv_node){.format = MPV_FORMAT_FLAG, .u.flag = 1};
+    CHECK(n, "\xc3");
+    n = (struct mpv_node){.format = MPV_FORMAT_NONE};
+    CHECK(n, "\xc0");
+    n = (struct mpv_node){.format = MPV_FORMAT_STRING, .u.string = "abc"};
+    CHECK(n, "\xa3" "abc");
+
+    char long_str[300];
+    memset(long_str, 'x', sizeof(long_str) - 1);
+    long_str[sizeof(long_str) - 1] = '\0';
+    n = (struct mpv_node){.format = MPV_FORMAT_STRING, .u.string = long_str};
+    check_roundtrip(&n, NULL, 0);
+
+    struct mpv_byte_array ba = {.data = "\x00\x01", .size = 2};
+    n = (struct mpv_node){.format = MPV_FORMAT_BYTE_ARRAY, .u.ba = &ba};
+    CHECK(n, "\xc4\x02\x00\x01");
+}
+
+static void test_containers(void **state) {
+    struct mpv_node values[20];
+    char *keys[20] = {0};
+    for (int i = 0; i < 20; i++) {
+        values[i] = INT(i);
+        keys[i] = i % 2 ? "odd" : "even";
+    }
+    struct mpv_node_list list = {.num = 2, .values = values, .keys = keys};
+    struct mpv_node n = {.format = MPV_FORMAT_NODE_MAP, .u.list = &list};
+    CHECK(n, "\x82\xa4" "even" "\x00\xa3" "odd" "\x01");
+
+    list.num = 20;
+    n.format = MPV_FORMAT_NODE_ARRAY;
+    check_roundtrip(&n, NULL, 0);
+
+    struct mpv_node inner = n;
+    struct mpv_node_list outer_list = {.num = 1, .values = &inner};
+    struct mpv_node outer = {.format = MPV_FORMAT_NODE_ARRAY,
+                             .u.list = &outer_list};
+    CHECK(outer, "\x91\xdc\x00\x14\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09"
+                 "\x0a\x0b\x0c\x0d\x0e\x0f\x10\x11\x12\x13");
+}
+
+static void test_invalid(void **state) {
+#define IN(s) {s, sizeof(s) - 1}
+    static const struct { const char *data; size_t len; } inputs[] = {
+        IN(""),
+        IN("\xc1"),                     // reserved
+        IN("\xd4\x01\x00"),             // ext
+        IN("\xa3" "ab"),                // truncated string
+        IN("\x92\x01"),                 // truncated array
+        IN("\x81\x01\x02"),             // non-string key
+        IN("\xcf\xff\xff\xff\xff\xff\xff\xff\xff"), // > INT64_MAX
+        IN("\xdd\xff\xff\xff\xff"),     // huge array
+        IN("\x91\x91\x91\x91\x91\x91\x91\x91\x91\x91\x91\x00"), // too deep
+    };
+#undef IN
+    for (int i = 0; i < MP_ARRAY_SIZE(inputs); i++) {
+        void *tmp = talloc_new(NULL);
+        bstr src = {(unsigned char *)inputs[i].data, inputs[i].len};
+        struct mpv_node res;
+        assert_true(msgpack_parse(tmp, &res, &src, 10) < 0);
+        talloc_free(tmp);
+    }
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_scalars),
+        cmocka_unit_test(test_containers),
+        cmocka_unit_test(test_invalid),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
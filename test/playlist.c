@@ -0,0 +1,147 @@
+#include "test_helpers.h"
+#include "common/common.h"
+#include "common/playlist.h"
+
+// Check that the entries array, the cached indexes and the links agree.
+static void check_playlist(struct playlist *pl)
+{
+    int n = 0;
+    struct playlist_entry *prev = NULL;
+    for (struct playlist_entry *e = pl->first; e; e = e->next) {
+        assert_true(n < pl->num_entries);
+        assert_ptr_equal(pl->entries[n], e);
+        assert_ptr_equal(e->pl, pl);
+        assert_ptr_equal(e->prev, prev);
+        assert_int_equal(playlist_entry_to_index(pl, e), n);
+        assert_ptr_equal(playlist_entry_from_index(pl, n), e);
+        prev = e;
+        n++;
+    }
+    assert_ptr_equal(pl->last, prev);
+    assert_int_equal(playlist_entry_count(pl), n);
+    assert_null(playlist_entry_from_index(pl, n));
+    assert_null(playlist_entry_from_index(pl, -1));
+}
+
+static struct playlist *create_playlist(int count)
+{
+    struct playlist *pl = talloc_zero(NULL, struct playlist);
+    for (int n = 0; n < count; n++)
+        playlist_add(pl, playlist_entry_new(talloc_asprintf(pl, "%d", n)));
+    check_playlist(pl);
+    return pl;
+}
+
+static int entry_num(struct playlist *pl, int index)
+{
+    return atoi(playlist_entry_from_index(pl, index)->filename);
+}
+
+static void test_insert_remove(void **state) {
+    struct playlist *pl = create_playlist(10);
+    playlist_insert(pl, NULL, playlist_entry_new("a"));
+    playlist_insert(pl, playlist_entry_from_index(pl, 5),
+                    playlist_entry_new("b"));
+    check_playlist(pl);
+    assert_string_equal(pl->first->filename, "a");
+    assert_string_equal(playlist_entry_from_index(pl, 6)->filename, "b");
+
+    struct playlist_entry *e = playlist_entry_new("c");
+    assert_int_equal(playlist_entry_to_index(pl, e), -1);
+    talloc_free(e);
+    assert_int_equal(playlist_entry_to_index(pl, NULL), -1);
+
+    pl->current = playlist_entry_from_index(pl, 3);
+    playlist_remove(pl, pl->current);
+    check_playlist(pl);
+    assert_true(pl->current_was_replaced);
+    assert_int_equal(playlist_entry_to_index(pl, pl->current), 3);
+    playlist_remove(pl, pl->first);
+    playlist_remove(pl, pl->last);
+    check_playlist(pl);
+    assert_int_equal(playlist_entry_count(pl), 9);
+    talloc_free(pl);
+}
+
+static void test_move(void **state) {
+    struct playlist *pl = create_playlist(10);
+    // Move forward: 2 takes 7's place, i.e. is inserted before it.
+    playlist_move(pl, playlist_entry_from_index(pl, 2),
+                  playlist_entry_from_index(pl, 7));
+    check_playlist(pl);
+    assert_int_equal(entry_num(pl, 6), 2);
+    assert_int_equal(entry_num(pl, 7), 7);
+    // Move backward.
+    playlist_move(pl, playlist_entry_from_index(pl, 8), pl->first);
+    check_playlist(pl);
+    assert_int_equal(entry_num(pl, 0), 8);
+    assert_int_equal(entry_num(pl, 1), 0);
+    // Move to the end.
+    playlist_move(pl, pl->first, NULL);
+    check_playlist(pl);
+    assert_int_equal(entry_num(pl, 9), 8);
+    talloc_free(pl);
+}
+
+static void test_shuffle(void **state) {
+    struct playlist *pl = create_playlist(100);
+    pl->current = playlist_entry_from_index(pl, 50);
+    struct playlist_entry *cur = pl->current;
+    playlist_shuffle(pl);
+    check_playlist(pl);
+    assert_ptr_equal(pl->current, cur);
+    bool seen[100] = {0};
+    for (int n = 0; n < 100; n++)
+        seen[entry_num(pl, n)] = true;
+    for (int n = 0; n < 100; n++)
+        assert_true(seen[n]);
+    talloc_free(pl);
+}
+
+static void test_transfer(void **state) {
+    struct playlist *pl = create_playlist(10);
+    struct playlist *src = create_playlist(5);
+    pl->current = playlist_entry_from_index(pl, 3);
+    src->current = src->first;
+    playlist_transfer_entries(pl, src);
+    check_playlist(pl);
+    check_playlist(src);
+    assert_int_equal(playlist_entry_count(src), 0);
+    assert_null(src->current);
+    assert_int_equal(playlist_entry_count(pl), 15);
+    for (int n = 0; n < 5; n++)
+        assert_int_equal(entry_num(pl, 4 + n), n);
+    assert_int_equal(entry_num(pl, 9), 4);
+    talloc_free(src);
+
+    src = create_playlist(3);
+    playlist_append_entries(pl, src);
+    check_playlist(pl);
+    assert_int_equal(entry_num(pl, 17), 2);
+    talloc_free(src);
+    talloc_free(pl);
+}
+
+static void test_clear(void **state) {
+    struct playlist *pl = create_playlist(10);
+    pl->current = playlist_entry_from_index(pl, 4);
+    playlist_clear_except_current(pl);
+    check_playlist(pl);
+    assert_int_equal(playlist_entry_count(pl), 1);
+    assert_ptr_equal(pl->first, pl->current);
+    playlist_clear(pl);
+    check_playlist(pl);
+    assert_null(pl->first);
+    talloc_free(pl);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_insert_remove),
+        cmocka_unit_test(test_move),
+        cmocka_unit_test(test_shuffle),
+        cmocka_unit_test(test_transfer),
+        cmocka_unit_test(test_clear),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,127 @@
+#include <string.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+
+static int destroyed;
+
+static void count_dtor(void *p)
+{
+    destroyed++;
+}
+
+static void test_alloc_reset(void **state) {
+    void *ctx = talloc_new(NULL);
+    void *arena = talloc_new_arena(ctx);
+
+    char *s = talloc_strdup(arena, "hello");
+    assert_string_equal(s, "hello");
+    assert_true(talloc_parent(s) == arena);
+    assert_int_equal(talloc_get_size(s), 6);
+
+    // Children of arena allocations come from the arena too.
+    char *t = talloc_asprintf(s, "%s world", s);
+    assert_string_equal(t, "hello world");
+    assert_true(talloc_parent(t) == arena);
+
+    // Many small and some large allocations (which need new blocks).
+    for (int n = 0; n < 10000; n++) {
+        int *p = talloc_zero_size(arena, n % 100 == 0 ? 100000 : 24);
+        assert_true(p && p[0] == 0);
+        p[0] = n;
+    }
+
+    // Freeing members does nothing, but is allowed.
+    talloc_free(s);
+    assert_string_equal(t, "hello world");
+
+    talloc_free_children(arena);
+    s = talloc_strdup(arena, "again");
+    assert_string_equal(s, "again");
+
+    talloc_free(ctx);
+}
+
+static void test_realloc(void **state) {
+    void *arena = talloc_new_arena(NULL);
+
+    int *arr = NULL;
+    int num = 0;
+    for (int n = 0; n < 5000; n++)
+        MP_TARRAY_APPEND(arena, arr, num, n);
+    for (int n = 0; n < num; n++)
+        assert_int_equal(arr[n], n);
+
+    // Growing a string appends in place while it's the newest allocation.
+    char *s = talloc_strdup(arena, "");
+    for (int n = 0; n < 1000; n++)
+        s = talloc_asprintf_append_buffer(s, "%d,", n % 10);
+    assert_int_equal(strlen(s), 2000);
+    assert_true(!strncmp(s, "0,1,2,3,4,", 10));
+
+    // Shrinking keeps the contents.
+    int *p = talloc_array(arena, int, 100);
+    talloc_array(arena, int, 1);
+    for (int n = 0; n < 100; n++)
+        p[n] = n;
+    p = talloc_realloc(arena, p, int, 10);
+    assert_int_equal(talloc_get_size(p), 10 * sizeof(int));
+    assert_int_equal(p[9], 9);
+
+    talloc_free(arena);
+}
+
+static void test_destructors(void **state) {
+    destroyed = 0;
+    void *arena = talloc_new_arena(NULL);
+
+    for (int n = 0; n < 10; n++) {
+        void *p = talloc_size(arena, 8);
+        talloc_set_destructor(p, count_dtor);
+    }
+    // A normal allocation moved into the arena is freed with it.
+    void *normal = talloc_size(NULL, 8);
+    talloc_set_destructor(normal, count_dtor);
+    talloc_steal(arena, normal);
+    assert_true(talloc_parent(normal) == arena);
+
+    assert_int_equal(destroyed, 0);
+    talloc_free_children(arena);
+    assert_int_equal(destroyed, 11);
+
+    void *p = talloc_size(arena, 8);
+    talloc_set_destructor(p, count_dtor);
+    talloc_free(arena);
+    assert_int_equal(destroyed, 12);
+}
+
+static void test_nested(void **state) {
+    void *outer = talloc_new_arena(NULL);
+    char *a = talloc_strdup(outer, "outer");
+
+    void *inner = talloc_new_arena(outer);
+    char *b = talloc_strdup(inner, "inner");
+    assert_true(talloc_parent(b) == inner);
+    talloc_free(inner);
+
+    char *c = talloc_strdup(outer, "more");
+    assert_string_equal(a, "outer");
+    assert_string_equal(c, "more");
+
+    // Resetting the outer arena frees the inner one.
+    inner = talloc_new_arena(outer);
+    talloc_strdup(inner, "x");
+    talloc_free_children(outer);
+
+    talloc_free(outer);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_alloc_reset),
+        cmocka_unit_test(test_realloc),
+        cmocka_unit_test(test_destructors),
+        cmocka_unit_test(test_nested),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,169 @@
+#include <pthread.h>
+
+#include "test_helpers.h"
+#include "common/common.h"
+#include "misc/thread_pool.h"
+#include "osdep/atomic.h"
+
+static atomic_int counter;
+
+static void add_one(void *ctx)
+{
+    atomic_fetch_add(&counter, 1);
+}
+
+static void test_queue_free(void **state) {
+    atomic_store(&counter, 0);
+    struct mp_thread_pool *pool = mp_thread_pool_create(NULL, 4);
+    assert_true(pool);
+    for (int n = 0; n < 10000; n++)
+        mp_thread_pool_queue(pool, add_one, NULL);
+    // Freeing waits for all queued work.
+    talloc_free(pool);
+    assert_int_equal(atomic_load(&counter), 10000);
+}
+
+struct order_item {
+    int *order;
+    int *num;
+    int idx;
+};
+
+static void record_order(void *ctx)
+{
+    struct order_item *item = ctx;
+    item->order[(*item->num)++] = item->idx;
+}
+
+static void test_fifo(void **state) {
+    // With 1 thread, items must run in the order they were queued.
+    struct mp_thread_pool *pool = mp_thread_pool_create(NULL, 1);
+    struct order_item items[1000];
+    int order[MP_ARRAY_SIZE(items)];
+    int num = 0;
+    for (int n = 0; n < MP_ARRAY_SIZE(items); n++) {
+        items[n] = (struct order_item){order, &num, n};
+        mp_thread_pool_queue(pool, record_order, &items[n]);
+    }
+    talloc_free(pool);
+    assert_int_equal(num, MP_ARRAY_SIZE(items));
+    for (int n = 0; n < num; n++)
+        assert_int_equal(order[n], n);
+}
+
+static void test_group_wait(void **state) {
+    atomic_store(&counter, 0);
+    struct mp_thread_pool *pool = mp_thread_pool_create(NULL, 4);
+    struct mp_task_group *group = mp_task_group_create(NULL, pool);
+    for (int round = 1; round <= 10; round++) {
+        for (int n = 0; n < 1000; n++)
+            mp_task_group_queue(group, add_one, NULL);
+        mp_task_group_wait(group);
+        assert_int_equal(atomic_load(&counter), round * 1000);
+    }
+    // Waiting on an empty group returns immediately.
+    mp_task_group_wait(group);
+    talloc_free(group);
+    talloc_free(pool);
+}
+
+struct sum_ctx {
+    struct mp_thread_pool *pool;
+    int64_t start, end;
+    int64_t result;
+};
+
+// Sum a range by splitting it recursively, waiting for the halves from within
+// work items.
+static void sum_range(void *p)
+{
+    struct sum_ctx *ctx = p;
+    if (ctx->end - ctx->start <= 100) {
+        ctx->result = 0;
+        for (int64_t n = ctx->start; n < ctx->end; n++)
+            ctx->result += n;
+        return;
+    }
+    int64_t mid = ctx->start + (ctx->end - ctx->start) / 2;
+    struct sum_ctx a = {ctx->pool, ctx->start, mid};
+    struct sum_ctx b = {ctx->pool, mid, ctx->end};
+    struct mp_task_group *group = mp_task_group_create(NULL, ctx->pool);
+    mp_task_group_queue(group, sum_range, &a);
+    mp_task_group_queue(group, sum_range, &b);
+    mp_task_group_wait(group);
+    talloc_free(group);
+    ctx->result = a.result + b.result;
+}
+
+static void test_nested(void **state) {
+    for (int threads = 1; threads <= 4; threads++) {
+        struct mp_thread_pool *pool = mp_thread_pool_create(NULL, threads);
+        struct sum_ctx ctx = {pool, 0, 100000};
+        struct mp_task_group *group = mp_task_group_create(NULL, pool);
+        mp_task_group_queue(group, sum_range, &ctx);
+        mp_task_group_wait(group);
+        assert_true(ctx.result == 100000LL * 99999 / 2);
+        talloc_free(group);
+        talloc_free(pool);
+    }
+}
+
+struct producer_ctx {
+    struct mp_task_group *group;
+};
+
+static void *producer_thread(void *p)
+{
+    struct producer_ctx *ctx = p;
+    for (int n = 0; n < 20000; n++)
+        mp_task_group_queue(ctx->group, add_one, NULL);
+    return NULL;
+}
+
+static void test_concurrent_queue(void **state) {
+    atomic_store(&counter, 0);
+    struct mp_thread_pool *pool = mp_thread_pool_create(NULL, 3);
+    struct mp_task_group *group = mp_task_group_create(NULL, pool);
+    struct producer_ctx ctx = {group};
+    pthread_t threads[4];
+    for (int n = 0; n < MP_ARRAY_SIZE(threads); n++)
+        assert_int_equal(pthread_create(&threads[n], NULL, producer_thread, &ctx), 0);
+    for (int n = 0; n < MP_ARRAY_SIZE(threads); n++)
+        pthread_join(threads[n], NULL);
+    mp_task_group_wait(group);
+    assert_int_equal(atomic_load(&counter), 4 * 20000);
+    talloc_free(group);
+    talloc_free(pool);
+}
+
+static void test_default(void **state) {
+    void *a = talloc_new(NULL);
+    void *b = talloc_new(NULL);
+    struct mp_thread_pool *pool = mp_thread_pool_get_default(a);
+    assert_true(pool);
+    assert_true(mp_thread_pool_get_num_threads(pool) >= 1);
+    assert_true(mp_thread_pool_get_default(b) == pool);
+    talloc_free(a);
+
+    atomic_store(&counter, 0);
+    struct mp_task_group *group = mp_task_group_create(NULL, pool);
+    for (int n = 0; n < 100; n++)
+        mp_task_group_queue(group, add_one, NULL);
+    mp_task_group_wait(group);
+    assert_int_equal(atomic_load(&counter), 100);
+    talloc_free(group);
+    // Drops the last reference, which destroys the pool.
+    talloc_free(b);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_queue_free),
+        cmocka_unit_test(test_fifo),
+        cmocka_unit_test(test_group_wait),
+        cmocka_unit_test(test_nested),
+        cmocka_unit_test(test_concurrent_queue),
+        cmocka_unit_test(test_default),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,127 @@
+#include <stdlib.h>
+
+#include "test_helpers.h"
+#include "audio/xcorr.h"
+#include "common/common.h"
+
+// The search as af_scaletempo did it before the optimized kernels were added.
+static int reference_best_offset(const float *ref, int ref_len,
+                                 const float *search, int num_offsets,
+                                 int stride)
+{
+    float best_corr = -INFINITY;
+    int best_off = 0;
+    for (int off = 0; off < num_offsets; off++) {
+        float corr = 0;
+        for (int i = 0; i < ref_len; i++)
+            corr += ref[i] * search[off * stride + i];
+        if (corr > best_corr) {
+            best_corr = corr;
+            best_off = off;
+        }
+    }
+    return best_off;
+}
+
+static double corr_at(const float *ref, int ref_len, const float *search,
+                      int off, int stride)
+{
+    double corr = 0;
+    for (int i = 0; i < ref_len; i++)
+        corr += ref[i] * (double)search[off * stride + i];
+    return corr;
+}
+
+static void fill_noise(float *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = rand() / (float)RAND_MAX * 2 - 1;
+}
+
+// Correlate a windowed piece of search with search itself; the piece's
+// position must be found exactly.
+static void check_shifted_copy(enum mp_xcorr_mode mode, int stride)
+{
+    int frames = 300, offsets = 200;
+    int ref_len = frames * stride;
+    int search_len = ref_len + (offsets - 1) * stride;
+    float *search = talloc_array(NULL, float, search_len);
+    float *ref = talloc_array(NULL, float, ref_len);
+    fill_noise(search, search_len);
+
+    struct mp_xcorr *c = mp_xcorr_create(NULL, mode, ref_len, offsets, stride);
+    assert_int_equal(mp_xcorr_uses_fft(c), mode == MP_XCORR_FFT);
+
+    for (int expect = 0; expect < offsets; expect += 37) {
+        for (int i = 0; i < ref_len; i++) {
+            float w = (i / stride) * (float)(frames - i / stride);
+            ref[i] = w * search[expect * stride + i];
+        }
+        assert_int_equal(mp_xcorr_best_offset(c, ref, search), expect);
+    }
+
+    talloc_free(c);
+    talloc_free(ref);
+    talloc_free(search);
+}
+
+static void test_shifted_copy_direct(void **state) {
+    check_shifted_copy(MP_XCORR_DIRECT, 1);
+    check_shifted_copy(MP_XCORR_DIRECT, 6);
+}
+
+static void test_shifted_copy_fft(void **state) {
+    check_shifted_copy(MP_XCORR_FFT, 1);
+    check_shifted_copy(MP_XCORR_FFT, 6);
+}
+
+// On unrelated signals, the offset found may differ from the old code only if
+// the correlation values are practically equal.
+static void test_matches_reference(void **state) {
+    static const enum mp_xcorr_mode modes[] = {MP_XCORR_DIRECT, MP_XCORR_FFT};
+    for (int stride = 1; stride <= 8; stride++) {
+        int ref_len = 113 * stride, offsets = 171;
+        int search_len = ref_len + (offsets - 1) * stride;
+        float *search = talloc_array(NULL, float, search_len);
+        float *ref = talloc_array(NULL, float, ref_len);
+        for (int iter = 0; iter < 10; iter++) {
+            fill_noise(search, search_len);
+            fill_noise(ref, ref_len);
+            int expect = reference_best_offset(ref, ref_len, search, offsets,
+                                               stride);
+            double best = corr_at(ref, ref_len, search, expect, stride);
+            for (int m = 0; m < MP_ARRAY_SIZE(modes); m++) {
+                struct mp_xcorr *c = mp_xcorr_create(NULL, modes[m], ref_len,
+                                                     offsets, stride);
+                int off = mp_xcorr_best_offset(c, ref, search);
+                double got = corr_at(ref, ref_len, search, off, stride);
+                assert_true(fabs(best - got) <= 1e-4 * fabs(best));
+                talloc_free(c);
+            }
+        }
+        talloc_free(ref);
+        talloc_free(search);
+    }
+}
+
+static void test_dot(void **state) {
+    float a[37], b[37];
+    double expect = 0;
+    for (int i = 0; i < 37; i++) {
+        a[i] = i * 0.5f;
+        b[i] = 3 - i;
+        expect += a[i] * b[i];
+    }
+    assert_true(fabs(mp_xcorr_dot(a, b, 37) - expect) < 1e-3);
+    assert_float_equal(mp_xcorr_dot(a, b, 0), 0.0f);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_dot),
+        cmocka_unit_test(test_shifted_copy_direct),
+        cmocka_unit_test(test_shifted_copy_fft),
+        cmocka_unit_test(test_matches_reference),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
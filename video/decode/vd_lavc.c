@@ -30,6 +30,7 @@
 
 #include "mpv_talloc.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "common/msg.h"
 #include "options/options.h"
 #include "misc/bstr.h"
@@ -155,7 +156,7 @@ typedef struct lavc_ctx {
     AVRational codec_timebase;
     enum AVDiscard skip_frame;
     bool flushing;
-    bool eof_returned;
+    struct lavc_state state;
     const char *decoder;
     bool hwdec_requested;
     bool hwdec_failed;
@@ -1154,7 +1155,7 @@ static void process(struct mp_filter *vd)
 {
     vd_ffmpeg_ctx *ctx = vd->priv;
 
-    lavc_process(vd, &ctx->eof_returned, send_packet, receive_frame);
+    lavc_process(vd, &ctx->state, send_packet, receive_frame);
 }
 
 static void reset(struct mp_filter *vd)
@@ -1163,7 +1164,8 @@ static void reset(struct mp_filter *vd)
 
     flush_all(vd);
 
-    ctx->eof_returned = false;
+    ctx->state.eof_returned = false;
+    ctx->state.decode_time = 0;
     ctx->framedrop_flags = 0;
 }
 
@@ -1207,6 +1209,8 @@ static struct mp_decoder *create(struct mp_filter *parent,
 
     ctx->public.f = vd;
     ctx->public.control = control;
+    ctx->state.metric_frame_us =
+        mp_metrics_get(vd->global, "decode/video-frame-us", MP_METRIC_HISTOGRAM);
 
     pthread_mutex_init(&ctx->dr_lock, NULL);
 
@@ -41,6 +41,7 @@
 #include "options/m_config.h"
 #include "common/msg.h"
 #include "common/global.h"
+#include "common/metrics.h"
 #include "video/hwdec.h"
 #include "video/mp_image.h"
 #include "sub/osd.h"
@@ -114,6 +115,10 @@ struct vo_internal {
 
     atomic_ullong dr_in_flight;
 
+    struct mp_metric *metric_draw_us;
+    struct mp_metric *metric_flip_us;
+    struct mp_metric *metric_dropped;
+
     // --- The following fields are protected by lock
     pthread_mutex_t lock;
     pthread_cond_t wakeup;
@@ -293,6 +298,12 @@ static struct vo *vo_create(bool probing, struct mpv_global *global,
         .dispatch = mp_dispatch_create(vo),
         .req_frames = 1,
         .estimated_vsync_jitter = -1,
+        .metric_draw_us =
+            mp_metrics_get(global, "vo/draw-us", MP_METRIC_HISTOGRAM),
+        .metric_flip_us =
+            mp_metrics_get(global, "vo/flip-us", MP_METRIC_HISTOGRAM),
+        .metric_dropped =
+            mp_metrics_get(global, "vo/dropped-frames", MP_METRIC_COUNTER),
     };
     mp_dispatch_set_wakeup_fn(vo->in->dispatch, dispatch_wakeup_cb, vo);
     pthread_mutex_init(&vo->in->lock, NULL);
@@ -870,6 +881,7 @@ bool vo_render_frame_external(struct vo *vo)
 
     if (in->dropped_frame) {
         in->drop_count += 1;
+        mp_metric_add(in->metric_dropped, 1);
     } else {
         flipped = true;
         in->rendering = true;
@@ -879,6 +891,7 @@ bool vo_render_frame_external(struct vo *vo)
         wakeup_core(vo); // core can queue new video now
 
         MP_STATS(vo, "start video-draw");
+        int64_t start = mp_time_us();
 
         if (vo->driver->draw_frame) {
             vo->driver->draw_frame(vo, frame);
@@ -886,14 +899,17 @@ bool vo_render_frame_external(struct vo *vo)
             vo->driver->draw_image(vo, mp_image_new_ref(frame->current));
         }
 
+        mp_metric_record(in->metric_draw_us, mp_time_us() - start);
         MP_STATS(vo, "end video-draw");
 
         wait_until(vo, target);
 
         MP_STATS(vo, "start video-flip");
+        start = mp_time_us();
 
         vo->driver->flip_page(vo);
 
+        mp_metric_record(in->metric_flip_us, mp_time_us() - start);
         MP_STATS(vo, "end video-flip");
 
         pthread_mutex_lock(&in->lock);
@@ -1105,6 +1121,7 @@ void vo_increment_drop_count(struct vo *vo, int64_t n)
     pthread_mutex_lock(&vo->in->lock);
     vo->in->drop_count += n;
     pthread_mutex_unlock(&vo->in->lock);
+    mp_metric_add(vo->in->metric_dropped, n);
 }
 
 // Make the VO redraw the OSD at some point in the future.
@@ -254,6 +254,7 @@ def build(ctx):
         ( "audio/out/ao_wasapi_utils.c",         "wasapi" ),
         ( "audio/out/pull.c" ),
         ( "audio/out/push.c" ),
+        ( "audio/xcorr.c" ),
 
         ## Core
         ( "common/av_common.c" ),
@@ -261,6 +262,7 @@ def build(ctx):
         ( "common/codecs.c" ),
         ( "common/common.c" ),
         ( "common/encode_lavc.c",                "encoding" ),
+        ( "common/metrics.c" ),
         ( "common/msg.c" ),
         ( "common/playlist.c" ),
         ( "common/recorder.c" ),
@@ -317,7 +319,9 @@ def build(ctx):
         ( "misc/bstr.c" ),
         ( "misc/charset_conv.c" ),
         ( "misc/dispatch.c" ),
+        ( "misc/hashmap.c" ),
         ( "misc/json.c" ),
+        ( "misc/msgpack.c" ),
         ( "misc/node.c" ),
         ( "misc/rendezvous.c" ),
         ( "misc/ring.c" ),
@@ -577,7 +581,8 @@ def build(ctx):
                 ctx.path.find_node('osdep/mpv.rc'),
                 version)
 
-    if ctx.dependency_satisfied('cplayer') or ctx.dependency_satisfied('test'):
+    if ctx.dependency_satisfied('cplayer') or ctx.dependency_satisfied('test') \
+            or ctx.dependency_satisfied('bench'):
         ctx(
             target       = "objects",
             source       = ctx.filtered_sources(sources),
@@ -631,6 +636,17 @@ def build(ctx):
                 install_path = None,
             )
 
+    if ctx.dependency_satisfied('bench'):
+        for bench in ctx.path.ant_glob("test/bench/*.c"):
+            ctx(
+                target       = os.path.splitext(bench.srcpath())[0],
+                source       = bench.srcpath(),
+                use          = ctx.dependencies_use() + ['objects'],
+                includes     = _all_includes(ctx),
+                features     = "c cprogram",
+                install_path = None,
+            )
+
     build_shared = ctx.dependency_satisfied('libmpv-shared')
     build_static = ctx.dependency_satisfied('libmpv-static')
     if build_shared or build_static: